@@ -0,0 +1,130 @@
+/** @file CbmStsAnalogBuffer.cxx
+ **/
+
+#include "CbmStsAnalogBuffer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include "CbmMatch.h"
+
+
+// -----   Constructor   ---------------------------------------------------
+CbmStsAnalogBuffer::CbmStsAnalogBuffer() :
+  fChannels(), fLinks(), fFreeLink(-1)
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add a signal   --------------------------------------------------
+Bool_t CbmStsAnalogBuffer::AddSignal(UShort_t channel, Double_t time,
+                                     Double_t charge, Int_t index,
+                                     Int_t entry, Int_t file,
+                                     Double_t deadTime) {
+
+  if ( channel >= fChannels.size() ) fChannels.resize(channel + 1);
+  Channel& chan = fChannels[channel];
+  auto begin = chan.fSignals.begin() + chan.fFirst;
+  auto end = chan.fSignals.end();
+
+  // --- Since the buffered signals are time-ordered, only those around
+  // --- time - deadTime need to be checked; the first one within the dead
+  // --- time is merged. One signal before the search result is included to
+  // --- be safe against rounding.
+  auto it = std::lower_bound(begin, end, time - deadTime,
+      [] (const Signal& signal, Double_t t) { return signal.fTime < t; });
+  if ( it != begin ) it--;
+  for (; it != end; it++) {
+    if ( it->fTime - time >= deadTime ) break;
+    if ( std::fabs(it->fTime - time) < deadTime ) {
+      it->fTime = std::min(it->fTime, time);
+      it->fCharge += charge;
+      Int_t link = NewLink(charge, index, entry, file);
+      fLinks[it->fLastLink].fNext = link;
+      it->fLastLink = link;
+      return kTRUE;
+    } //? Merge with buffered signal
+  } //# candidate signals
+
+  // --- Insert after the buffered signals with the same or earlier time
+  auto pos = std::upper_bound(begin, end, time,
+      [] (Double_t t, const Signal& signal) { return t < signal.fTime; });
+  Int_t link = NewLink(charge, index, entry, file);
+  chan.fSignals.insert(pos, Signal{time, charge, link, link});
+  return kFALSE;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Remove all signals   --------------------------------------------
+void CbmStsAnalogBuffer::Clear() {
+  for (Channel& chan : fChannels) {
+    chan.fSignals.clear();
+    chan.fFirst = 0;
+  }
+  fLinks.clear();
+  fFreeLink = -1;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   MC links of a signal   ------------------------------------------
+void CbmStsAnalogBuffer::GetMatch(const Signal& signal,
+                                  CbmMatch& match) const {
+  match.ClearLinks();
+  for (Int_t iLink = signal.fFirstLink; iLink >= 0;
+       iLink = fLinks[iLink].fNext) {
+    const Link& link = fLinks[iLink];
+    match.AddLink(link.fCharge, link.fIndex, link.fEntry, link.fFile);
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Status of the buffer   ------------------------------------------
+void CbmStsAnalogBuffer::GetStatus(Int_t& nofSignals, Double_t& timeFirst,
+                                   Double_t& timeLast) const {
+  nofSignals = 0;
+  timeFirst = -1.;
+  timeLast = -1.;
+  for (const Channel& chan : fChannels) {
+    if ( chan.fFirst == chan.fSignals.size() ) continue;
+    Double_t tFirst = chan.fSignals[chan.fFirst].fTime;
+    Double_t tLast = chan.fSignals.back().fTime;
+    nofSignals += chan.fSignals.size() - chan.fFirst;
+    timeFirst = ( timeFirst < 0. ? tFirst : std::min(timeFirst, tFirst) );
+    timeLast = std::max(timeLast, tLast);
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Set the number of channels   ------------------------------------
+void CbmStsAnalogBuffer::Init(UShort_t nChannels) {
+  Clear();
+  fChannels.resize(nChannels);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Store a link in the arena   -------------------------------------
+Int_t CbmStsAnalogBuffer::NewLink(Double_t charge, Int_t index, Int_t entry,
+                                  Int_t file) {
+  Int_t link = fFreeLink;
+  if ( link >= 0 ) fFreeLink = fLinks[link].fNext;
+  else {
+    link = fLinks.size();
+    fLinks.emplace_back();
+  }
+  fLinks[link] = Link{charge, index, entry, file, -1};
+  assert( link >= 0 && link < Int_t(fLinks.size()) );
+  return link;
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,201 @@
+/** @file CbmStsAnalogBuffer.h
+ **/
+
+#ifndef CBMSTSANALOGBUFFER_H
+#define CBMSTSANALOGBUFFER_H 1
+
+#include <vector>
+#include "Rtypes.h"
+
+class CbmMatch;
+
+
+/** @class CbmStsAnalogBuffer
+ ** @brief Buffer for the analogue signals of the channels of a module
+ **
+ ** For each channel, the signals are stored time-ordered in a flat array
+ ** of small POD records (time, charge and the first and last entry of their
+ ** MC links). The MC links (charge, point index, entry, file) are kept in
+ ** a common arena for the module and chained per signal; released entries
+ ** are reused. After the first events, no allocation is needed any longer.
+ **
+ ** A new signal is merged with the first buffered signal of the channel
+ ** within the dead time (found by binary search), else inserted at its time
+ ** position. The read-out takes the signals from the front of a channel
+ ** array, by advancing the start index; the array is compacted only when
+ ** the read-out part exceeds the remaining one. This reproduces exactly the
+ ** former std::multiset of CbmStsSignal objects.
+ **/
+class CbmStsAnalogBuffer
+{
+
+  public:
+
+    /** @brief Analogue signal in a channel **/
+    struct Signal {
+      Double_t fTime;      ///< Signal time [ns]
+      Double_t fCharge;    ///< Total charge [e]
+      Int_t fFirstLink;    ///< First MC link in the arena
+      Int_t fLastLink;     ///< Last MC link in the arena
+    };
+
+
+    /** @brief Constructor **/
+    CbmStsAnalogBuffer();
+
+
+    /** @brief Add a signal
+     ** @param channel   Channel number
+     ** @param time      Signal time [ns]
+     ** @param charge    Analogue charge [e]
+     ** @param index     Index of CbmStsPoint
+     ** @param entry     MC entry (event number)
+     ** @param file      MC input file number
+     ** @param deadTime  Dead time of the channel [ns]
+     ** @return kTRUE if the signal was merged with a buffered one
+     **
+     ** If a buffered signal lies within the dead time, the charge is added
+     ** to it and its time is set to the earlier of both. Channels beyond the
+     ** current size are created on the fly.
+     **/
+    Bool_t AddSignal(UShort_t channel, Double_t time, Double_t charge,
+                     Int_t index, Int_t entry, Int_t file, Double_t deadTime);
+
+
+    /** @brief Remove all signals; the storage is kept **/
+    void Clear();
+
+
+    /** @brief MC links of a signal
+     ** @param[in]  signal  Buffered signal
+     ** @param[out] match   Match object; links are replaced
+     **/
+    void GetMatch(const Signal& signal, CbmMatch& match) const;
+
+
+    /** @brief Number of channels **/
+    UInt_t GetNofChannels() const { return fChannels.size(); }
+
+
+    /** @brief Signal in a channel
+     ** @param channel  Channel number
+     ** @param iSignal  Index of the signal in the channel, in time order
+     **/
+    const Signal& GetSignal(UShort_t channel, UInt_t iSignal) const {
+      const auto& chan = fChannels[channel];
+      return chan.fSignals[chan.fFirst + iSignal];
+    }
+
+
+    /** @brief Number of signals in a channel **/
+    UInt_t GetNofSignals(UShort_t channel) const {
+      if ( channel >= fChannels.size() ) return 0;
+      return fChannels[channel].fSignals.size() - fChannels[channel].fFirst;
+    }
+
+
+    /** @brief Status of the buffer
+     ** @param[out] nofSignals  Number of signals in buffer
+     ** @param[out] timeFirst   Time of first signal [ns]; -1 if empty
+     ** @param[out] timeLast    Time of last signal [ns]; -1 if empty
+     **/
+    void GetStatus(Int_t& nofSignals, Double_t& timeFirst,
+                   Double_t& timeLast) const;
+
+
+    /** @brief Set the number of channels and remove all signals
+     ** @param nChannels  Number of channels
+     **/
+    void Init(UShort_t nChannels);
+
+
+    /** @brief Read out the signals of a channel up to a time limit
+     ** @param channel    Channel number
+     ** @param readAll    If kTRUE, all signals are read out
+     ** @param timeLimit  Signals with time up to this are read out [ns]
+     ** @param readout    Called as readout(signal) in time order
+     ** @return Number of read-out signals
+     **
+     ** The read-out signals and their links are removed from the buffer
+     ** after the call of readout.
+     **/
+    template <class Readout>
+    Int_t ReadOut(UShort_t channel, Bool_t readAll, Double_t timeLimit,
+                  Readout readout);
+
+
+  private:
+
+    /** @brief MC link of a signal **/
+    struct Link {
+      Double_t fCharge;   ///< Charge [e]
+      Int_t fIndex;       ///< Index of CbmStsPoint
+      Int_t fEntry;       ///< MC entry
+      Int_t fFile;        ///< MC input file
+      Int_t fNext;        ///< Next link of the signal (or free entry); -1 at end
+    };
+
+
+    /** @brief Signals of one channel; valid from fFirst on **/
+    struct Channel {
+      std::vector<Signal> fSignals;
+      UInt_t fFirst = 0;
+    };
+
+
+    std::vector<Channel> fChannels;  ///< Signals per channel
+    std::vector<Link> fLinks;        ///< Link arena
+    Int_t fFreeLink;                 ///< First free entry of the arena; -1 if none
+
+
+    /** @brief Store a link in the arena
+     ** @return Index of the link
+     **/
+    Int_t NewLink(Double_t charge, Int_t index, Int_t entry, Int_t file);
+
+
+    /** @brief Return the links of a signal to the arena **/
+    void ReleaseLinks(const Signal& signal) {
+      fLinks[signal.fLastLink].fNext = fFreeLink;
+      fFreeLink = signal.fFirstLink;
+    }
+
+};
+
+
+
+// -----   Read out a channel   --------------------------------------------
+template <class Readout>
+Int_t CbmStsAnalogBuffer::ReadOut(UShort_t channel, Bool_t readAll,
+                                  Double_t timeLimit, Readout readout) {
+
+  if ( channel >= fChannels.size() ) return 0;
+  Channel& chan = fChannels[channel];
+  UInt_t nSignals = chan.fSignals.size();
+  UInt_t first = chan.fFirst;
+  while ( first < nSignals ) {
+    const Signal& signal = chan.fSignals[first];
+    if ( ! readAll && signal.fTime > timeLimit ) break;
+    readout(signal);
+    ReleaseLinks(signal);
+    first++;
+  }
+  Int_t nRead = first - chan.fFirst;
+
+  // --- Compact the array once the read-out part dominates
+  if ( first == nSignals ) {
+    chan.fSignals.clear();
+    first = 0;
+  }
+  else if ( first > nSignals - first ) {
+    chan.fSignals.erase(chan.fSignals.begin(),
+                        chan.fSignals.begin() + first);
+    first = 0;
+  }
+  chan.fFirst = first;
+
+  return nRead;
+}
+// -------------------------------------------------------------------------
+
+#endif
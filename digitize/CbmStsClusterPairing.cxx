@@ -0,0 +1,92 @@
+/** @file CbmStsClusterPairing.cxx
+ **/
+
+#include "CbmStsClusterPairing.h"
+
+#include <cassert>
+
+
+// -----   Constructor   ---------------------------------------------------
+CbmStsClusterPairing::CbmStsClusterPairing() :
+  fFront(), fBack(), fBackTime(), fBackError(), fClasses(fgkNofClasses),
+  fCandidates(), fMaxErrorBack(0.), fIsIndexed(kFALSE),
+  fNofTested(0), fNofAccepted(0), fNofTotal(0)
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add a cluster   -------------------------------------------------
+void CbmStsClusterPairing::AddCluster(CbmStsCluster* cluster, Int_t side) {
+  assert(cluster);
+  assert( side == 0 || side == 1 );
+  if ( side == 0 ) fFront.push_back(cluster);
+  else fBack.push_back(cluster);
+  fIsIndexed = kFALSE;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Sort the back clusters and build the error classes   ------------
+void CbmStsClusterPairing::BuildIndex() {
+
+  // --- Back clusters in ascending time. They usually come time-sorted
+  // --- from the module; the sort is stable to keep the order for equal
+  // --- times.
+  Bool_t isSorted = kTRUE;
+  for (UInt_t iB = 1; iB < fBack.size(); iB++)
+    if ( fBack[iB]->GetTime() < fBack[iB-1]->GetTime() ) {
+      isSorted = kFALSE;
+      break;
+    }
+  if ( ! isSorted )
+    std::stable_sort(fBack.begin(), fBack.end(),
+                     [] (const CbmStsCluster* c1, const CbmStsCluster* c2) {
+                       return c1->GetTime() < c2->GetTime();
+                     });
+
+  fBackTime.resize(fBack.size());
+  fBackError.resize(fBack.size());
+  fMaxErrorBack = 0.;
+  Double_t minError = -1.;
+  for (UInt_t iB = 0; iB < fBack.size(); iB++) {
+    fBackTime[iB] = fBack[iB]->GetTime();
+    fBackError[iB] = fBack[iB]->GetTimeError();
+    fMaxErrorBack = std::max(fMaxErrorBack, fBackError[iB]);
+    if ( fBackError[iB] > 0. && ( minError < 0. || fBackError[iB] < minError ) )
+      minError = fBackError[iB];
+  }
+
+  // --- Error classes: a factor of two in the error per class, starting
+  // --- from the smallest positive error. Larger errors go to the last class.
+  for (ErrorClass& errClass : fClasses) {
+    errClass.fMaxError = 0.;
+    errClass.fTime.clear();
+    errClass.fIndex.clear();
+  }
+  for (UInt_t iB = 0; iB < fBack.size(); iB++) {
+    Int_t iClass = 0;
+    if ( fBackError[iB] > 0. && minError > 0. )
+      iClass = std::min( Int_t( std::log2(fBackError[iB] / minError) ),
+                         fgkNofClasses - 1 );
+    ErrorClass& errClass = fClasses[iClass];
+    errClass.fMaxError = std::max(errClass.fMaxError, fBackError[iB]);
+    errClass.fTime.push_back(fBackTime[iB]);
+    errClass.fIndex.push_back(iB);
+  }
+
+  fIsIndexed = kTRUE;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Remove all clusters   -------------------------------------------
+void CbmStsClusterPairing::Clear() {
+  fFront.clear();
+  fBack.clear();
+  fIsIndexed = kFALSE;
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,200 @@
+/** @file CbmStsClusterPairing.h
+ **/
+
+#ifndef CBMSTSCLUSTERPAIRING_H
+#define CBMSTSCLUSTERPAIRING_H 1
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Rtypes.h"
+#include "CbmStsCluster.h"
+
+
+/** @class CbmStsClusterPairing
+ ** @brief Time-indexed pairing of front- and back-side clusters
+ **
+ ** Finds the pairs of front-side and back-side clusters of a sensor which
+ ** are compatible in time, as candidates for hits. The selection is the
+ ** same as in the former sliding-window loop of the sensor hit finding:
+ ** a pair is accepted if the time difference is within four times the
+ ** combined error of the front cluster and the largest back-cluster error,
+ ** and within the time cut (absolute or in units of the combined error of
+ ** the two clusters).
+ **
+ ** The back-side clusters are kept time-sorted and grouped into classes of
+ ** their time error (factor two per class). For each front cluster, the
+ ** candidates are found by binary search in each class, with a window
+ ** given by the largest error in the class only. A single cluster with a
+ ** large error thus does not widen the search for all others. The pairs
+ ** are visited in the order of the front clusters as given and, for each,
+ ** in ascending time of the back clusters.
+ **
+ ** The numbers of tested and accepted candidate pairs are counted, to
+ ** quantify the pruning.
+ **/
+class CbmStsClusterPairing
+{
+
+  public:
+
+    /** @brief Constructor **/
+    CbmStsClusterPairing();
+
+
+    /** @brief Add a cluster
+     ** @param cluster  Pointer to cluster
+     ** @param side     0 = front side, 1 = back side
+     **/
+    void AddCluster(CbmStsCluster* cluster, Int_t side);
+
+
+    /** @brief Remove all clusters; the counters are kept **/
+    void Clear();
+
+
+    /** @brief Find the compatible cluster pairs
+     ** @param tCutInNs     Max. time difference of clusters in ns
+     ** @param tCutInSigma  Max. time difference in multiples of the error
+     ** @param visit        Called as visit(clusterF, clusterB, iF, iB) for
+     **                     each accepted pair; iF is the index of the front
+     **                     cluster in input order, iB the one of the back
+     **                     cluster in time order.
+     ** @return Number of accepted pairs
+     **
+     ** If tCutInNs is positive, it is used as time cut; else, tCutInSigma
+     ** is used. If both are not positive, no pair is accepted.
+     **/
+    template <class Visitor>
+    Int_t FindPairs(Double_t tCutInNs, Double_t tCutInSigma, Visitor visit);
+
+
+    /** @brief Back-side cluster
+     ** @param index  Index in time order (as given to the visitor)
+     **/
+    CbmStsCluster* GetBack(Int_t index) const { return fBack[index]; }
+
+
+    /** @brief Front-side cluster
+     ** @param index  Index in input order (as given to the visitor)
+     **/
+    CbmStsCluster* GetFront(Int_t index) const { return fFront[index]; }
+
+
+    /** @brief Number of back-side clusters **/
+    Int_t GetNofBack() const { return fBack.size(); }
+
+
+    /** @brief Number of front-side clusters **/
+    Int_t GetNofFront() const { return fFront.size(); }
+
+
+    /** @brief Number of accepted pairs since construction **/
+    Long64_t GetNofPairsAccepted() const { return fNofAccepted; }
+
+
+    /** @brief Number of tested candidate pairs since construction **/
+    Long64_t GetNofPairsTested() const { return fNofTested; }
+
+
+    /** @brief Number of pairs of all front and back clusters since construction
+     **
+     ** This is the number of tests of an exhaustive pairing.
+     **/
+    Long64_t GetNofPairsTotal() const { return fNofTotal; }
+
+
+  private:
+
+    static const Int_t fgkNofClasses = 8;  ///< Max. number of error classes
+
+    /** Index of the back clusters in one error class **/
+    struct ErrorClass {
+      Double_t fMaxError = 0.;             ///< Largest time error [ns]
+      std::vector<Double_t> fTime;         ///< Cluster times, ascending [ns]
+      std::vector<Int_t> fIndex;           ///< Index in time-sorted back list
+    };
+
+    std::vector<CbmStsCluster*> fFront;     ///< Front clusters, input order
+    std::vector<CbmStsCluster*> fBack;      ///< Back clusters, time order
+    std::vector<Double_t> fBackTime;        ///< Time of back clusters [ns]
+    std::vector<Double_t> fBackError;       ///< Time error of back clusters [ns]
+    std::vector<ErrorClass> fClasses;       ///< Back clusters by error class
+    std::vector<Int_t> fCandidates;         ///< Candidates for a front cluster
+    Double_t fMaxErrorBack;                 ///< Largest back time error [ns]
+    Bool_t fIsIndexed;                      ///< Index is up to date
+    Long64_t fNofTested;                    ///< Tested candidate pairs
+    Long64_t fNofAccepted;                  ///< Accepted pairs
+    Long64_t fNofTotal;                     ///< Pairs of exhaustive search
+
+
+    /** @brief Sort the back clusters and build the error classes **/
+    void BuildIndex();
+
+};
+
+
+
+// -----   Find compatible pairs   -----------------------------------------
+template <class Visitor>
+Int_t CbmStsClusterPairing::FindPairs(Double_t tCutInNs,
+                                      Double_t tCutInSigma, Visitor visit) {
+
+  if ( ! fIsIndexed ) BuildIndex();
+  fNofTotal += Long64_t(fFront.size()) * Long64_t(fBack.size());
+  if ( tCutInNs <= 0. && tCutInSigma <= 0. ) return 0;
+
+  Int_t nPairs = 0;
+  for (UInt_t iF = 0; iF < fFront.size(); iF++) {
+    CbmStsCluster* clusterF = fFront[iF];
+    Double_t timeF = clusterF->GetTime();
+    Double_t errorF = clusterF->GetTimeError();
+
+    // --- Window from the front error and the largest back error
+    Double_t window = 4. * std::sqrt( errorF * errorF
+                                      + fMaxErrorBack * fMaxErrorBack );
+
+    // --- Candidates from the error classes. The search range is slightly
+    // --- enlarged to be safe against rounding; the exact cuts follow.
+    fCandidates.clear();
+    Int_t nClassesUsed = 0;
+    for (const ErrorClass& errClass : fClasses) {
+      if ( errClass.fTime.empty() ) continue;
+      Double_t range = window;
+      if ( tCutInNs > 0. ) range = std::min(range, tCutInNs);
+      else range = std::min(range, tCutInSigma
+          * std::sqrt( errorF * errorF + errClass.fMaxError * errClass.fMaxError ));
+      range += 1.e-12 * ( std::fabs(timeF) + range );
+      auto it = std::lower_bound(errClass.fTime.begin(), errClass.fTime.end(),
+                                 timeF - range);
+      Int_t nBefore = fCandidates.size();
+      for (; it != errClass.fTime.end() && *it <= timeF + range; it++)
+        fCandidates.push_back( errClass.fIndex[it - errClass.fTime.begin()] );
+      if ( Int_t(fCandidates.size()) > nBefore ) nClassesUsed++;
+    } //# error classes
+    if ( nClassesUsed > 1 )
+      std::sort(fCandidates.begin(), fCandidates.end());
+
+    // --- Exact selection
+    for (Int_t iB : fCandidates) {
+      fNofTested++;
+      Double_t timeDiff = std::fabs(timeF - fBackTime[iB]);
+      if ( timeDiff > window ) continue;
+      Double_t timeCut = tCutInNs;
+      if ( tCutInNs <= 0. ) {
+        Double_t errorB = fBackError[iB];
+        timeCut = tCutInSigma * std::sqrt( errorF * errorF + errorB * errorB );
+      }
+      if ( timeDiff > timeCut ) continue;
+      fNofAccepted++;
+      nPairs++;
+      visit(clusterF, fBack[iB], Int_t(iF), iB);
+    } //# candidates
+
+  } //# front clusters
+
+  return nPairs;
+}
+// -------------------------------------------------------------------------
+
+#endif
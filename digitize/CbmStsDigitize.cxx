@@ -14,14 +14,17 @@
 #include <sstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 // Includes from ROOT
 #include "TClonesArray.h"
+#include "TDatabasePDG.h"
 #include "TGeoBBox.h"
 #include "TGeoMatrix.h"
 #include "TGeoPhysicalNode.h"
 #include "TGeoVolume.h"
+#include "TRandom.h"
 
 // Includes from FairRoot
 #include "FairEventHeader.h"
@@ -35,6 +38,7 @@
 #include "FairRuntimeDb.h"
 
 // Includes from CbmRoot
+#include "CbmLink.h"
 #include "CbmMCTrack.h"
 #include "CbmStsDigi.h"
 #include "CbmStsPoint.h"
@@ -88,7 +92,10 @@ CbmStsDigitize::CbmStsDigitize() :
   fNofSignalsBTot(0.),
   fNofDigisTot(0.),
   fNofNoiseTot(0.),
-  fTimeTot()
+  fTimeTot(),
+  fParallelism_enabled(kFALSE),
+  fRandomSeed(0),
+  fRandomSeedSet(kFALSE)
 { 
   ResetCounters();
   fBranchName = "StsDigi";
@@ -107,11 +114,13 @@ CbmStsDigitize::~CbmStsDigitize() {
 // -----   Content of analogue buffers   -----------------------------------
 Int_t CbmStsDigitize::BufferSize() const {
   Int_t    nSignals =  0;
-  Int_t    nSigModule;
-  Double_t t1Module;
-  Double_t t2Module;
 
-  for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++) {
+  Int_t nModules = fSetup->GetNofModules();
+  #pragma omp parallel for reduction(+:nSignals) if(fParallelism_enabled)
+  for (Int_t iModule = 0; iModule < nModules; iModule++) {
+    Int_t    nSigModule;
+    Double_t t1Module;
+    Double_t t2Module;
     fSetup->GetModule(iModule)->BufferStatus(nSigModule, t1Module, t2Module);
     nSignals += nSigModule;
   } //# modules in setup
@@ -126,21 +135,24 @@ Int_t CbmStsDigitize::BufferSize() const {
 string CbmStsDigitize::BufferStatus() const {
 
   Int_t    nSignals =  0;
-  Double_t t1       = -1;
+  Double_t t1       = std::numeric_limits<Double_t>::max();
   Double_t t2       = -1.;
 
-  Int_t    nSigModule;
-  Double_t t1Module;
-  Double_t t2Module;
-
-  for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++) {
+  Int_t nModules = fSetup->GetNofModules();
+  #pragma omp parallel for reduction(+:nSignals) reduction(min:t1) \
+                           reduction(max:t2) if(fParallelism_enabled)
+  for (Int_t iModule = 0; iModule < nModules; iModule++) {
+    Int_t    nSigModule;
+    Double_t t1Module;
+    Double_t t2Module;
     fSetup->GetModule(iModule)->BufferStatus(nSigModule, t1Module, t2Module);
     if ( nSigModule ) {
       nSignals += nSigModule;
-      t1 = t1 < 0. ? t1Module : TMath::Min(t1, t1Module);
+      t1 = TMath::Min(t1, t1Module);
       t2  = TMath::Max(t2, t2Module);
     } //? signals in module buffer?
   } //# modules in setup
+  if ( ! nSignals ) t1 = -1.;
 
   std::stringstream ss;
   ss << nSignals << ( nSignals == 1 ? " signal " : " signals " )
@@ -277,9 +289,8 @@ void CbmStsDigitize::Finish() {
     LOG(info) << GetName() << ": " << BufferStatus();
     LOG(info) << GetName() << ": Processing analogue buffers";
 
-    // --- Loop over all modules in the setup and process their buffers
-    for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++)
-      fSetup->GetModule(iModule)->ProcessAnalogBuffer(-1.);
+    // --- Process the buffers of all modules
+    ProcessAnalogBuffers(-1.);
 
     // --- Screen output
     stringstream ss;
@@ -325,6 +336,37 @@ void CbmStsDigitize::Finish() {
 
 
 
+// -----   Find the sensor of a StsPoint   ---------------------------------
+CbmStsSensor* CbmStsDigitize::FindSensor(Int_t address,
+                                         Int_t& iModule) const {
+
+  // --- Module from the lookup table of the setup, sensor as its daughter
+  CbmStsSensor* sensor = nullptr;
+  iModule = fSetup->GetModuleIndex(address);
+  if ( iModule >= 0 ) sensor = static_cast<CbmStsSensor*>
+    (fSetup->GetModule(iModule)->GetDaughter(
+        CbmStsAddress::GetElementId(address, kStsSensor)));
+  if ( ! sensor ) {
+  	stringstream ss;
+    ss << GetName() << ": No sensor for address " << address;
+    ss << "Unit " << CbmStsAddress::GetElementId(address, kStsUnit);
+    ss << " Ladder " << CbmStsAddress::GetElementId(address, kStsLadder);
+    ss << " Half-ladder " << CbmStsAddress::GetElementId(address, kStsHalfLadder);
+    ss << " Module " << CbmStsAddress::GetElementId(address, kStsModule);
+    ss << " Sensor " << CbmStsAddress::GetElementId(address, kStsSensor);
+    LOG(info) << ss.str();
+  }
+  if ( ! sensor ) LOG(error) << GetName() << ": Sensor of StsPoint not found!";
+  assert(sensor);
+  LOG(debug2) << GetName() << ": Sending point to sensor "
+      << sensor->GetName() << " ( " << sensor->GetAddress() << " ) ";
+
+  return sensor;
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Get parameter container from runtime DB   -----------------------
 void CbmStsDigitize::SetParContainers()
 {
@@ -362,6 +404,10 @@ InitStatus CbmStsDigitize::Init() {
   if ( fDigiPar->GetGenerateNoise() && fEventMode )
     fDigiPar->SetGenerateNoise(kFALSE);
 
+  // Random seed; taken from gRandom if not set by the user
+  if ( ! fRandomSeedSet ) fRandomSeed = gRandom->GetSeed();
+  LOG(info) << GetName() << ": Random seed " << fRandomSeed;
+
   // Instantiate and set StsPhysics
   CbmStsPhysics::Instance()->SetProcesses(fDigiPar->GetELossModel(),
                                           fDigiPar->GetUseLorentzShift(),
@@ -375,6 +421,10 @@ InitStatus CbmStsDigitize::Init() {
   // Get and initialise the STS setup interface
   InitSetup();
 
+  // Load the particle table, which is otherwise read on first use, possibly
+  // from concurrent threads
+  TDatabasePDG::Instance()->GetParticle(211);
+
   // --- Get FairRootManager instance
   FairRootManager* ioman = FairRootManager::Instance();
   assert ( ioman );
@@ -444,9 +494,18 @@ void CbmStsDigitize::ProcessAnalogBuffers(Double_t readoutTime) {
   LOG(debug) << GetName() << ": Processing analog buffers with readout "
       << "time " << readoutTime << " ns";
 
-  // --- Loop over all modules in the setup and process their buffers
-  for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++)
-    fSetup->GetModule(iModule)->ProcessAnalogBuffer(readoutTime);
+  // --- Read out the buffers of all modules. Each module is handled by
+  // --- one thread and keeps its digis in its own readout buffer. The
+  // --- random numbers for the time smearing come from per-signal streams.
+  Int_t nModules = fSetup->GetNofModules();
+  #pragma omp parallel for schedule(dynamic) if(fParallelism_enabled)
+  for (Int_t iModule = 0; iModule < nModules; iModule++)
+    fSetup->GetModule(iModule)->ReadOutAnalogBuffer(readoutTime);
+
+  // --- Send the digis in module order; the output is thus the same as
+  // --- for a serial readout.
+  for (Int_t iModule = 0; iModule < nModules; iModule++)
+    fSetup->GetModule(iModule)->SendDigis();
 
   // --- Debug output
   stringstream ss;
@@ -472,11 +531,16 @@ void CbmStsDigitize::ProcessMCEvent() {
       << " from input " << fCurrentInput << " at t = " << fCurrentEventTime
       << " ns with " << fPoints->GetEntriesFast() << " StsPoints ";
 
-  // --- Loop over all StsPoints and execute the ProcessPoint method
+  // --- Assign the StsPoints to their modules. Sensor and magnetic field
+  // --- are looked up here, serially, since the field map is not
+  // --- thread-safe.
   assert ( fPoints );
+  Int_t nModules = fSetup->GetNofModules();
+  if ( Int_t(fModulePoints.size()) != nModules )
+    fModulePoints.resize(nModules);
+  for (auto& modulePoints : fModulePoints) modulePoints.clear();
   for (Int_t iPoint=0; iPoint<fPoints->GetEntriesFast(); iPoint++) {
     const CbmStsPoint* point = (const CbmStsPoint*) fPoints->At(iPoint);
-    CbmLink* link = new CbmLink(1., iPoint, fCurrentMCEntry, fCurrentInput);
 
     // --- Discard secondaries if the respective flag is set
     if ( fDigiPar->GetDiscardSecondaries() ) {
@@ -488,58 +552,74 @@ void CbmStsDigitize::ProcessMCEvent() {
       } //? MC track present
     } //? discard secondaries
 
-    ProcessPoint(point, fCurrentEventTime, link);
+    // --- Debug
+    if ( FairLogger::GetLogger()->IsLogNeeded(fair::Severity::debug2) )
+      point->Print();
+    LOG(debug2) << GetName() << ": Point coordinates: in ("
+        << point->GetXIn() << ", " << point->GetYIn() << ", "
+        << point->GetZIn() << "), out (" << point->GetXOut() << ", "
+        << point->GetYOut() << ", " << point->GetZOut() << ")";
+
+    // --- Module, sensor and magnetic field
+    Int_t iModule = -1;
+    ModulePoint modulePoint;
+    modulePoint.fIndex = iPoint;
+    modulePoint.fSensor = FindSensor(point->GetDetectorID(), iModule);
+    CbmStsSensor::PointField(point, modulePoint.fField);
+    fModulePoints[iModule].push_back(modulePoint);
     fNofPoints++;
-    delete link;
   }  //# StsPoints
 
+  // --- Process the points module by module
+  Int_t nSignalsF = 0;
+  Int_t nSignalsB = 0;
+  ProcessModulePoints(fPoints, fModulePoints, fCurrentEventTime,
+                      fCurrentMCEntry, fCurrentInput, nSignalsF, nSignalsB);
+  fNofSignalsF += nSignalsF;
+  fNofSignalsB += nSignalsB;
+
 }
 // -------------------------------------------------------------------------
 
 
 
-// -----  Process a StsPoint   ---------------------------------------------
-void CbmStsDigitize::ProcessPoint(const CbmStsPoint* point,
-                                  Double_t eventTime, CbmLink* link) {
-
-  // Debug
-  if ( FairLogger::GetLogger()->IsLogNeeded(fair::Severity::debug2) ) point->Print();
-  LOG(debug2) << GetName() << ": Point coordinates: in (" << point->GetXIn()
-			            << ", " << point->GetYIn() << ", " << point->GetZIn() << ")"
-			            << ", out (" << point->GetXOut() << ", " << point->GetYOut()
-			            << ", " << point->GetZOut() << ")";
-
-
-  // --- Get the sensor the point is in
-  Int_t address = point->GetDetectorID();
-  CbmStsSensor* sensor = dynamic_cast<CbmStsSensor*>
-  (fSetup->GetElement(address, kStsSensor));
-  if ( ! sensor ) {
-  	stringstream ss;
-    ss << GetName() << ": No sensor for address " << address;
-    ss << "Unit " << CbmStsAddress::GetElementId(address, kStsUnit);
-    ss << " Ladder " << CbmStsAddress::GetElementId(address, kStsLadder);
-    ss << " Half-ladder " << CbmStsAddress::GetElementId(address, kStsHalfLadder);
-    ss << " Module " << CbmStsAddress::GetElementId(address, kStsModule);
-    ss << " Sensor " << CbmStsAddress::GetElementId(address, kStsSensor);
-    LOG(info) << ss.str();
-  }
-  if ( ! sensor ) LOG(error) << GetName() << ": Sensor of StsPoint not found!";
-  assert(sensor);
-  LOG(debug2) << GetName() << ": Sending point to sensor "
-      << sensor->GetName() << " ( " << sensor->GetAddress() << " ) ";
-
-  // --- Process the point on the sensor
-  Int_t status = sensor->ProcessPoint(point, eventTime, link);
-
-  // --- Statistics
-  Int_t nSignalsF = status / 1000;
-  Int_t nSignalsB = status - 1000 * nSignalsF;
-  LOG(debug2) << GetName() << ": Produced signals: "
-      << nSignalsF + nSignalsB << " ( " << nSignalsF << " / "
-      << nSignalsB << " )";
-  fNofSignalsF += nSignalsF;
-  fNofSignalsB += nSignalsB;
+// -----   Process the points of the modules   -----------------------------
+void CbmStsDigitize::ProcessModulePoints(const TClonesArray* points,
+    const std::vector<std::vector<ModulePoint>>& modulePoints,
+    Double_t eventTime, Int_t entry, Int_t input,
+    Int_t& nSignalsF, Int_t& nSignalsB) {
+
+  // --- Each module by one thread, the points in the given order. The
+  // --- analogue buffer of a module is thus filled as in serial processing.
+  assert( points );
+  Int_t nModules = modulePoints.size();
+  Int_t nF = 0;
+  Int_t nB = 0;
+  #pragma omp parallel for schedule(dynamic) reduction(+:nF,nB) \
+                           if(fParallelism_enabled)
+  for (Int_t iModule = 0; iModule < nModules; iModule++) {
+    for (const auto& modulePoint : modulePoints[iModule]) {
+      const CbmStsPoint* point =
+          (const CbmStsPoint*) points->UncheckedAt(modulePoint.fIndex);
+      CbmLink link(1., modulePoint.fIndex, entry, input);
+
+      // --- Process the point on the sensor
+      Int_t status = modulePoint.fSensor->ProcessPoint(point, eventTime,
+                                                       &link,
+                                                       modulePoint.fField);
+
+      // --- Statistics
+      Int_t nPointSignalsF = status / 1000;
+      Int_t nPointSignalsB = status - 1000 * nPointSignalsF;
+      LOG(debug2) << GetName() << ": Produced signals: "
+          << nPointSignalsF + nPointSignalsB << " ( " << nPointSignalsF
+          << " / " << nPointSignalsB << " )";
+      nF += nPointSignalsF;
+      nB += nPointSignalsB;
+    } //# points in module
+  } //# modules
+  nSignalsF = nF;
+  nSignalsB = nB;
 
 }
 // -------------------------------------------------------------------------
@@ -7,6 +7,7 @@
 #define CBMSTSDIGITIZE_H 1
 
 #include <map>
+#include <vector>
 #include "TStopwatch.h"
 
 #include "CbmDigitize.h"
@@ -17,6 +18,7 @@
 
 class TClonesArray;
 class CbmStsPoint;
+class CbmStsSensor;
 class CbmStsSetup;
 
 /** @class CbmStsDigitize
@@ -47,6 +49,14 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   virtual ~CbmStsDigitize();
 
 
+  /** MC point assigned to a module for processing **/
+  struct ModulePoint {
+    Int_t fIndex;             ///< Index of CbmStsPoint in the input array
+    CbmStsSensor* fSensor;    ///< Sensor the point is in
+    Double_t fField[3];       ///< Magnetic field at the point [kG]
+  };
+
+
   /** Create a digi and send it for further processing
    ** @param address   Unique channel address
    ** @param time      Absolute time [ns]
@@ -86,8 +96,12 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
 
   /** Get energy loss model
   ** @param eLossModel       0 = ideal, 1 = uniform, 2 = fluctuations
+  **
+  ** Before Init, the model set by SetProcesses is returned.
   **/
-  Int_t GetELossModel() const{return fDigiPar->GetELossModel();}
+  Int_t GetELossModel() const {
+    return ( fDigiPar ? fDigiPar : &fUserPar )->GetELossModel();
+  }
 
 
   /** Get number of signals front side **/
@@ -98,6 +112,12 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   Int_t GetNofSignalsB() const {return fNofSignalsB;}
 
 
+  /** @brief Random seed of the digitisation
+   ** @value Key of the random streams (CbmStsRandom)
+   **/
+  ULong64_t GetRandomSeed() const { return fRandomSeed; }
+
+
   /** Initialise the STS setup and the parameters **/
   void InitSetup();
 
@@ -169,6 +189,39 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   void SetModuleParameterFile(const char* fileName);
 
 
+  /** @brief Enable parallel processing of the modules
+   ** @param choice  If kTRUE, the modules are processed concurrently
+   **
+   ** Concerns the charge generation from the MC points and the readout of
+   ** the analogue buffers. The output is the same as for serial processing
+   ** (see SetRandomSeed).
+   **/
+  void SetParallelism(Bool_t choice = kTRUE) {
+    fParallelism_enabled = choice;
+  }
+
+
+  /** @brief Produce the analogue signals of StsPoints, module by module
+   ** @param points        Array of CbmStsPoint
+   ** @param modulePoints  Points of each module, with sensor and field
+   ** @param eventTime     Event start time [ns]
+   ** @param entry         MC entry (event number) of the points
+   ** @param input         MC input number of the points
+   ** @param[out] nSignalsF  Number of signals on the front sides
+   ** @param[out] nSignalsB  Number of signals on the back sides
+   **
+   ** The points of each module are processed in the given order by one
+   ** thread; modules are processed concurrently if parallelism is enabled.
+   ** Since a module and its sensors are accessed by one thread only, the
+   ** charges are registered without locks, and the analogue buffers are
+   ** the same as for serial processing.
+   **/
+  void ProcessModulePoints(const TClonesArray* points,
+                           const std::vector<std::vector<ModulePoint>>& modulePoints,
+                           Double_t eventTime, Int_t entry, Int_t input,
+                           Int_t& nSignalsF, Int_t& nSignalsB);
+
+
   /** Set physics processes
    ** @param eLossModel       Energy loss model
    ** @param useLorentzShift  If kTRUE, activate Lorentz shift
@@ -185,6 +238,21 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   		            Bool_t generateNoise = kFALSE);
 
 
+  /** @brief Set the random seed of the digitisation
+   ** @param seed  Key of the random streams (CbmStsRandom)
+   **
+   ** The random numbers for charge generation, noise and time smearing
+   ** are taken from streams identified by the physical entities they
+   ** belong to. For a given seed, the output is thus independent of the
+   ** processing order and of the number of threads. If no seed is set,
+   ** it is taken from gRandom at initialisation.
+   **/
+  void SetRandomSeed(ULong64_t seed) {
+    fRandomSeed = seed;
+    fRandomSeedSet = kTRUE;
+  }
+
+
   /** @brief Set the file name with sensor conditions
    ** @param fileName  File name with sensor conditions
    **
@@ -264,6 +332,12 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   Double_t fNofNoiseTot;    ///< Total number of noise digis
   Double_t fTimeTot;        ///< Total execution time
 
+  Bool_t fParallelism_enabled;  ///< Process modules concurrently
+  ULong64_t fRandomSeed;        ///< Key of the random streams
+  Bool_t fRandomSeedSet;        ///< Flag whether the seed was set by the user
+
+  std::vector<std::vector<ModulePoint>> fModulePoints;  //! Points per module
+
 
   /** @brief Number of signals in the analogue buffers
    ** @value nSignals  Sum of number of signals in all modules
@@ -282,6 +356,14 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   virtual void Finish();
 
 
+  /** @brief Find the sensor of a MC point
+   ** @param[in]  address  Sensor address of the point
+   ** @param[out] iModule  Index of the module in the setup
+   ** @return Pointer to sensor
+   **/
+  CbmStsSensor* FindSensor(Int_t address, Int_t& iModule) const;
+
+
   /** Get event information
    ** @param[out]  eventNumber  Number of MC event
    ** @param[out]  inputNumber  Number of input
@@ -309,16 +391,13 @@ class CbmStsDigitize : public CbmDigitize<CbmStsDigi>
   void ProcessAnalogBuffers(Double_t readoutTime);
 
 
-  /** Process StsPoints from MCEvent **/
-  void ProcessMCEvent();
-
-
-  /** Process one MCPoint
-   ** @param point  Pointer to CbmStsPoint to be processed
-   ** @param link   Link to MCPoint
+  /** @brief Process StsPoints from MCEvent
+   **
+   ** The points are first assigned to their modules, with sensor and
+   ** magnetic field looked up serially, and then processed by
+   ** ProcessModulePoints.
    **/
-  void ProcessPoint(const CbmStsPoint* point, Double_t eventTime = 0.,
-  		              CbmLink* link = NULL);
+  void ProcessMCEvent();
 
 
   /** @brief Reset event counters **/
@@ -0,0 +1,92 @@
+/** @file CbmStsInterpolationTable.cxx
+ **/
+
+#include "CbmStsInterpolationTable.h"
+
+#include <algorithm>
+
+
+// -----   Build the grid   ------------------------------------------------
+Bool_t CbmStsInterpolationTable::Build(const std::map<Double_t,
+                                       Double_t>& table, Bool_t logGrid,
+                                       Double_t tolerance, Int_t maxPoints) {
+
+  assert( ! table.empty() );
+  Double_t xFirst = table.begin()->first;
+  Double_t xLast = table.rbegin()->first;
+  fLogGrid = ( logGrid && xFirst > 0. );
+  fU0 = ( fLogGrid ? std::log(xFirst) : xFirst );
+  Double_t u1 = ( fLogGrid ? std::log(xLast) : xLast );
+
+  // --- Degenerate table: constant value
+  if ( table.size() == 1 || u1 <= fU0 ) {
+    fValues.assign(2, table.begin()->second);
+    fInvStep = 0.;
+    fLast = 0.;
+    fMaxDeviation = 0.;
+    return kTRUE;
+  }
+
+  // --- Start with as many points as in the map and refine by halving the
+  // --- grid spacing until the tolerance is met
+  Int_t nPoints = std::max(Int_t(table.size()), 2);
+  while ( kTRUE ) {
+    Double_t step = ( u1 - fU0 ) / Double_t(nPoints - 1);
+    fInvStep = 1. / step;
+    fLast = Double_t(nPoints - 1);
+    fValues.resize(nPoints);
+    for (Int_t point = 0; point < nPoints; point++) {
+      Double_t u = fU0 + Double_t(point) * step;
+      Double_t x = ( fLogGrid ? std::exp(u) : u );
+      if ( point == 0 ) x = xFirst;
+      if ( point == nPoints - 1 ) x = xLast;
+      fValues[point] = Interpolate(table, x);
+    }
+
+    // --- Deviation at the map points and at the grid cell centres
+    fMaxDeviation = 0.;
+    auto check = [this, &table] (Double_t x) {
+      Double_t ref = Interpolate(table, x);
+      Double_t dev = std::fabs(Get(x) - ref);
+      if ( ref != 0. ) dev /= std::fabs(ref);
+      fMaxDeviation = std::max(fMaxDeviation, dev);
+    };
+    for (const auto& entry : table) check(entry.first);
+    for (Int_t point = 0; point < nPoints - 1; point++) {
+      Double_t u = fU0 + ( Double_t(point) + 0.5 ) * step;
+      check( fLogGrid ? std::exp(u) : u );
+    }
+
+    if ( fMaxDeviation <= tolerance ) return kTRUE;
+    if ( 2 * nPoints - 1 > maxPoints ) return kFALSE;
+    nPoints = 2 * nPoints - 1;
+  }
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Linear interpolation in a data map   ----------------------------
+Double_t CbmStsInterpolationTable::Interpolate(const std::map<Double_t,
+                                               Double_t>& table, Double_t x) {
+
+  auto it = table.lower_bound(x);
+
+  // Input value smaller than or equal to first table entry:
+  // return first value
+  if ( it == table.begin() ) return it->second;
+
+  // Input value larger than last table entry: return last value
+  if ( it == table.end() ) return (--it)->second;
+
+  // Else: interpolate from table values
+  Double_t x2 = it->first;
+  Double_t v2 = it->second;
+  it--;
+  Double_t x1 = it->first;
+  Double_t v1 = it->second;
+  return ( v1 + ( x - x1 ) * ( v2 - v1 ) / ( x2 - x1 ) );
+
+}
+// -------------------------------------------------------------------------
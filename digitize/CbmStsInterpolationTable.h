@@ -0,0 +1,137 @@
+/** @file CbmStsInterpolationTable.h
+ **/
+
+#ifndef CBMSTSINTERPOLATIONTABLE_H
+#define CBMSTSINTERPOLATIONTABLE_H 1
+
+#include <cassert>
+#include <cmath>
+#include <map>
+#include <vector>
+#include "Rtypes.h"
+
+
+/** @class CbmStsInterpolationTable
+ ** @brief Data table with constant-time linear interpolation
+ **
+ ** The table is built from a map x -> y, which is interpreted as a
+ ** piecewise linear function with constant continuation outside of the
+ ** tabulated range. It is resampled on an equidistant grid, either in x
+ ** (uniform grid) or in log(x) (log grid), such that a lookup is an index
+ ** computation plus one linear interpolation instead of a tree search.
+ **
+ ** The grid is refined until the relative deviation from the map
+ ** interpolation is below the tolerance given to Build(). The deviation is
+ ** checked at the map points and at the centres of the grid cells. If the
+ ** map points are equidistant in the chosen variable, the grid reproduces
+ ** them and the lookup is exact up to rounding.
+ **/
+class CbmStsInterpolationTable
+{
+
+  public:
+
+    /** @brief Constructor **/
+    CbmStsInterpolationTable() : fLogGrid(kFALSE), fU0(0.), fInvStep(0.),
+                                 fLast(0.), fValues(), fMaxDeviation(0.) { }
+
+
+    /** @brief Build the grid from a data map
+     ** @param table      Data map x -> y (not empty)
+     ** @param logGrid    If kTRUE, the grid is equidistant in log(x)
+     ** @param tolerance  Maximal relative deviation from the map interpolation
+     ** @param maxPoints  Maximal number of grid points
+     ** @return kFALSE if the tolerance could not be reached with maxPoints
+     **
+     ** A log grid requires positive x values; else, a uniform grid is used.
+     **/
+    Bool_t Build(const std::map<Double_t, Double_t>& table, Bool_t logGrid,
+                 Double_t tolerance = 1.e-4, Int_t maxPoints = 16384);
+
+
+    /** @brief Interpolated value
+     ** @param x  Argument
+     ** @return Interpolated value
+     **/
+    Double_t Get(Double_t x) const {
+      assert( fValues.size() > 1 );
+      Int_t bin = 0;
+      Double_t frac = GetPosition(x, bin);
+      return fValues[bin] + frac * ( fValues[bin+1] - fValues[bin] );
+    }
+
+
+    /** @brief Interpolated values for an array of arguments
+     ** @param n       Number of values
+     ** @param x       Array of arguments
+     ** @param result  Array of results (size n)
+     **
+     ** Each lookup is a direct index computation without search. The only
+     ** branch, on the grid type (linear or logarithmic), is the same for
+     ** all elements, such that the compiler can hoist it out of the loop.
+     **/
+    void Get(Int_t n, const Double_t* x, Double_t* result) const {
+      assert( fValues.size() > 1 );
+      const Double_t* values = fValues.data();
+      for (Int_t index = 0; index < n; index++) {
+        Int_t bin = 0;
+        Double_t frac = GetPosition(x[index], bin);
+        result[index] = values[bin] + frac * ( values[bin+1] - values[bin] );
+      }
+    }
+
+
+    /** @brief Maximal relative deviation from the map interpolation **/
+    Double_t GetMaxDeviation() const { return fMaxDeviation; }
+
+
+    /** @brief Number of grid points **/
+    Int_t GetNofPoints() const { return fValues.size(); }
+
+
+    /** @brief Linear interpolation in a data map
+     ** @param table  Data map x -> y (not empty)
+     ** @param x      Argument
+     ** @return Interpolated value
+     **
+     ** If x is outside of the tabulated range, the first or last value is
+     ** returned. This is the reference for the grid.
+     **/
+    static Double_t Interpolate(const std::map<Double_t, Double_t>& table,
+                                Double_t x);
+
+
+    /** @brief Check whether the grid is in log(x) **/
+    Bool_t IsLogGrid() const { return fLogGrid; }
+
+
+  private:
+
+    Bool_t fLogGrid;                  ///< Grid equidistant in log(x)
+    Double_t fU0;                     ///< First grid point (x or log(x))
+    Double_t fInvStep;                ///< Inverse grid spacing
+    Double_t fLast;                   ///< Position of the last grid point
+    std::vector<Double_t> fValues;    ///< Values at the grid points
+    Double_t fMaxDeviation;           ///< Max. relative deviation from map
+
+
+    /** @brief Grid cell and position inside the cell
+     ** @param x    Argument
+     ** @param bin  Grid cell (return value)
+     ** @return Fractional position in the cell (0 to 1)
+     **
+     ** Arguments outside of the grid are clamped to its ends.
+     **/
+    Double_t GetPosition(Double_t x, Int_t& bin) const {
+      Double_t u = ( fLogGrid ? std::log(x) : x );
+      Double_t pos = ( u - fU0 ) * fInvStep;
+      pos = ( pos > 0. ? pos : 0. );     // also for NaN from log(x <= 0)
+      pos = ( pos < fLast ? pos : fLast );
+      bin = Int_t(pos);
+      bin = ( bin < Int_t(fValues.size()) - 2 ? bin : Int_t(fValues.size()) - 2 );
+      return pos - Double_t(bin);
+    }
+
+};
+
+#endif
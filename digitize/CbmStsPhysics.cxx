@@ -12,9 +12,9 @@
 #include <sstream>
 #include "TDatabasePDG.h"
 #include "TMath.h"
-#include "TRandom.h"
 #include "TSystem.h"
 #include "FairLogger.h"
+#include "CbmStsRandom.h"
 
 
 using std::ifstream;
@@ -29,6 +29,7 @@ CbmStsPhysics* CbmStsPhysics::fgInstance    = nullptr;
 const Double_t CbmStsPhysics::fgkSiCharge   = 14.;
 const Double_t CbmStsPhysics::fgkSiDensity  = 2.336;        // g/cm^3
 const Double_t CbmStsPhysics::fgkProtonMass = 0.938272081;  // GeV
+const Double_t CbmStsPhysics::fgkTableTolerance = 1.e-4;
 // -------------------------------------------------------------------------
 
 
@@ -49,7 +50,10 @@ CbmStsPhysics::CbmStsPhysics() :
   fUrbanR(0.),
   fStoppingElectron(),
   fStoppingProton(),
-  fLandauWidth()
+  fLandauWidth(),
+  fStoppingElectronGrid(),
+  fStoppingProtonGrid(),
+  fLandauWidthGrid()
 {
   // --- Read the energy loss data tables
   LOG(info) << "Instantiating STS Physics... ";
@@ -127,7 +131,8 @@ Double_t CbmStsPhysics::ElectricField(Double_t vBias, Double_t vFd,
 
 // -----   Energy loss from fluctuation model   ----------------------------
 Double_t CbmStsPhysics::EnergyLoss(Double_t dz, Double_t mass, Double_t eKin,
-                                   Double_t dedx) const {
+                                   Double_t dedx,
+                                   CbmStsRandom& random) const {
 
   // Gamma and beta
   Double_t gamma = (eKin + mass) / mass;
@@ -151,14 +156,14 @@ Double_t CbmStsPhysics::EnergyLoss(Double_t dz, Double_t mass, Double_t eKin,
 
   // Sample number of processes Poissonian energy loss distribution
   // (PHYS333 2.4 eq. (6))
-  Int_t n1 = gRandom->Poisson( sigma1 * dz );
-  Int_t n2 = gRandom->Poisson( sigma2 * dz );
-  Int_t n3 = gRandom->Poisson( sigma3 * dz );
+  Int_t n1 = random.Poisson( sigma1 * dz );
+  Int_t n2 = random.Poisson( sigma2 * dz );
+  Int_t n3 = random.Poisson( sigma3 * dz );
 
   // Ion energy loss (PHYS333 2.4 eq. (12))
   Double_t eLossIon = 0.;
   for (Int_t j = 1; j <= n3; j++) {
-    Double_t uni = gRandom->Uniform(1.);
+    Double_t uni = random.Rndm();
     eLossIon += fUrbanI
         / ( 1. - uni * fUrbanEmax / ( fUrbanEmax + fUrbanI ) );
   }
@@ -180,42 +185,24 @@ CbmStsPhysics* CbmStsPhysics::Instance() {
 
 
 
-// -----   Interpolate a value from a data table   -------------------------
-Double_t CbmStsPhysics::InterpolateDataTable(Double_t eEquiv,
-                                             map<Double_t, Double_t>& table) {
+// -----   Resample a data table on a grid   ------------------------------
+void CbmStsPhysics::BuildGrid(const map<Double_t, Double_t>& table,
+                              CbmStsInterpolationTable& grid,
+                              Bool_t logGrid, const char* name) {
 
-  std::map<Double_t, Double_t>::iterator it = table.lower_bound(eEquiv);
-
-  // Input value smaller than or equal to first table entry:
-  // return first value
-  if ( it == table.begin() ) return it->second;
-
-  // Input value larger than last table entry: return last value
-  if ( it == table.end() ) return (--it)->second;
-
-  // Else: interpolate from table values
-  Double_t e2 = it->first;
-  Double_t v2 = it->second;
-  it--;
-  Double_t e1 = it->first;
-  Double_t v1 = it->second;
-  return ( v1 + ( eEquiv - e1 ) * ( v2 - v1 ) / ( e2 - e1 ) );
+  if ( table.empty() ) return;
+  if ( ! grid.Build(table, logGrid, fgkTableTolerance) )
+    LOG(warn) << "StsPhysics: Grid for " << name << " misses the tolerance "
+        << fgkTableTolerance;
+  LOG(info) << "StsPhysics: " << setw(5) << right << grid.GetNofPoints()
+      << ( grid.IsLogGrid() ? " log" : " uniform" ) << " grid points for "
+      << name << ", max. rel. deviation " << grid.GetMaxDeviation();
 
 }
 // -------------------------------------------------------------------------
 
 
 
-// -----   Landau Width   ------------------------------------------------
-Double_t CbmStsPhysics::LandauWidth(Double_t mostProbableCharge) {
-
-  // --- Get interpolated value from the data table
-  return InterpolateDataTable(mostProbableCharge, fLandauWidth);
-}
-// -------------------------------------------------------------------------
-
-
-
 // -----    Particle charge for PDG PID   ----------------------------------
 Double_t CbmStsPhysics::ParticleCharge(Int_t pid) {
 
@@ -310,6 +297,9 @@ void CbmStsPhysics::ReadDataTablesLandauWidth() {
   else
     LOG(fatal) << "StsPhysics: Could not read from " << errFileName;
 
+  // --- Grid for constant-time lookup
+  BuildGrid(fLandauWidth, fLandauWidthGrid, kFALSE, "Landau width");
+
 }
 // -------------------------------------------------------------------------
 
@@ -368,6 +358,13 @@ void CbmStsPhysics::ReadDataTablesStoppingPower() {
   else
     LOG(fatal) << "StsPhysics: Could not read from " << pFileName;
 
+  // --- Grids for constant-time lookup. The NIST energies are roughly
+  // --- equidistant in log(E).
+  BuildGrid(fStoppingElectron, fStoppingElectronGrid, kTRUE,
+            "electron stopping power");
+  BuildGrid(fStoppingProton, fStoppingProtonGrid, kTRUE,
+            "proton stopping power");
+
 }
 // -------------------------------------------------------------------------
 
@@ -434,10 +431,10 @@ Double_t CbmStsPhysics::StoppingPower(Double_t energy,
   // --- Get interpolated value from data table
   Double_t stopPower = -1.;
   if ( isElectron )
-    stopPower = InterpolateDataTable(energy, fStoppingElectron);
+    stopPower = fStoppingElectronGrid.Get(energy);
   else {
     Double_t eEquiv = energy * fgkProtonMass / mass; // equiv. proton energy
-    stopPower = InterpolateDataTable(eEquiv, fStoppingProton);
+    stopPower = fStoppingProtonGrid.Get(eEquiv);
   }
 
   // --- Calculate stopping power (from specific SP and density of silicon)
@@ -12,6 +12,9 @@
 #include <map>
 #include "Rtypes.h"
 #include "TObject.h"
+#include "CbmStsInterpolationTable.h"
+
+class CbmStsRandom;
 
 
 /** @enum ECbmELossModel
@@ -83,13 +86,16 @@ class CbmStsPhysics : public TObject {
      ** @param mass  Particle mass [GeV]
      ** @param eKin  Kinetic energy [GeV]
      ** @param dedx  Average specific energy loss [GeV/cm]
+     ** @param random  Random stream to sample from
      ** @return Energy loss in the layer [GeV]
      **
      ** The energy loss is sampled from the Urban fluctuation model
      ** described in the GEANT3 manual (PHYS333 2.4, pp. 262-264).
+     ** The random numbers are taken from the stream of the caller only,
+     ** such that the method can be called concurrently.
      */
-    Double_t EnergyLoss(Double_t dz, Double_t mass,
-                        Double_t eKin, Double_t dedx) const;
+    Double_t EnergyLoss(Double_t dz, Double_t mass, Double_t eKin,
+                        Double_t dedx, CbmStsRandom& random) const;
 
 
     /** @brief Flag for generation of inter-event noise
@@ -116,8 +122,24 @@ class CbmStsPhysics : public TObject {
      ** in ultra-relativistic case
      ** @param mostProbableCharge [e]
      ** @return half width [e]
+     **
+     ** The value is interpolated from a grid built at load time; its
+     ** relative deviation from the interpolation in the data table is
+     ** below fgkTableTolerance.
      **/
-    Double_t LandauWidth(Double_t mostProbableCharge);
+    Double_t LandauWidth(Double_t mostProbableCharge) const {
+      return fLandauWidthGrid.Get(mostProbableCharge);
+    }
+
+
+    /** @brief Landau width for an array of charges
+     ** @param n       Number of values
+     ** @param charge  Array of most probable charges [e]
+     ** @param width   Array of half widths [e] (size n)
+     **/
+    void LandauWidth(Int_t n, const Double_t* charge, Double_t* width) const {
+      fLandauWidthGrid.Get(n, charge, width);
+    }
 
 
     /** @brief Energy for electron-hole pair creation in silicon
@@ -232,6 +254,7 @@ class CbmStsPhysics : public TObject {
     static const Double_t fgkSiCharge;     ///< Silicon atomic charge number
     static const Double_t fgkSiDensity;    ///< Silicon density [g/cm^3]
     static const Double_t fgkProtonMass;   ///< proton mass [GeV]
+    static const Double_t fgkTableTolerance; ///< Max. rel. deviation of grids
 
     // --- Process flags
     ECbmELossModel  fELossModel;
@@ -256,6 +279,11 @@ class CbmStsPhysics : public TObject {
     // --- Data tables for width of Landau distribution
     std::map<Double_t, Double_t> fLandauWidth; ///< q [e] -> width [e]
 
+    // --- Data tables resampled on grids for constant-time lookup
+    CbmStsInterpolationTable fStoppingElectronGrid; //! log grid in E
+    CbmStsInterpolationTable fStoppingProtonGrid;   //! log grid in E
+    CbmStsInterpolationTable fLandauWidthGrid;      //! uniform grid in q
+
 
 
     // =====   Private member functions   ========================================
@@ -272,15 +300,15 @@ class CbmStsPhysics : public TObject {
     CbmStsPhysics operator=(const CbmStsPhysics&) = delete;
 
 
-    /** @brief Interpolate a value from the data tables
-     ** @param eKin   Equivalent kinetic energy [GeV]
-     ** @param table  Reference to data map (fStoppingElectron or fStoppingProton)
-     ** @return Interpolated value from data table
-     **
-     ** The eEquiv is below the tabulated range, the first table value is
-     ** returned; if it is above the range, the last value is returned.
+    /** @brief Resample a data table on a grid
+     ** @param table    Data map
+     ** @param grid     Grid to be built
+     ** @param logGrid  If kTRUE, grid is equidistant in log(x)
+     ** @param name     Table name for the log
      **/
-    Double_t InterpolateDataTable(Double_t eKin, std::map<Double_t, Double_t>& table);
+    void BuildGrid(const std::map<Double_t, Double_t>& table,
+                   CbmStsInterpolationTable& grid, Bool_t logGrid,
+                   const char* name);
 
 
     /** @brief Read stopping power data table from file **/
@@ -0,0 +1,79 @@
+/** @file CbmStsRandom.cxx
+ **/
+
+#include "CbmStsRandom.h"
+
+
+// -----   Philox4x32-10   -------------------------------------------------
+void CbmStsRandom::Philox(const UInt_t* counter, const UInt_t* key,
+                          UInt_t* result) {
+
+  const ULong64_t mult0 = 0xD2511F53;
+  const ULong64_t mult1 = 0xCD9E8D57;
+  UInt_t c0 = counter[0];
+  UInt_t c1 = counter[1];
+  UInt_t c2 = counter[2];
+  UInt_t c3 = counter[3];
+  UInt_t k0 = key[0];
+  UInt_t k1 = key[1];
+  for (Int_t round = 0; round < 10; round++) {
+    if ( round > 0 ) {
+      k0 += 0x9E3779B9;
+      k1 += 0xBB67AE85;
+    }
+    ULong64_t prod0 = mult0 * c0;
+    ULong64_t prod1 = mult1 * c2;
+    c0 = UInt_t(prod1 >> 32) ^ c1 ^ k0;
+    c2 = UInt_t(prod0 >> 32) ^ c3 ^ k1;
+    c1 = UInt_t(prod1);
+    c3 = UInt_t(prod0);
+  } //# rounds
+  result[0] = c0;
+  result[1] = c1;
+  result[2] = c2;
+  result[3] = c3;
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Poisson-distributed random number   -----------------------------
+Int_t CbmStsRandom::Poisson(Double_t mean) {
+
+  if ( ! ( mean > 0. ) ) return 0;
+
+  // --- Multiplication method for small mean values
+  if ( mean < 10. ) {
+    Double_t limit = std::exp(-mean);
+    Double_t prod = Rndm();
+    Int_t n = 0;
+    while ( prod > limit ) {
+      prod *= Rndm();
+      n++;
+    }
+    return n;
+  } //? small mean
+
+  // --- Transformed rejection with squeeze (PTRS)
+  Double_t sqrtMean = std::sqrt(mean);
+  Double_t logMean = std::log(mean);
+  Double_t b = 0.931 + 2.53 * sqrtMean;
+  Double_t a = -0.059 + 0.02483 * b;
+  Double_t invAlpha = 1.1239 + 1.1328 / ( b - 3.4 );
+  Double_t vr = 0.9277 - 3.6224 / ( b - 2. );
+  while ( kTRUE ) {
+    Double_t u = Rndm() - 0.5;
+    Double_t v = Rndm();
+    Double_t us = 0.5 - std::fabs(u);
+    Double_t k = std::floor( ( 2. * a / us + b ) * u + mean + 0.43 );
+    if ( us >= 0.07 && v <= vr ) return Int_t(k);
+    if ( k < 0. || ( us < 0.013 && v > us ) ) continue;
+    if ( std::log(v) + std::log(invAlpha) - std::log(a / ( us * us ) + b)
+         <= -mean + k * logMean - std::lgamma(k + 1.) )
+      return Int_t(k);
+  } //# trials
+
+  return 0;
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,171 @@
+/** @file CbmStsRandom.h
+ **/
+
+#ifndef CBMSTSRANDOM_H
+#define CBMSTSRANDOM_H 1
+
+#include <cmath>
+#include <cstring>
+#include "Rtypes.h"
+
+
+/** @class CbmStsRandom
+ ** @brief Counter-based random number generator for the STS digitisation
+ **
+ ** Philox4x32-10 (Salmon et al., SC'11): the random numbers are a bijective
+ ** function of a 64-bit key and a 128-bit counter. The key is the random
+ ** seed of the run; the counter consists of a 64-bit stream number and the
+ ** 64-bit number of the block within the stream. Each block gives four
+ ** 32-bit words.
+ **
+ ** A stream is identified by the physical entity it belongs to (e.g. MC
+ ** input, entry and point index), see Stream(). The random numbers of a
+ ** stream thus do not depend on the order in which streams are processed,
+ ** nor on the thread processing them; there is no shared state.
+ **
+ ** The distributions follow the interface of TRandom; the algorithms are
+ ** not the same, so the numbers differ from those of gRandom.
+ **/
+class CbmStsRandom
+{
+
+  public:
+
+    /** @brief Kind of stream, used as first argument of Stream() **/
+    enum EStream {
+      kPointStream = 1,   ///< Charge production by a MC point
+      kNoiseStream = 2,   ///< Noise of a module in a time interval
+      kTimeStream = 3     ///< Time smearing of a digi
+    };
+
+
+    /** @brief Constructor
+     ** @param seed    Key (random seed of the run)
+     ** @param stream  Stream number
+     **/
+    CbmStsRandom(ULong64_t seed = 0, ULong64_t stream = 0) {
+      SetStream(seed, stream);
+    }
+
+
+    /** @brief Bit pattern of a floating-point value, for use in Stream() **/
+    static ULong64_t Bits(Double_t value) {
+      ULong64_t bits = 0;
+      std::memcpy(&bits, &value, sizeof(bits));
+      return bits;
+    }
+
+
+    /** @brief Gaussian random number (Box-Muller)
+     ** @param mean   Mean value
+     ** @param sigma  Standard deviation
+     **/
+    Double_t Gaus(Double_t mean = 0., Double_t sigma = 1.) {
+      Double_t u1 = Rndm();
+      Double_t u2 = Rndm();
+      return mean + sigma * std::sqrt(-2. * std::log(u1))
+          * std::cos(2. * M_PI * u2);
+    }
+
+
+    /** @brief Apply Philox4x32-10 to a counter
+     ** @param[in]  counter  Counter (4 words)
+     ** @param[in]  key      Key (2 words)
+     ** @param[out] result   Random words (4 words)
+     **/
+    static void Philox(const UInt_t* counter, const UInt_t* key,
+                       UInt_t* result);
+
+
+    /** @brief Poisson-distributed random number
+     ** @param mean  Mean value
+     **
+     ** Multiplication method for small mean values, transformed rejection
+     ** with squeeze (PTRS, Hoermann 1993) for large ones.
+     **/
+    Int_t Poisson(Double_t mean);
+
+
+    /** @brief Uniform random number in the open interval (0,1) **/
+    Double_t Rndm() {
+      return ( Double_t(Rndm64() >> 11) + 0.5 ) * ( 1. / 9007199254740992. );
+    }
+
+
+    /** @brief Uniform 64-bit random number **/
+    ULong64_t Rndm64() {
+      if ( fNofBuffered == 0 ) NextBlock();
+      fNofBuffered -= 2;
+      return ( ULong64_t(fBuffer[fNofBuffered + 1]) << 32 )
+          | fBuffer[fNofBuffered];
+    }
+
+
+    /** @brief Start a stream
+     ** @param seed    Key (random seed of the run)
+     ** @param stream  Stream number
+     **/
+    void SetStream(ULong64_t seed, ULong64_t stream) {
+      fKey[0] = UInt_t(seed);
+      fKey[1] = UInt_t(seed >> 32);
+      fCounter[0] = 0;
+      fCounter[1] = 0;
+      fCounter[2] = UInt_t(stream);
+      fCounter[3] = UInt_t(stream >> 32);
+      fNofBuffered = 0;
+    }
+
+
+    /** @brief Stream number from the identifiers of a physical entity
+     ** @param kind  Kind of stream (EStream)
+     ** @param id1,id2,id3  Identifiers (e.g. input, entry, point index)
+     ** @return Stream number
+     **
+     ** The identifiers are combined by a 64-bit mixing function; different
+     ** combinations give different streams with overwhelming probability.
+     **/
+    static ULong64_t Stream(Int_t kind, ULong64_t id1, ULong64_t id2 = 0,
+                            ULong64_t id3 = 0) {
+      ULong64_t hash = Mix(ULong64_t(kind));
+      hash = Mix(hash ^ id1);
+      hash = Mix(hash ^ id2);
+      return Mix(hash ^ id3);
+    }
+
+
+    /** @brief Uniform random number in an interval
+     ** @param x1  Lower edge
+     ** @param x2  Upper edge
+     **/
+    Double_t Uniform(Double_t x1, Double_t x2) {
+      return x1 + ( x2 - x1 ) * Rndm();
+    }
+
+
+  private:
+
+    UInt_t fKey[2];       ///< Key
+    UInt_t fCounter[4];   ///< Block number (0,1) and stream number (2,3)
+    UInt_t fBuffer[4];    ///< Random words of the current block
+    Int_t fNofBuffered;   ///< Unused words in the buffer
+
+
+    /** @brief 64-bit mixing function (finaliser of SplitMix64) **/
+    static ULong64_t Mix(ULong64_t x) {
+      x += 0x9e3779b97f4a7c15ULL;
+      x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+      x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111ebULL;
+      return x ^ ( x >> 31 );
+    }
+
+
+    /** @brief Generate the next block of the stream **/
+    void NextBlock() {
+      Philox(fCounter, fKey, fBuffer);
+      if ( ++fCounter[0] == 0 ) ++fCounter[1];
+      fNofBuffered = 4;
+    }
+
+};
+
+#endif
@@ -6,11 +6,14 @@
 #include "CbmStsSensorDssd.h"
 
 #include <cassert>
+#include <limits>
 #include "CbmStsDigitize.h"
 #include "CbmStsDigitizeParameters.h"
 #include "CbmStsModule.h"
 #include "TClonesArray.h"
+#include "CbmLink.h"
 #include "CbmStsPhysics.h"
+#include "CbmStsRandom.h"
 #include "CbmStsSensorPoint.h"
 #include "CbmStsSetup.h"
 
@@ -22,8 +25,12 @@ using namespace std;
 CbmStsSensorDssd::CbmStsSensorDssd(Int_t address, TGeoPhysicalNode* node,
                                    CbmStsElement* mother) :
               CbmStsSensor(address, node, mother),
-              fDx(0.), fDy(0.), fDz(0.), fIsSet(kFALSE)
+              fDx(0.), fDy(0.), fDz(0.), fIsSet(kFALSE), fRandom()
 {
+  for (Int_t side = 0; side < 2; side++) {
+    fStripFirst[side] = std::numeric_limits<Int_t>::max();
+    fStripLast[side] = -1;
+  }
 }
 // -------------------------------------------------------------------------
 
@@ -32,33 +39,9 @@ CbmStsSensorDssd::CbmStsSensorDssd(Int_t address, TGeoPhysicalNode* node,
 // -----   Cross talk   ----------------------------------------------------
 void CbmStsSensorDssd::CrossTalk(Double_t ctcoeff) {
 
-  for (Int_t side = 0; side < 2; side++) {  // front and back side
-
-    // Number of strips for this side
-    Int_t nStrips = GetNofStrips(side);
-
-    // First strip
-    Double_t qLeft    = 0.;
-    Double_t qCurrent = fStripCharge[side][0];
-    fStripCharge[side][0] =
-        (1. - ctcoeff ) * qCurrent + ctcoeff * fStripCharge[side][1];
-
-    // Strips 1 to n-2
-    for (Int_t strip = 1; strip < nStrips - 1; strip++) {
-      qLeft    = qCurrent;
-      qCurrent = fStripCharge[side][strip];
-      fStripCharge[side][strip] =
-          ctcoeff * ( qLeft + fStripCharge[side][strip+1] ) +
-          ( 1. - 2. * ctcoeff ) * qCurrent;
-    } //# strips
-
-    // Last strip
-    qLeft = qCurrent;
-    qCurrent = fStripCharge[side][nStrips-1];
-    fStripCharge[side][nStrips-1] =
-        ctcoeff * qLeft + ( 1. - ctcoeff ) * qCurrent;
-
-  } //# front and back side
+  for (Int_t side = 0; side < 2; side++)  // front and back side
+    StripCrossTalk(fStripCharge[side].GetArray(), GetNofStrips(side),
+                   fStripFirst[side], fStripLast[side], ctcoeff);
 
 }
 // -------------------------------------------------------------------------
@@ -127,236 +110,86 @@ void CbmStsSensorDssd::CrossTalk(Double_t ctcoeff) {
 */
 
 
-// -----  Hit finding   ----------------------------------------------------
-Int_t CbmStsSensorDssd::FindHits(std::vector<CbmStsCluster*>& clusters,
-                                 TClonesArray* hitArray, CbmEvent* event,
-                                 Double_t tCutInNs,
-																 Double_t tCutInSigma) {
+// -----   Cluster positions at the read-out edge   ------------------------
+void CbmStsSensorDssd::FillEdgePositions(CbmStsHitContext& context) const {
 
-  //LOG(INFO) << "clusters size " << clusters.size();
-  //Int_t hitArraySize = hitArray->GetEntriesFast();
-  //LOG(INFO) << "hit array size" << hitArraySize;
-  //LOG(INFO) << "event" << event;
-  //LOG(INFO) << "tCutInNs" << tCutInNs;
-  //LOG(INFO) << "tCutInSigma" << tCutInSigma;
+  const CbmStsClusterPairing& pairing = context.GetPairing();
+  for (Int_t side = 0; side < 2; side++) {
+    Int_t nClusters = ( side == 0 ? pairing.GetNofFront()
+                                  : pairing.GetNofBack() );
+    std::vector<Double_t>& edgeX = context.GetEdgeX(side);
+    std::vector<Double_t>& edgeError = context.GetEdgeError(side);
+    edgeX.resize(nClusters);
+    edgeError.resize(nClusters);
+    for (Int_t iCluster = 0; iCluster < nClusters; iCluster++) {
+      CbmStsCluster* cluster = ( side == 0 ? pairing.GetFront(iCluster)
+                                           : pairing.GetBack(iCluster) );
+      Int_t clusterSide = -1;
+      GetClusterPosition(cluster->GetPosition(), edgeX[iCluster],
+                         clusterSide);
+      if ( clusterSide != side )
+        LOG(fatal) << GetName() << ": Inconsistent side qualifier "
+        << clusterSide << " for " << ( side == 0 ? "front" : "back" )
+        << " side cluster! ";
+      edgeError[iCluster] = cluster->GetPositionError() * GetPitch(side);
+    } //# clusters
+  } //# sides
 
+}
+// -------------------------------------------------------------------------
 
-  fHits = hitArray;
-  fEvent = event;
-  Int_t nHits = 0;
 
-  Int_t nClusters = clusters.size();
-
-  Int_t nClustersF = 0;
-  Int_t nClustersB = 0;
-
-  //DigisToHits 
-  Double_t maxTimeErrorClustersF = 0.;
-  Double_t maxTimeErrorClustersB = 0.;
 
+// -----  Hand the clusters to the pairing engine   ------------------------
+void CbmStsSensorDssd::FillPairing(const std::vector<CbmStsCluster*>& clusters,
+                                   CbmStsHitContext& context) const {
 
   // --- Sort clusters into front and back side
-  vector<Int_t> frontClusters;
-  vector<Int_t> backClusters;
-  Int_t side  = -1;         // front or back side
-  for (Int_t iCluster = 0; iCluster < nClusters; iCluster++) {
-    CbmStsCluster* cluster = clusters[iCluster];
-    side = GetSide( cluster->GetPosition() );
-
-    if ( side == 0) {
-      frontClusters.push_back(iCluster);
-      nClustersF++;
-      //DigisToHits
-      if ( cluster->GetTimeError() > maxTimeErrorClustersF ) maxTimeErrorClustersF = cluster->GetTimeError();
-    }
-    else if ( side == 1 ) {
-      backClusters.push_back(iCluster);
-      nClustersB++;
-      //DigisToHits
-      if ( cluster->GetTimeError() > maxTimeErrorClustersB ) maxTimeErrorClustersB = cluster->GetTimeError();
-    }
+  CbmStsClusterPairing& pairing = context.GetPairing();
+  pairing.Clear();
+  for (CbmStsCluster* cluster : clusters) {
+    Int_t side = GetSide( cluster->GetPosition() );
+    if ( side == 0 || side == 1 ) pairing.AddCluster(cluster, side);
     else
       LOG(fatal) << GetName() << ": Illegal side qualifier " << side;
   }  // Loop over clusters in module
-  LOG(debug3) << GetName() << ": " << nClusters << " clusters (front "
-      << frontClusters.size() << ", back " << backClusters.size() << ") ";
-
-  // --- Loop over front and back side clusters
-  // DigisToHits
-  Int_t startB = 0;
-  const Double_t max_sigma_both = 4. * TMath::Sqrt(maxTimeErrorClustersF * maxTimeErrorClustersF + maxTimeErrorClustersB * maxTimeErrorClustersB);
+  LOG(debug3) << GetName() << ": " << clusters.size() << " clusters (front "
+      << pairing.GetNofFront() << ", back " << pairing.GetNofBack() << ") ";
 
-  for (Int_t iClusterF = 0; iClusterF < nClustersF; iClusterF++) {
-    CbmStsCluster* clusterF = clusters[frontClusters[iClusterF]];
-
-    Double_t clusterF_Time = clusterF->GetTime();
-
-    Double_t clusterF_TimeError = clusterF->GetTimeError() * clusterF->GetTimeError();
-
-    Double_t max_sigma = 4. * TMath::Sqrt( clusterF_TimeError
-                                    + maxTimeErrorClustersB * maxTimeErrorClustersB );
-
-    for (Int_t iClusterB = startB; iClusterB < nClustersB;   iClusterB++) {
-      CbmStsCluster* clusterB = clusters[backClusters[iClusterB]];
-
-      Double_t timeDiff = clusterF_Time - clusterB->GetTime();
-
-      if ( ( timeDiff > 0 ) && ( timeDiff > max_sigma_both)){
-        startB++;
-        continue;
-      }
-      else if ( ( timeDiff > 0 )  &&  ( timeDiff > max_sigma ) ) {
-          continue;
-      }
-      else if ( ( timeDiff < 0 )  &&  ( fabs(timeDiff) > max_sigma ) ) break;
-
-      // Cut on time difference of the two clusters
-      Double_t timeCut = -1.;
-      if ( tCutInNs > 0. ) timeCut = tCutInNs; // absolute cut value
-      else {
-        if ( tCutInSigma > 0. ) {
-      		Double_t eF = clusterF->GetTimeError();
-      		Double_t eB = clusterB->GetTimeError();
-      		timeCut = tCutInSigma * TMath::Sqrt( eF * eF + eB * eB );
-      	} //? cut calculated from cluster errors
-      }
-      if ( fabs(clusterF->GetTime() - clusterB->GetTime()) > timeCut ) continue;
-
-      // --- Calculate intersection points
-      Int_t nOfHits = IntersectClusters(clusterF, clusterB);
-      LOG(debug4) << GetName() << ": Cluster front " << iClusterF
-          << ", cluster back " << iClusterB
-          << ", intersections " << nOfHits;
-      nHits += nOfHits;
-
-    }  // back side clusters
-
-  }  // front side clusters
-
-  LOG(debug3) << GetName() << ": Clusters " << nClusters << " ( "
-      << nClustersF << " / " << nClustersB << " ), hits: " << nHits;
-
-
-  return nHits;
 }
 // -------------------------------------------------------------------------
 
 
+
 // -----  Hit finding   ----------------------------------------------------
-Int_t CbmStsSensorDssd::FindHitsVector(std::vector<CbmStsCluster*>& clusters,
-                                 std::vector<CbmStsHit>* hitArray, CbmEvent* event,
+Int_t CbmStsSensorDssd::FindHits(const std::vector<CbmStsCluster*>& clusters,
+                                 CbmStsHitContext& context,
                                  Double_t tCutInNs,
-																 Double_t tCutInSigma) {
-
-  //LOG(INFO) << "clusters size " << clusters.size();
-  //Int_t hitArraySize = hitArray->GetEntriesFast();
-  //LOG(INFO) << "hit array size" << hitArraySize;
-  //LOG(INFO) << "event" << event;
-  //LOG(INFO) << "tCutInNs" << tCutInNs;
-  //LOG(INFO) << "tCutInSigma" << tCutInSigma;
-
-
-  fHitsVector = hitArray;
-  fHitsVector->reserve(5000);
-  //&fHitsVector = hitArray;
-  //fHitsVector
-  //fHits = Convert2(*hitArray);
-  fEvent = event;
-  Int_t nHits = 0;
-
-  Int_t nClusters = clusters.size();
-
-  Int_t nClustersF = 0;
-  Int_t nClustersB = 0;
-
-  //DigisToHits 
-  Double_t maxTimeErrorClustersF = 0.;
-  Double_t maxTimeErrorClustersB = 0.;
-
-
-  // --- Sort clusters into front and back side
-  vector<Int_t> frontClusters;
-  vector<Int_t> backClusters;
-  Int_t side  = -1;         // front or back side
-  for (Int_t iCluster = 0; iCluster < nClusters; iCluster++) {
-    CbmStsCluster* cluster = clusters[iCluster];
-    side = GetSide( cluster->GetPosition() );
+                                 Double_t tCutInSigma) const {
+
+  // --- Collect the compatible pairs of front and back side clusters
+  FillPairing(clusters, context);
+  CbmStsClusterPairing& pairing = context.GetPairing();
+  std::vector<Int_t>& pairFront = context.GetPairFront();
+  std::vector<Int_t>& pairBack = context.GetPairBack();
+  pairFront.clear();
+  pairBack.clear();
+  Long64_t nTested = pairing.GetNofPairsTested();
+  Int_t nPairs = pairing.FindPairs(tCutInNs, tCutInSigma,
+      [&pairFront, &pairBack] (CbmStsCluster*, CbmStsCluster*,
+                               Int_t iClusterF, Int_t iClusterB) {
+        pairFront.push_back(iClusterF);
+        pairBack.push_back(iClusterB);
+      });
+
+  // --- Calculate intersection points
+  Int_t nHits = ( nPairs > 0 ? IntersectClusterPairs(context) : 0 );
+
+  LOG(debug3) << GetName() << ": Clusters " << clusters.size() << " ( "
+      << pairing.GetNofFront() << " / " << pairing.GetNofBack()
+      << " ), pairs tested " << pairing.GetNofPairsTested() - nTested
+      << ", accepted " << nPairs << ", hits: " << nHits;
 
-    if ( side == 0) {
-      frontClusters.push_back(iCluster);
-      nClustersF++;
-      //DigisToHits
-      if ( cluster->GetTimeError() > maxTimeErrorClustersF ) maxTimeErrorClustersF = cluster->GetTimeError();
-    }
-    else if ( side == 1 ) {
-      backClusters.push_back(iCluster);
-      nClustersB++;
-      //DigisToHits
-      if ( cluster->GetTimeError() > maxTimeErrorClustersB ) maxTimeErrorClustersB = cluster->GetTimeError();
-    }
-    else
-      LOG(fatal) << GetName() << ": Illegal side qualifier " << side;
-  }  // Loop over clusters in module
-  LOG(debug3) << GetName() << ": " << nClusters << " clusters (front "
-      << frontClusters.size() << ", back " << backClusters.size() << ") ";
-
-  // --- Loop over front and back side clusters
-  // DigisToHits
-  Int_t startB = 0;
-  const Double_t max_sigma_both = 4. * TMath::Sqrt(maxTimeErrorClustersF * maxTimeErrorClustersF + maxTimeErrorClustersB * maxTimeErrorClustersB);
-
-  for (Int_t iClusterF = 0; iClusterF < nClustersF; iClusterF++) {
-    CbmStsCluster* clusterF = clusters[frontClusters[iClusterF]];
-
-    Double_t clusterF_Time = clusterF->GetTime();
-
-    Double_t clusterF_TimeError = clusterF->GetTimeError() * clusterF->GetTimeError();
-
-    Double_t max_sigma = 4. * TMath::Sqrt( clusterF_TimeError
-                                    + maxTimeErrorClustersB * maxTimeErrorClustersB );
-
-    for (Int_t iClusterB = startB; iClusterB < nClustersB;   iClusterB++) {
-      CbmStsCluster* clusterB = clusters[backClusters[iClusterB]];
-
-      Double_t timeDiff = clusterF_Time - clusterB->GetTime();
-
-      if ( ( timeDiff > 0 ) && ( timeDiff > max_sigma_both)){
-        startB++;
-        continue;
-      }
-      else if ( ( timeDiff > 0 )  &&  ( timeDiff > max_sigma ) ) {
-          continue;
-      }
-      else if ( ( timeDiff < 0 )  &&  ( fabs(timeDiff) > max_sigma ) ) break;
-
-      // Cut on time difference of the two clusters
-      Double_t timeCut = -1.;
-      if ( tCutInNs > 0. ) timeCut = tCutInNs; // absolute cut value
-      else {
-        if ( tCutInSigma > 0. ) {
-      		Double_t eF = clusterF->GetTimeError();
-      		Double_t eB = clusterB->GetTimeError();
-      		timeCut = tCutInSigma * TMath::Sqrt( eF * eF + eB * eB );
-      	} //? cut calculated from cluster errors
-      }
-      if ( fabs(clusterF->GetTime() - clusterB->GetTime()) > timeCut ) continue;
-
-      // --- Calculate intersection points
-      Int_t nOfHits = IntersectClustersVector(clusterF, clusterB);
-      LOG(debug4) << GetName() << ": Cluster front " << iClusterF
-          << ", cluster back " << iClusterB
-          << ", intersections " << nOfHits;
-      nHits += nOfHits;
-
-    }  // back side clusters
-
-  }  // front side clusters
-
-  LOG(debug3) << GetName() << ": Clusters " << nClusters << " ( "
-      << nClustersF << " / " << nClustersB << " ), hits: " << nHits;
-
-  //*hitArray = Convert(fHits);
-  //hitArray = fHitsVector;
   return nHits;
 }
 // -------------------------------------------------------------------------
@@ -366,7 +199,7 @@ Int_t CbmStsSensorDssd::FindHitsVector(std::vector<CbmStsCluster*>& clusters,
 // -----   Get cluster position at read-out edge   -------------------------
 void CbmStsSensorDssd::GetClusterPosition(Double_t centre,
                                           Double_t& xCluster,
-                                          Int_t& side) {
+                                          Int_t& side) const {
 
   // Take integer channel
   Int_t iChannel = Int_t(centre);
@@ -403,7 +236,7 @@ void CbmStsSensorDssd::GetClusterPosition(Double_t centre,
 
 
 // -----   Check whether a point is inside the active area   ---------------
-Bool_t CbmStsSensorDssd::IsInside(Double_t x, Double_t y) {
+Bool_t CbmStsSensorDssd::IsInside(Double_t x, Double_t y) const {
   if ( x < -fDx/2. ) return kFALSE;
   if ( x >  fDx/2. ) return kFALSE;
   if ( y < -fDy/2. ) return kFALSE;
@@ -508,8 +341,15 @@ Int_t CbmStsSensorDssd::CalculateResponse(CbmStsSensorPoint* point) {
   Int_t nSignals = 0;
 
   // --- Reset the strip charge arrays
-  fStripCharge[0].Reset();   // front side
-  fStripCharge[1].Reset();   // back side
+  ResetStripCharge();
+
+  // --- Random stream of the point, identified by its MC link
+  CbmLink* link = GetCurrentLink();
+  fRandom.SetStream(CbmStsSetup::Instance()->GetDigitizer()->GetRandomSeed(),
+                    CbmStsRandom::Stream(CbmStsRandom::kPointStream,
+                                         link ? link->GetFile() : -1,
+                                         link ? link->GetEntry() : -1,
+                                         link ? link->GetIndex() : -1));
 
   // --- Produce charge and propagate it to the readout strips
   ProduceCharge(point);
@@ -536,7 +376,8 @@ Int_t CbmStsSensorDssd::CalculateResponse(CbmStsSensorPoint* point) {
   Int_t nCharges[2] = { 0, 0 };
   for (Int_t side = 0; side < 2; side ++) {  // front and back side
 
-    for (Int_t strip = 0; strip < GetNofStrips(side); strip++) {
+    for (Int_t strip = fStripFirst[side]; strip <= fStripLast[side];
+         strip++) {
       if ( fStripCharge[side][strip] > 0. ) {
         RegisterCharge(side, strip, fStripCharge[side][strip],
                        point->GetTime());
@@ -620,7 +461,7 @@ void CbmStsSensorDssd::ProduceCharge(CbmStsSensorPoint* point) {
     // Charge for this step
     Double_t chargeInStep = chargePerStep;  // uniform energy loss
     if ( CbmStsSetup::Instance()->GetDigitizer()->GetELossModel() == 2 ) // energy loss fluctuations
-      chargeInStep = CbmStsPhysics::Instance()->EnergyLoss(stepSize, mass, eKin, dedx)
+      chargeInStep = CbmStsPhysics::Instance()->EnergyLoss(stepSize, mass, eKin, dedx, fRandom)
       / CbmStsPhysics::PairCreationEnergy();
     chargeSum += chargeInStep;
 
@@ -639,7 +480,8 @@ void CbmStsSensorDssd::ProduceCharge(CbmStsSensorPoint* point) {
   // re-normalised.
   if ( CbmStsSetup::Instance()->GetDigitizer()->GetELossModel() == 2) {
     for (Int_t side = 0; side < 2; side++) {  // front and back side
-      for (Int_t strip = 0; strip < GetNofStrips(side); strip++)
+      for (Int_t strip = fStripFirst[side]; strip <= fStripLast[side];
+           strip++)
         fStripCharge[side][strip] *= ( chargeTotal / chargeSum );
     } //# front and back side
   } //? E loss fluctuations
@@ -690,6 +532,23 @@ void CbmStsSensorDssd::RegisterCharge(Int_t side, Int_t strip,
 
 
 
+// -----   Reset the strip charge arrays   ---------------------------------
+void CbmStsSensorDssd::ResetStripCharge() {
+
+  for (Int_t side = 0; side < 2; side++) {  // front and back side
+    Int_t last = TMath::Min(fStripLast[side],
+                            fStripCharge[side].GetSize() - 1);
+    for (Int_t strip = fStripFirst[side]; strip <= last; strip++)
+      fStripCharge[side][strip] = 0.;
+    fStripFirst[side] = std::numeric_limits<Int_t>::max();
+    fStripLast[side] = -1;
+  } //# front and back side
+
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Self test   -----------------------------------------------------
 Bool_t CbmStsSensorDssd::SelfTest() {
 
@@ -715,4 +574,38 @@ Bool_t CbmStsSensorDssd::SelfTest() {
 
 
 
+// -----   Cross talk on a range of strips   -------------------------------
+void CbmStsSensorDssd::StripCrossTalk(Double_t* charge, Int_t nStrips,
+                                      Int_t& first, Int_t& last,
+                                      Double_t ctcoeff) {
+
+  if ( last < first ) return;
+
+  // --- Range including the neighbours, which may receive charge
+  Int_t lo = ( first > 0 ? first - 1 : 0 );
+  Int_t hi = ( last < nStrips - 1 ? last + 1 : nStrips - 1 );
+
+  // --- Same arithmetic as for the full array; the strip left of the
+  // --- range has no charge.
+  Double_t qLeft    = 0.;
+  Double_t qCurrent = 0.;
+  for (Int_t strip = lo; strip <= hi; strip++) {
+    qCurrent = charge[strip];
+    if ( strip == 0 )  // first strip
+      charge[strip] = (1. - ctcoeff ) * qCurrent + ctcoeff * charge[1];
+    else if ( strip == nStrips - 1 )  // last strip
+      charge[strip] = ctcoeff * qLeft + ( 1. - ctcoeff ) * qCurrent;
+    else
+      charge[strip] = ctcoeff * ( qLeft + charge[strip+1] ) +
+          ( 1. - 2. * ctcoeff ) * qCurrent;
+    qLeft = qCurrent;
+  } //# strips
+
+  first = lo;
+  last  = hi;
+}
+// -------------------------------------------------------------------------
+
+
+
 ClassImp(CbmStsSensorDssd)
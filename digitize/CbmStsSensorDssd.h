@@ -10,6 +10,7 @@
 #include <string>
 #include <utility>
 #include "TArrayD.h"
+#include "CbmStsRandom.h"
 #include "CbmStsSensor.h"
 
 class CbmStsPhysics;
@@ -38,7 +39,8 @@ class CbmStsPhysics;
  ** This is an abstract class, since additional functionality, depending
  ** on where (on which edge) the readout is done. Derived classes have to
  ** implement the pure virtual method PropagateCharge, which has to
- ** properly fill the charge arrays fStripCharge for front and back side,
+ ** properly fill the charge arrays fStripCharge for front and back side
+ ** (through AddStripCharge, which keeps track of the strips with charge),
  ** along with the auxiliary method Diffusion for the thermal diffusion
  ** along the drift to the readout plane. Also, the mapping from the strip
  ** numbers to the (module) channel number has to be implemented in
@@ -64,10 +66,12 @@ class CbmStsSensorDssd : public CbmStsSensor
     virtual ~CbmStsSensorDssd() { };
 
 
+    using CbmStsSensor::FindHits;
+
+
     /** @brief Find hits from clusters
-     ** @param clusters  Vector of clusters
-     ** @param hitArray  TClonesArray to store the hits in
-     ** @param event     Pointer to current event for registering of hits
+     ** @param clusters     Vector of clusters
+     ** @param context      Output sink and work space
      ** @param tCutInNs     Max. time difference of clusters in a hit in ns
      ** @param tCutInSigma  Max. time difference of clusters in multiples of error
      ** @return Number of created hits
@@ -80,14 +84,9 @@ class CbmStsSensorDssd : public CbmStsSensor
      ** which is calculated from the cluster time errors.
      ** If both tCutInNs and tCutInSigma are negative, no time cut is applied.
      **/
-    virtual Int_t FindHits(std::vector<CbmStsCluster*>& clusters,
-                           TClonesArray* hitArray, CbmEvent* event,
-													 Double_t tCutInNs, Double_t tCutInSigma);
-
-        virtual Int_t FindHitsVector(std::vector<CbmStsCluster*>& clusters,
-                                 std::vector<CbmStsHit>* hitArray, CbmEvent* event,
-                                 Double_t tCutInNs,
-																 Double_t tCutInSigma);
+    virtual Int_t FindHits(const std::vector<CbmStsCluster*>& clusters,
+                           CbmStsHitContext& context, Double_t tCutInNs,
+                           Double_t tCutInSigma) const;
 
 
     /** @brief Number of strips on front and back side
@@ -127,6 +126,24 @@ class CbmStsSensorDssd : public CbmStsSensor
     void PrintChargeStatus() const;
 
 
+    /** @brief Cross talk on a range of strips
+     ** @param charge   Strip charges (size nStrips)
+     ** @param nStrips  Number of strips
+     ** @param first    First strip with charge; updated
+     ** @param last     Last strip with charge; updated
+     ** @param ctcoeff  Cross-talk coefficient
+     **
+     ** Re-distributes the charges between adjacent strips according to the
+     ** cross-talk coefficient. All strips outside [first, last] must be
+     ** free of charge; only the range and its two neighbours are
+     ** processed, with the same result as for the full array. The range
+     ** is extended by the neighbours. An empty range (last < first) is
+     ** left unchanged.
+     **/
+    static void StripCrossTalk(Double_t* charge, Int_t nStrips, Int_t& first,
+                               Int_t& last, Double_t ctcoeff);
+
+
     /** String output **/
     virtual std::string ToString() const = 0;
 
@@ -144,6 +161,45 @@ class CbmStsSensorDssd : public CbmStsSensor
      ** Used during analog response simulation. **/
     TArrayD fStripCharge[2];   //!
 
+    /** Range of strips with charge (for front and back side); all strips
+     ** outside are free of charge. Empty if fStripLast < fStripFirst. **/
+    Int_t fStripFirst[2];   //!
+    Int_t fStripLast[2];    //!
+
+    /** Random stream of the currently processed MC point **/
+    CbmStsRandom fRandom;   //!
+
+    /** @brief Hand the clusters to the pairing engine of a context
+     ** @param clusters  Vector of clusters
+     ** @param context   Hit-finding context
+     **/
+    void FillPairing(const std::vector<CbmStsCluster*>& clusters,
+                     CbmStsHitContext& context) const;
+
+
+    /** @brief Cluster positions at the read-out edge
+     ** @param context  Hit-finding context
+     **
+     ** Fills the edge positions and their errors in the context for all
+     ** clusters in its pairing, such that the position of a cluster is
+     ** calculated only once, not for each pair it takes part in.
+     **/
+    void FillEdgePositions(CbmStsHitContext& context) const;
+
+
+    /** @brief Add charge to a strip
+     ** @param side    0 = front (n) side; 1 = back (p) side
+     ** @param strip   Strip number
+     ** @param charge  Charge [e]
+     **
+     ** The range of strips with charge is extended accordingly.
+     **/
+    void AddStripCharge(Int_t side, Int_t strip, Double_t charge) {
+      fStripCharge[side][strip] += charge;
+      if ( strip < fStripFirst[side] ) fStripFirst[side] = strip;
+      if ( strip > fStripLast[side] ) fStripLast[side] = strip;
+    }
+
 
     /** @brief Analogue response to a track in the sensor
      ** @param point  Pointer to CbmStsSensorPoint object
@@ -171,6 +227,7 @@ class CbmStsSensorDssd : public CbmStsSensor
      **
      ** Operates on the strip charge arrays and re-distributes charges
      ** between adjacent strips according to the cross-talk coefficient.
+     ** Only the strips with charge and their neighbours are processed.
      **/
     void CrossTalk(Double_t ctcoeff);
 
@@ -183,7 +240,7 @@ class CbmStsSensorDssd : public CbmStsSensor
      ** A correction for the Lorentz shift is applied.
      **/
     void GetClusterPosition(Double_t ClusterCentre,
-                            Double_t& xCluster, Int_t& side);
+                            Double_t& xCluster, Int_t& side) const;
 
 
     /** @brief Get the readout channel in the module for a given strip
@@ -221,18 +278,16 @@ class CbmStsSensorDssd : public CbmStsSensor
                                              Int_t sensorId) const = 0;
 
 
-    /** Find the intersection points of two clusters.
-     ** For each intersection point, a hit is created.
-     ** @param clusterF    Pointer to cluster on front side
-     ** @param clusterB    Pointer to cluster on back side
-     ** @param sensor      Pointer to sensor object
-     ** @return Number of intersection points inside active area
+    /** @brief Create hits from all accepted cluster pairs
+     ** @param context  Hit-finding context with the accepted pairs
+     ** @return Number of created hits
+     **
+     ** For each pair of front and back cluster in the context, the
+     ** intersection points are calculated. For each intersection point
+     ** inside the active area, a hit is created, in the order of the pairs.
+     ** Pure virtual; to be implemented in derived classes.
      **/
-    virtual Int_t IntersectClusters(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB) = 0;
-
-    virtual Int_t IntersectClustersVector(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB) = 0;
+    virtual Int_t IntersectClusterPairs(CbmStsHitContext& context) const = 0;
 
 
     /** Check whether a point (x,y) is inside the active area.
@@ -244,7 +299,7 @@ class CbmStsSensorDssd : public CbmStsSensor
      ** The coordinates have to be given in the local
      ** coordinate system (origin in the sensor centre).
      **/
-    Bool_t IsInside(Double_t x, Double_t y);
+    Bool_t IsInside(Double_t x, Double_t y) const;
 
 
     /** @brief Lorentz shift in the x coordinate
@@ -299,6 +354,13 @@ class CbmStsSensorDssd : public CbmStsSensor
                         Double_t charge, Double_t time) const;
 
 
+    /** @brief Remove the charges from the strip charge arrays
+     **
+     ** Only the range of strips with charge is reset.
+     **/
+    void ResetStripCharge();
+
+
     /** Test the consistent implementation of GetModuleChannel and
      ** GetStrip. The latter should be the reverse of the former.
      ** @return kTRUE if successful
@@ -20,6 +20,29 @@
 using namespace std;
 
 
+// -----   Per-thread work space of the batch intersection   ---------------
+namespace {
+
+  struct StripBuffers {
+    std::vector<Int_t> fPair;        // index of the cluster pair
+    std::vector<Double_t> fXF;       // front cluster position [cm]
+    std::vector<Double_t> fErrF;     // error of front position [cm]
+    std::vector<Double_t> fXB;       // back cluster position [cm]
+    std::vector<Double_t> fErrB;     // error of back position [cm]
+    std::vector<Double_t> fX;        // x of crossing [cm]
+    std::vector<Double_t> fY;        // y of crossing [cm]
+    std::vector<Double_t> fVarX;     // variance in x [cm^2]
+    std::vector<Double_t> fVarY;     // variance in y [cm^2]
+    std::vector<Double_t> fVarXY;    // covariance x-y [cm^2]
+    std::vector<Int_t> fInside;      // hit to be created
+  };
+
+  thread_local StripBuffers gStrips;
+
+}
+// -------------------------------------------------------------------------
+
+
 // -----   Constructor   ---------------------------------------------------
 CbmStsSensorDssdOrtho::CbmStsSensorDssdOrtho(UInt_t address,
                                              TGeoPhysicalNode* node,
@@ -257,114 +280,90 @@ Bool_t CbmStsSensorDssdOrtho::Init() {
 
 
 
-// -----   Create hits from two clusters   ---------------------------------
-Int_t CbmStsSensorDssdOrtho::IntersectClusters(CbmStsCluster* clusterF,
-                                               CbmStsCluster* clusterB) {
-  // --- Check pointer validity
-  assert(clusterF);
-  assert(clusterB);
-
-  // --- Calculate cluster centre position on readout edge
-  Int_t side  = -1;
-  Double_t xF = -1.;
-  Double_t xB = -1.;
-  GetClusterPosition(clusterF->GetPosition(), xF, side);
-  if ( side != 0 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for front side cluster! ";
-  Double_t exF = clusterF->GetPositionError() * fPitch[ side ];
-  Double_t du  = exF;
-  GetClusterPosition(clusterB->GetPosition(), xB, side);
-  if ( side != 1 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for back side cluster! ";
-  Double_t exB = clusterB->GetPositionError() * fPitch[ side ];
-  Double_t dv  = exB;
-
-  // --- Should be inside active area
-  if ( ! ( xF >= 0. || xF <= fDx) ) return 0;
-  if ( ! ( xB >= 0. || xB <= fDy) ) return 0;
-
-  // --- Hit counter
-  Int_t nHits = 0;
-
-  // In orthogonal sensor, all pairs of (front, back) cluster have
-  // a single intersection
-  // => exactly one hit!
-
-  // --- Prepare hit coordinates and errors
-  // In the coordinate system with origin at the bottom left corner,
-  // the coordinates in the orthogonal sensor are straighforward.
-  Double_t xC    = xF;   // x coordinate of intersection point
-  Double_t yC    = xB;   // y coordinate of intersection point
-  Double_t varX  = exF * exF;  // variance of xC
-  Double_t varY  = exB * exB;  // variance of yC
-  Double_t varXY = 0.; // covariance xC-yC => independent variables!
-
-  // --- Transform into sensor system with origin at sensor centre
-  xC -= 0.5 * fDx;
-  yC -= 0.5 * fDy;
+// -----   Intersection of arrays of strips   ------------------------------
+void CbmStsSensorDssdOrtho::Intersect(Int_t n, const Double_t* xF,
+                                      const Double_t* exF,
+                                      const Double_t* xB,
+                                      const Double_t* exB,
+                                      Double_t* x, Double_t* y,
+                                      Double_t* varX, Double_t* varY,
+                                      Double_t* varXY, Int_t* inside) const {
 
-  // --- Create the hit
-  CreateHit( xC, yC, varX, varY, varXY, clusterF, clusterB, du, dv);
-  nHits++;
+  for (Int_t index = 0; index < n; index++) {
+    x[index] = xF[index];
+    y[index] = xB[index];
+    varX[index] = exF[index] * exF[index];
+    varY[index] = exB[index] * exB[index];
+    varXY[index] = 0.;  // independent variables
+    inside[index] = 1;
+  }
 
-  return nHits;
 }
 // -------------------------------------------------------------------------
 
 
-// -----   Create hits from two clusters   ---------------------------------
-Int_t CbmStsSensorDssdOrtho::IntersectClustersVector(CbmStsCluster* clusterF,
-                                               CbmStsCluster* clusterB) {
-  // --- Check pointer validity
-  assert(clusterF);
-  assert(clusterB);
 
-  // --- Calculate cluster centre position on readout edge
-  Int_t side  = -1;
-  Double_t xF = -1.;
-  Double_t xB = -1.;
-  GetClusterPosition(clusterF->GetPosition(), xF, side);
-  if ( side != 0 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for front side cluster! ";
-  Double_t exF = clusterF->GetPositionError() * fPitch[ side ];
-  Double_t du  = exF;
-  GetClusterPosition(clusterB->GetPosition(), xB, side);
-  if ( side != 1 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for back side cluster! ";
-  Double_t exB = clusterB->GetPositionError() * fPitch[ side ];
-  Double_t dv  = exB;
-
-  // --- Should be inside active area
-  if ( ! ( xF >= 0. || xF <= fDx) ) return 0;
-  if ( ! ( xB >= 0. || xB <= fDy) ) return 0;
-
-  // --- Hit counter
+// -----   Create hits from all accepted cluster pairs   ------------------
+Int_t CbmStsSensorDssdOrtho::IntersectClusterPairs(CbmStsHitContext& context) const {
+
+  // --- Cluster positions at the read-out edge, once per cluster
+  FillEdgePositions(context);
+  const CbmStsClusterPairing& pairing = context.GetPairing();
+  const std::vector<Int_t>& pairFront = context.GetPairFront();
+  const std::vector<Int_t>& pairBack = context.GetPairBack();
+  const std::vector<Double_t>& edgeXF = context.GetEdgeX(0);
+  const std::vector<Double_t>& edgeXB = context.GetEdgeX(1);
+  const std::vector<Double_t>& edgeErrorF = context.GetEdgeError(0);
+  const std::vector<Double_t>& edgeErrorB = context.GetEdgeError(1);
+
+  // --- Pairs inside the active area
+  StripBuffers& buf = gStrips;
+  buf.fPair.clear();
+  buf.fXF.clear();
+  buf.fErrF.clear();
+  buf.fXB.clear();
+  buf.fErrB.clear();
+  Int_t nPairs = pairFront.size();
+  for (Int_t iPair = 0; iPair < nPairs; iPair++) {
+    Double_t xF = edgeXF[pairFront[iPair]];
+    Double_t xB = edgeXB[pairBack[iPair]];
+    if ( ! ( xF >= 0. || xF <= fDx) ) continue;
+    if ( ! ( xB >= 0. || xB <= fDy) ) continue;
+    buf.fPair.push_back(iPair);
+    buf.fXF.push_back(xF);
+    buf.fErrF.push_back(edgeErrorF[pairFront[iPair]]);
+    buf.fXB.push_back(xB);
+    buf.fErrB.push_back(edgeErrorB[pairBack[iPair]]);
+  } //# cluster pairs
+
+  // --- Intersect all strips
+  Int_t nStrips = buf.fPair.size();
+  buf.fX.resize(nStrips);
+  buf.fY.resize(nStrips);
+  buf.fVarX.resize(nStrips);
+  buf.fVarY.resize(nStrips);
+  buf.fVarXY.resize(nStrips);
+  buf.fInside.resize(nStrips);
+  Intersect(nStrips, buf.fXF.data(), buf.fErrF.data(), buf.fXB.data(),
+            buf.fErrB.data(), buf.fX.data(), buf.fY.data(), buf.fVarX.data(),
+            buf.fVarY.data(), buf.fVarXY.data(), buf.fInside.data());
+
+  // --- Create the hits, in the order of the pairs
   Int_t nHits = 0;
-
-  // In orthogonal sensor, all pairs of (front, back) cluster have
-  // a single intersection
-  // => exactly one hit!
-
-  // --- Prepare hit coordinates and errors
-  // In the coordinate system with origin at the bottom left corner,
-  // the coordinates in the orthogonal sensor are straighforward.
-  Double_t xC    = xF;   // x coordinate of intersection point
-  Double_t yC    = xB;   // y coordinate of intersection point
-  Double_t varX  = exF * exF;  // variance of xC
-  Double_t varY  = exB * exB;  // variance of yC
-  Double_t varXY = 0.; // covariance xC-yC => independent variables!
-
-  // --- Transform into sensor system with origin at sensor centre
-  xC -= 0.5 * fDx;
-  yC -= 0.5 * fDy;
-
-  // --- Create the hit
-  CreateHitVector( xC, yC, varX, varY, varXY, clusterF, clusterB, du, dv);
-  nHits++;
+  for (Int_t iStrip = 0; iStrip < nStrips; iStrip++) {
+    if ( ! buf.fInside[iStrip] ) continue;
+    Int_t iPair = buf.fPair[iStrip];
+    CbmStsCluster* clusterF = pairing.GetFront(pairFront[iPair]);
+    CbmStsCluster* clusterB = pairing.GetBack(pairBack[iPair]);
+
+    // --- Transform into sensor system with origin at sensor centre
+    Double_t xC = buf.fX[iStrip] - 0.5 * fDx;
+    Double_t yC = buf.fY[iStrip] - 0.5 * fDy;
+    CreateHit(xC, yC, buf.fVarX[iStrip], buf.fVarY[iStrip],
+              buf.fVarXY[iStrip], clusterF, clusterB,
+              buf.fErrF[iStrip], buf.fErrB[iStrip], context);
+    nHits++;
+  } //# strip pairs
 
   return nHits;
 }
@@ -428,7 +427,7 @@ void CbmStsSensorDssdOrtho::PropagateCharge(Double_t x, Double_t y,
   // No diffusion: all charge is in one strip
   if (  ! CbmStsPhysics::Instance()->UseDiffusion() ) {
     Int_t iStrip = GetStripNumber(xCharge, yCharge, side);
-    fStripCharge[side][iStrip] += charge;
+    AddStripCharge(side, iStrip, charge);
     LOG(debug4) << GetName() << ": Adding charge " << charge << " to strip "
         << iStrip;
   } //? Do not use diffusion
@@ -461,17 +460,17 @@ void CbmStsSensorDssdOrtho::PropagateCharge(Double_t x, Double_t y,
     Int_t iStripR  = iStripC + 1;                             // right neighbour
     // Collect charge on the readout strips
     if ( fracC > 0. ) {
-      fStripCharge[side][iStripC] += charge * fracC;    // centre strip
+      AddStripCharge(side, iStripC, charge * fracC);    // centre strip
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracC
           << " to strip " << iStripC;
     }
     if ( fracL > 0. && iStripL >= 0 ) {
-      fStripCharge[side][iStripL] += charge * fracL;  // right neighbour
+      AddStripCharge(side, iStripL, charge * fracL);  // right neighbour
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracL
           << " to strip " << iStripL;
     }
     if ( fracR > 0. && iStripR < fNofStrips[side] ) {
-      fStripCharge[side][iStripR] += charge * fracR;  // left neighbour
+      AddStripCharge(side, iStripR, charge * fracR);  // left neighbour
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracR
           << " to strip " << iStripR;
     }
@@ -172,18 +172,40 @@ class CbmStsSensorDssdOrtho : public CbmStsSensorDssd
     virtual Int_t GetStripNumber(Double_t x, Double_t y, Int_t side) const;
 
 
-    /** Find the intersection points of two clusters.
-     ** For each intersection point, a hit is created.
-     ** @param clusterF    Pointer to cluster on front side
-     ** @param clusterB    Pointer to cluster on back side
-     ** @param sensor      Pointer to sensor object
-     ** @return Number of intersection points inside active area
+
+
+    /** Intersection points for arrays of strip pairs
+     ** @param[in] n      Number of strip pairs
+     ** @param[in] xF     x coordinates of front-side clusters [cm]
+     ** @param[in] exF    Uncertainties on xF [cm]
+     ** @param[in] xB     y coordinates of back-side clusters [cm]
+     ** @param[in] exB    Uncertainties on xB [cm]
+     ** @param[out] x     x coordinates of crossings [cm]
+     ** @param[out] y     y coordinates of crossings [cm]
+     ** @param[out] varX  Variances in x [cm^2]
+     ** @param[out] varY  Variances in y [cm^2]
+     ** @param[out] varXY Covariances of x and y [cm^2]
+     ** @param[out] inside  1 if a hit is to be created (always the case)
+     **
+     ** Counterpart of CbmStsSensorDssdStereo::Intersect. In the orthogonal
+     ** sensor, each pair of front and back cluster has exactly one crossing.
+     ** Coordinates are in the sensor frame with the origin in the bottom
+     ** left corner of the active area.
      **/
-    virtual Int_t IntersectClusters(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB);
+    void Intersect(Int_t n, const Double_t* xF, const Double_t* exF,
+                   const Double_t* xB, const Double_t* exB, Double_t* x,
+                   Double_t* y, Double_t* varX, Double_t* varY,
+                   Double_t* varXY, Int_t* inside) const;
 
-    virtual Int_t IntersectClustersVector(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB);
+
+    /** @brief Create hits from all accepted cluster pairs
+     ** @param context  Hit-finding context with the accepted pairs
+     ** @return Number of created hits
+     **
+     ** The cluster positions are calculated once per cluster; the
+     ** crossings of all pairs are calculated in one batch.
+     **/
+    virtual Int_t IntersectClusterPairs(CbmStsHitContext& context) const;
 
 
     /** Propagate a charge created in the sensor to the readout strips
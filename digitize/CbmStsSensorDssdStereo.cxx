@@ -17,6 +17,29 @@
 using namespace std;
 
 
+// -----   Per-thread work space of the batch intersection   ---------------
+namespace {
+
+  struct LineBuffers {
+    std::vector<Int_t> fPair;        // index of the cluster pair
+    std::vector<Double_t> fXF;       // front line at read-out edge [cm]
+    std::vector<Double_t> fErrF;     // error of front line [cm]
+    std::vector<Double_t> fXB;       // back line at read-out edge [cm]
+    std::vector<Double_t> fErrB;     // error of back line [cm]
+    std::vector<Double_t> fX;        // x of crossing [cm]
+    std::vector<Double_t> fY;        // y of crossing [cm]
+    std::vector<Double_t> fVarX;     // variance in x [cm^2]
+    std::vector<Double_t> fVarY;     // variance in y [cm^2]
+    std::vector<Double_t> fVarXY;    // covariance x-y [cm^2]
+    std::vector<Int_t> fInside;      // crossing in active area
+  };
+
+  thread_local LineBuffers gLines;
+
+}
+// -------------------------------------------------------------------------
+
+
 // -----   Constructor   ---------------------------------------------------
 CbmStsSensorDssdStereo::CbmStsSensorDssdStereo(UInt_t address,
                                                TGeoPhysicalNode* node,
@@ -321,7 +344,7 @@ Bool_t CbmStsSensorDssdStereo::Intersect(Double_t xF, Double_t exF,
                                          Double_t xB, Double_t exB,
                                          Double_t& x, Double_t& y,
                                          Double_t& varX, Double_t& varY,
-                                         Double_t& varXY) {
+                                         Double_t& varXY) const {
 
   // In the coordinate system with origin at the bottom left corner,
   // a line along the strips with coordinate x0 at the top edge is
@@ -379,226 +402,177 @@ Bool_t CbmStsSensorDssdStereo::Intersect(Double_t xF, Double_t exF,
 
 
 
-// -----   Create hits from two clusters   ---------------------------------
-Int_t CbmStsSensorDssdStereo::IntersectClusters(CbmStsCluster* clusterF,
-                                                CbmStsCluster* clusterB) {
-  // --- Check pointer validity
-  assert(clusterF);
-  assert(clusterB);
-
-  // --- Ideal hit finder
-  if ( kFALSE ){  //TODO Proper implementation
-    LOG(debug3) << GetName() << ": ideal model of Hit Finder";
-
-    const CbmMatch *clusterFMatch, *clusterBMatch;
-
-    clusterFMatch = static_cast<const CbmMatch*>(clusterF -> GetMatch());
-    if (clusterFMatch){
-      LOG(debug4) << GetName() << ": front cluster exists";
-      if ((clusterFMatch -> GetNofLinks()) != 1) {
-        LOG(debug4) << GetName() << ": front cluster has more or less than 1 CbmLink";
-        return 0;
-      } else LOG(debug4) << GetName() << ": front cluster has " <<  clusterFMatch -> GetNofLinks() << " CbmLink";
-    } else return 0;
-
-    clusterBMatch = static_cast<const CbmMatch*> (clusterB -> GetMatch());
-    if (clusterBMatch){
-      LOG(debug4) << GetName() << ": back cluster exists";
-      if ((clusterBMatch -> GetNofLinks()) != 1){
-        LOG(debug4) << GetName() << ": back cluster has more or less than 1 CbmLink";
-        return 0;
-      } else LOG(debug4) << GetName() << ": back cluster has " <<  clusterBMatch -> GetNofLinks() << " CbmLink";
-    } else return 0;
-
-    if (clusterBMatch -> GetLink(0).GetIndex() != clusterFMatch -> GetLink(0).GetIndex()){
-      LOG(debug4) << GetName() << ": back and front clusters have different index of CbmLink";
-      return 0;
-    } else LOG(debug4) << GetName() << ": back and front clusters have the same index of CbmLink";
+// -----   Intersection of arrays of lines along the strips   -------------
+void CbmStsSensorDssdStereo::Intersect(Int_t n, const Double_t* xF,
+                                       const Double_t* exF,
+                                       const Double_t* xB,
+                                       const Double_t* exB,
+                                       Double_t* x, Double_t* y,
+                                       Double_t* varX, Double_t* varY,
+                                       Double_t* varXY, Int_t* inside) const {
+
+  // --- Constants of the sensor. The expressions in the loops are the
+  // --- same as in the single-pair version, such that the results are
+  // --- identical.
+  const Double_t tanF = fTanStereo[0];
+  const Double_t tanB = fTanStereo[1];
+  const Double_t errorFac = fErrorFac;
+  const Double_t dy = fDy;
+  const Double_t halfX = fDx/2.;
+  const Double_t halfY = fDy/2.;
+
+  // --- Same stereo angles: no intersection
+  if ( TMath::Abs(fStereoF-fStereoB) < 0.5 ) {
+    for (Int_t index = 0; index < n; index++) {
+      x[index] = -1000.;
+      y[index] = -1000.;
+      varX[index] = 0.;
+      varY[index] = 0.;
+      varXY[index] = 0.;
+      inside[index] = 0;
+    }
+    return;
   }
 
-  // --- Calculate cluster centre position on readout edge
-  Int_t side  = -1;
-  Double_t xF = -1.;
-  Double_t xB = -1.;
-  GetClusterPosition(clusterF->GetPosition(), xF, side);
-  if ( side != 0 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for front side cluster! ";
-  Double_t exF = clusterF->GetPositionError() * fPitch;
-  Double_t du = exF * TMath::Cos(TMath::DegToRad() * fStereoF);
-  GetClusterPosition(clusterB->GetPosition(), xB, side);
-  if ( side != 1 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for back side cluster! ";
-  Double_t exB = clusterB->GetPositionError() * fPitch;
-  Double_t dv = exB * TMath::Cos(TMath::DegToRad() * fStereoB);
-
-  // --- Should be inside active area
-  if ( ! ( xF >= 0. || xF <= fDx) ) return 0;
-  if ( ! ( xB >= 0. || xB <= fDx) ) return 0;
-
-  // --- Hit counter
-  Int_t nHits = 0;
+  // --- Vertical front strips
+  if ( TMath::Abs(fStereoF) < 0.001 ) {
+    for (Int_t index = 0; index < n; index++) {
+      x[index] = xF[index];
+      y[index] = dy - ( xF[index] - xB[index] ) / tanB;
+      varX[index] = exF[index] * exF[index];
+      varY[index] = ( exF[index] * exF[index] + exB[index] * exB[index] )
+          / tanB / tanB;
+      varXY[index] = -1. * exF[index] * exF[index] / tanB;
+    }
+  }
 
-  // --- Calculate number of line segments due to horizontal
-  // --- cross-connection. If x(y=0) does not fall on the bottom edge,
-  // --- the strip is connected to the one corresponding to the line
-  // --- with top edge coordinate xF' = xF +/- Dx. For odd combinations
-  // --- of stereo angle and sensor dimensions, this could even happen
-  // --- multiple times. For each of these lines, the intersection with
-  // --- the line on the other side is calculated. If inside the active area,
-  // --- a hit is created.
-  Int_t nF = Int_t( (xF + fDy * fTanStereo[0]) / fDx );
-  Int_t nB = Int_t( (xB + fDy * fTanStereo[1]) / fDx );
-
-  // --- If n is positive, all lines from 0 to n must be considered,
-  // --- if it is negative (phi negative), all lines from n to 0.
-  Int_t nF1 = TMath::Min(0, nF);
-  Int_t nF2 = TMath::Max(0, nF);
-  Int_t nB1 = TMath::Min(0, nB);
-  Int_t nB2 = TMath::Max(0, nB);
-
-  // --- Double loop over possible lines
-  Double_t xC = -1.;   // x coordinate of intersection point
-  Double_t yC = -1.;   // y coordinate of intersection point
-  Double_t varX = 0.;  // variance of xC
-  Double_t varY = 0.;  // variance of yC
-  Double_t varXY = 0.; // covariance xC-yC
-  for (Int_t iF = nF1; iF <= nF2; iF++) {
-    Double_t xFi = xF - Double_t(iF) * fDx;
-    for (Int_t iB = nB1; iB <= nB2; iB++) {
-      Double_t xBi = xB - Double_t(iB) * fDx;
-
-      // --- Intersect the two lines
-      Bool_t found = Intersect(xFi, exF, xBi, exB, xC, yC, varX, varY, varXY);
-      LOG(debug4) << GetName() << ": Trying " << xFi << ", " << xBi
-          << ", intersection ( " << xC << ", " << yC
-          << " ) " << ( found ? "TRUE" : "FALSE" );
-      if ( found ) {
-
-        // --- Transform into sensor system with origin at sensor centre
-        xC -= 0.5 * fDx;
-        yC -= 0.5 * fDy;
-        // --- Create the hit
-        CreateHit(xC, yC, varX, varY, varXY, clusterF, clusterB, du, dv);
-        nHits++;
-
-      }  //? Intersection of lines
-    }  // lines on back side
-  }  // lines on front side
+  // --- Vertical back strips
+  else if ( TMath::Abs(fStereoB) < 0.001 ) {
+    for (Int_t index = 0; index < n; index++) {
+      x[index] = xB[index];
+      y[index] = dy - ( xB[index] - xF[index] ) / tanF;
+      varX[index] = exB[index] * exB[index];
+      varY[index] = ( exF[index] * exF[index] + exB[index] * exB[index] )
+          / tanF / tanF;
+      varXY[index] = -1. * exB[index] * exB[index] / tanF;
+    }
+  }
+
+  // --- Both sides with stereo angle
+  else {
+    for (Int_t index = 0; index < n; index++) {
+      x[index] = ( tanB * xF[index] - tanF * xB[index] ) / ( tanB - tanF );
+      y[index] = dy + ( xB[index] - xF[index] ) / ( tanB - tanF );
+      varX[index] = errorFac * ( exF[index] * exF[index] * tanB * tanB
+                                 + exB[index] * exB[index] * tanF * tanF );
+      varY[index] = errorFac * ( exF[index] * exF[index]
+                                 + exB[index] * exB[index] );
+      varXY[index] = -1. * errorFac * ( exF[index] * exF[index] * tanB
+                                        + exB[index] * exB[index] * tanF );
+    }
+  }
+
+  // --- Check for being in active area (as IsInside)
+  for (Int_t index = 0; index < n; index++) {
+    Double_t u = x[index] - halfX;
+    Double_t v = y[index] - halfY;
+    inside[index] = ( ! ( u < -halfX ) ) & ( ! ( u > halfX ) )
+                    & ( ! ( v < -halfY ) ) & ( ! ( v > halfY ) );
+  }
 
-  return nHits;
 }
 // -------------------------------------------------------------------------
 
 
-// -----   Create hits from two clusters   ---------------------------------
-Int_t CbmStsSensorDssdStereo::IntersectClustersVector(CbmStsCluster* clusterF,
-                                                CbmStsCluster* clusterB) {
-  // --- Check pointer validity
-  assert(clusterF);
-  assert(clusterB);
-
-  // --- Ideal hit finder
-  if ( kFALSE ){  //TODO Proper implementation
-    LOG(debug3) << GetName() << ": ideal model of Hit Finder";
-
-    const CbmMatch *clusterFMatch, *clusterBMatch;
-
-    clusterFMatch = static_cast<const CbmMatch*>(clusterF -> GetMatch());
-    if (clusterFMatch){
-      LOG(debug4) << GetName() << ": front cluster exists";
-      if ((clusterFMatch -> GetNofLinks()) != 1) {
-        LOG(debug4) << GetName() << ": front cluster has more or less than 1 CbmLink";
-        return 0;
-      } else LOG(debug4) << GetName() << ": front cluster has " <<  clusterFMatch -> GetNofLinks() << " CbmLink";
-    } else return 0;
-
-    clusterBMatch = static_cast<const CbmMatch*> (clusterB -> GetMatch());
-    if (clusterBMatch){
-      LOG(debug4) << GetName() << ": back cluster exists";
-      if ((clusterBMatch -> GetNofLinks()) != 1){
-        LOG(debug4) << GetName() << ": back cluster has more or less than 1 CbmLink";
-        return 0;
-      } else LOG(debug4) << GetName() << ": back cluster has " <<  clusterBMatch -> GetNofLinks() << " CbmLink";
-    } else return 0;
-
-    if (clusterBMatch -> GetLink(0).GetIndex() != clusterFMatch -> GetLink(0).GetIndex()){
-      LOG(debug4) << GetName() << ": back and front clusters have different index of CbmLink";
-      return 0;
-    } else LOG(debug4) << GetName() << ": back and front clusters have the same index of CbmLink";
-  }
 
-  // --- Calculate cluster centre position on readout edge
-  Int_t side  = -1;
-  Double_t xF = -1.;
-  Double_t xB = -1.;
-  GetClusterPosition(clusterF->GetPosition(), xF, side);
-  if ( side != 0 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for front side cluster! ";
-  Double_t exF = clusterF->GetPositionError() * fPitch;
-  Double_t du = exF * TMath::Cos(TMath::DegToRad() * fStereoF);
-  GetClusterPosition(clusterB->GetPosition(), xB, side);
-  if ( side != 1 )
-    LOG(fatal) << GetName() << ": Inconsistent side qualifier " << side
-    << " for back side cluster! ";
-  Double_t exB = clusterB->GetPositionError() * fPitch;
-  Double_t dv = exB * TMath::Cos(TMath::DegToRad() * fStereoB);
-
-  // --- Should be inside active area
-  if ( ! ( xF >= 0. || xF <= fDx) ) return 0;
-  if ( ! ( xB >= 0. || xB <= fDx) ) return 0;
-
-  // --- Hit counter
+// -----   Create hits from all accepted cluster pairs   ------------------
+Int_t CbmStsSensorDssdStereo::IntersectClusterPairs(CbmStsHitContext& context) const {
+
+  // --- Cluster positions at the read-out edge, once per cluster
+  FillEdgePositions(context);
+  const CbmStsClusterPairing& pairing = context.GetPairing();
+  const std::vector<Int_t>& pairFront = context.GetPairFront();
+  const std::vector<Int_t>& pairBack = context.GetPairBack();
+  const std::vector<Double_t>& edgeXF = context.GetEdgeX(0);
+  const std::vector<Double_t>& edgeXB = context.GetEdgeX(1);
+  const std::vector<Double_t>& edgeErrorF = context.GetEdgeError(0);
+  const std::vector<Double_t>& edgeErrorB = context.GetEdgeError(1);
+
+  // --- Lines to intersect. Because of the horizontal cross-connection,
+  // --- a cluster may correspond to several lines. If x(y=0) does not fall
+  // --- on the bottom edge, the strip is connected to the one corresponding
+  // --- to the line with top edge coordinate x' = x +/- Dx. For odd
+  // --- combinations of stereo angle and sensor dimensions, this could even
+  // --- happen multiple times. If n is positive, all lines from 0 to n must
+  // --- be considered, if it is negative (phi negative), all lines from n
+  // --- to 0.
+  LineBuffers& buf = gLines;
+  buf.fPair.clear();
+  buf.fXF.clear();
+  buf.fErrF.clear();
+  buf.fXB.clear();
+  buf.fErrB.clear();
+  Int_t nPairs = pairFront.size();
+  for (Int_t iPair = 0; iPair < nPairs; iPair++) {
+    Double_t xF = edgeXF[pairFront[iPair]];
+    Double_t exF = edgeErrorF[pairFront[iPair]];
+    Double_t xB = edgeXB[pairBack[iPair]];
+    Double_t exB = edgeErrorB[pairBack[iPair]];
+
+    // --- Should be inside active area
+    if ( ! ( xF >= 0. || xF <= fDx) ) continue;
+    if ( ! ( xB >= 0. || xB <= fDx) ) continue;
+
+    Int_t nF = Int_t( (xF + fDy * fTanStereo[0]) / fDx );
+    Int_t nB = Int_t( (xB + fDy * fTanStereo[1]) / fDx );
+    Int_t nF1 = TMath::Min(0, nF);
+    Int_t nF2 = TMath::Max(0, nF);
+    Int_t nB1 = TMath::Min(0, nB);
+    Int_t nB2 = TMath::Max(0, nB);
+    for (Int_t iF = nF1; iF <= nF2; iF++) {
+      Double_t xFi = xF - Double_t(iF) * fDx;
+      for (Int_t iB = nB1; iB <= nB2; iB++) {
+        buf.fPair.push_back(iPair);
+        buf.fXF.push_back(xFi);
+        buf.fErrF.push_back(exF);
+        buf.fXB.push_back(xB - Double_t(iB) * fDx);
+        buf.fErrB.push_back(exB);
+      } //# lines on back side
+    } //# lines on front side
+  } //# cluster pairs
+
+  // --- Intersect all lines
+  Int_t nLines = buf.fPair.size();
+  buf.fX.resize(nLines);
+  buf.fY.resize(nLines);
+  buf.fVarX.resize(nLines);
+  buf.fVarY.resize(nLines);
+  buf.fVarXY.resize(nLines);
+  buf.fInside.resize(nLines);
+  Intersect(nLines, buf.fXF.data(), buf.fErrF.data(), buf.fXB.data(),
+            buf.fErrB.data(), buf.fX.data(), buf.fY.data(), buf.fVarX.data(),
+            buf.fVarY.data(), buf.fVarXY.data(), buf.fInside.data());
+
+  // --- Create the hits, in the order of the pairs
   Int_t nHits = 0;
-
-  // --- Calculate number of line segments due to horizontal
-  // --- cross-connection. If x(y=0) does not fall on the bottom edge,
-  // --- the strip is connected to the one corresponding to the line
-  // --- with top edge coordinate xF' = xF +/- Dx. For odd combinations
-  // --- of stereo angle and sensor dimensions, this could even happen
-  // --- multiple times. For each of these lines, the intersection with
-  // --- the line on the other side is calculated. If inside the active area,
-  // --- a hit is created.
-  Int_t nF = Int_t( (xF + fDy * fTanStereo[0]) / fDx );
-  Int_t nB = Int_t( (xB + fDy * fTanStereo[1]) / fDx );
-
-  // --- If n is positive, all lines from 0 to n must be considered,
-  // --- if it is negative (phi negative), all lines from n to 0.
-  Int_t nF1 = TMath::Min(0, nF);
-  Int_t nF2 = TMath::Max(0, nF);
-  Int_t nB1 = TMath::Min(0, nB);
-  Int_t nB2 = TMath::Max(0, nB);
-
-  // --- Double loop over possible lines
-  Double_t xC = -1.;   // x coordinate of intersection point
-  Double_t yC = -1.;   // y coordinate of intersection point
-  Double_t varX = 0.;  // variance of xC
-  Double_t varY = 0.;  // variance of yC
-  Double_t varXY = 0.; // covariance xC-yC
-  for (Int_t iF = nF1; iF <= nF2; iF++) {
-    Double_t xFi = xF - Double_t(iF) * fDx;
-    for (Int_t iB = nB1; iB <= nB2; iB++) {
-      Double_t xBi = xB - Double_t(iB) * fDx;
-
-      // --- Intersect the two lines
-      Bool_t found = Intersect(xFi, exF, xBi, exB, xC, yC, varX, varY, varXY);
-      LOG(debug4) << GetName() << ": Trying " << xFi << ", " << xBi
-          << ", intersection ( " << xC << ", " << yC
-          << " ) " << ( found ? "TRUE" : "FALSE" );
-      if ( found ) {
-
-        // --- Transform into sensor system with origin at sensor centre
-        xC -= 0.5 * fDx;
-        yC -= 0.5 * fDy;
-        // --- Create the hit
-        CreateHitVector(xC, yC, varX, varY, varXY, clusterF, clusterB, du, dv);
-        nHits++;
-
-      }  //? Intersection of lines
-    }  // lines on back side
-  }  // lines on front side
+  for (Int_t iLine = 0; iLine < nLines; iLine++) {
+    LOG(debug4) << GetName() << ": Trying " << buf.fXF[iLine] << ", "
+        << buf.fXB[iLine] << ", intersection ( " << buf.fX[iLine] << ", "
+        << buf.fY[iLine] << " ) " << ( buf.fInside[iLine] ? "TRUE" : "FALSE" );
+    if ( ! buf.fInside[iLine] ) continue;
+    Int_t iPair = buf.fPair[iLine];
+    CbmStsCluster* clusterF = pairing.GetFront(pairFront[iPair]);
+    CbmStsCluster* clusterB = pairing.GetBack(pairBack[iPair]);
+    Double_t du = buf.fErrF[iLine] * fCosStereo[0];
+    Double_t dv = buf.fErrB[iLine] * fCosStereo[1];
+
+    // --- Transform into sensor system with origin at sensor centre
+    Double_t xC = buf.fX[iLine] - 0.5 * fDx;
+    Double_t yC = buf.fY[iLine] - 0.5 * fDy;
+    CreateHit(xC, yC, buf.fVarX[iLine], buf.fVarY[iLine], buf.fVarXY[iLine],
+              clusterF, clusterB, du, dv, context);
+    nHits++;
+  } //# lines
 
   return nHits;
 }
@@ -659,7 +633,7 @@ void CbmStsSensorDssdStereo::PropagateCharge(Double_t x, Double_t y,
   // No diffusion: all charge is in one strip
   if ( ! CbmStsPhysics::Instance()->UseDiffusion() ) {
     Int_t iStrip = GetStripNumber(xCharge, yCharge, side);
-    fStripCharge[side][iStrip] += charge;
+    AddStripCharge(side, iStrip, charge);
     LOG(debug4) << GetName() << ": Adding charge " << charge << " to strip "
         << iStrip;
   } //? Do not use diffusion
@@ -700,17 +674,17 @@ void CbmStsSensorDssdStereo::PropagateCharge(Double_t x, Double_t y,
     }
     // Collect charge on the readout strips
     if ( fracC > 0. ) {
-      fStripCharge[side][iStripC] += charge * fracC;    // centre strip
+      AddStripCharge(side, iStripC, charge * fracC);    // centre strip
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracC
           << " to strip " << iStripC;
     }
     if ( fracL > 0. && iStripL >= 0 ) {
-      fStripCharge[side][iStripL] += charge * fracL;  // right neighbour
+      AddStripCharge(side, iStripL, charge * fracL);  // right neighbour
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracL
           << " to strip " << iStripL;
     }
     if ( fracR > 0. && iStripR < fNofStrips ) {
-      fStripCharge[side][iStripR] += charge * fracR;  // left neighbour
+      AddStripCharge(side, iStripR, charge * fracR);  // left neighbour
       LOG(debug4) << GetName() << ": Adding charge " << charge * fracR
           << " to strip " << iStripR;
     }
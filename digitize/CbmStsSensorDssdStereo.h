@@ -224,21 +224,41 @@ class CbmStsSensorDssdStereo : public CbmStsSensorDssd
      **/
     Bool_t Intersect(Double_t xF, Double_t exF, Double_t xB, Double_t exB,
                      Double_t& x, Double_t& y, Double_t& varX, Double_t& varY,
-                     Double_t& varXY);
+                     Double_t& varXY) const;
+
+
+    /** Intersection points for arrays of line pairs
+     ** @param[in] n      Number of line pairs
+     ** @param[in] xF     x coordinates on read-out edge, front side [cm]
+     ** @param[in] exF    Uncertainties on xF [cm]
+     ** @param[in] xB     x coordinates on read-out edge, back side [cm]
+     ** @param[in] exB    Uncertainties on xB [cm]
+     ** @param[out] x     x coordinates of crossings [cm]
+     ** @param[out] y     y coordinates of crossings [cm]
+     ** @param[out] varX  Variances in x [cm^2]
+     ** @param[out] varY  Variances in y [cm^2]
+     ** @param[out] varXY Covariances of x and y [cm^2]
+     ** @param[out] inside  1 if the crossing is inside the active area, else 0
+     **
+     ** Same results as the single-pair version. The case distinction on the
+     ** stereo angles is made once; the loops are free of branches and can
+     ** be vectorised by the compiler.
+     **/
+    void Intersect(Int_t n, const Double_t* xF, const Double_t* exF,
+                   const Double_t* xB, const Double_t* exB, Double_t* x,
+                   Double_t* y, Double_t* varX, Double_t* varY,
+                   Double_t* varXY, Int_t* inside) const;
 
 
-    /** Find the intersection points of two clusters.
-     ** For each intersection point, a hit is created.
-     ** @param clusterF    Pointer to cluster on front side
-     ** @param clusterB    Pointer to cluster on back side
-     ** @param sensor      Pointer to sensor object
-     ** @return Number of intersection points inside active area
+    /** @brief Create hits from all accepted cluster pairs
+     ** @param context  Hit-finding context with the accepted pairs
+     ** @return Number of created hits
+     **
+     ** The cluster positions are calculated once per cluster. The lines
+     ** of all pairs, including the images from the horizontal
+     ** cross-connection, are intersected in one batch.
      **/
-    virtual Int_t IntersectClusters(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB);
-                                  
-    virtual Int_t IntersectClustersVector(CbmStsCluster* clusterF,
-                                    CbmStsCluster* clusterB);
+    virtual Int_t IntersectClusterPairs(CbmStsHitContext& context) const;
 
 
     /** Propagate a charge created in the sensor to the readout strips
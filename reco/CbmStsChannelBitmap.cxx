@@ -0,0 +1,52 @@
+/** @file CbmStsChannelBitmap.cxx
+ **/
+
+#include "CbmStsChannelBitmap.h"
+
+#include <algorithm>
+
+
+// -----   First channel of a run   ----------------------------------------
+UShort_t CbmStsChannelBitmap::RunStart(UShort_t channel,
+                                       UShort_t low) const {
+  assert( IsSet(channel) && low <= channel );
+
+  // Look for the first inactive channel below, word by word
+  Int_t word = channel >> 6;
+  UInt_t bit = channel & 63;
+  while ( word >= 0 && Int_t(word << 6) + 63 >= low ) {
+    ULong64_t below = ( bit == 63 ? ~0ULL : ( 2ULL << bit ) - 1 );
+    ULong64_t holes = ~fWords[word] & below;
+    if ( holes ) {
+      Int_t gap = ( word << 6 ) + 63 - __builtin_clzll(holes);
+      return UShort_t(std::max(gap + 1, Int_t(low)));
+    }
+    word--;
+    bit = 63;
+  }
+  return low;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Last channel of a run   -----------------------------------------
+UShort_t CbmStsChannelBitmap::RunStop(UShort_t channel,
+                                      UShort_t high) const {
+  assert( IsSet(channel) && high >= channel );
+
+  // Look for the first inactive channel above, word by word
+  UInt_t word = channel >> 6;
+  UInt_t bit = channel & 63;
+  while ( word < fWords.size() && ( word << 6 ) <= high ) {
+    ULong64_t holes = ~fWords[word] & ( ~0ULL << bit );
+    if ( holes ) {
+      Int_t gap = ( word << 6 ) + __builtin_ctzll(holes);
+      return UShort_t(std::min(gap - 1, Int_t(high)));
+    }
+    word++;
+    bit = 0;
+  }
+  return high;
+}
+// -------------------------------------------------------------------------
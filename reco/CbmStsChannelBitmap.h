@@ -0,0 +1,97 @@
+/** @file CbmStsChannelBitmap.h
+ **/
+
+#ifndef CBMSTSCHANNELBITMAP_H
+#define CBMSTSCHANNELBITMAP_H 1
+
+#include <cassert>
+#include <vector>
+#include "Rtypes.h"
+
+
+/** @class CbmStsChannelBitmap
+ ** @brief Bit map of the active channels of a module
+ **
+ ** Used by the cluster finders to keep track of the channels holding
+ ** a digi not yet assigned to a cluster. Set channels are found with
+ ** count-trailing-zeros on 64-bit words, such that the flushing of the
+ ** buffers at the end of a time slice or event does not scan all
+ ** channels. Runs of neighbouring active channels are found with
+ ** word-level bit operations.
+ **/
+class CbmStsChannelBitmap
+{
+
+  public:
+
+    /** @brief Constructor
+     ** @param nChannels  Number of channels
+     **/
+    CbmStsChannelBitmap(UShort_t nChannels = 0)
+      : fWords((nChannels + 63) / 64, 0) { }
+
+
+    /** @brief Deactivate a channel **/
+    void Clear(UShort_t channel) {
+      assert( channel / 64 < fWords.size() );
+      fWords[channel >> 6] &= ~( 1ULL << ( channel & 63 ) );
+    }
+
+
+    /** @brief First active channel at or above a given one
+     ** @param channel  Start channel
+     ** @return Active channel number; -1 if there is none
+     **/
+    Int_t FindNext(UInt_t channel) const {
+      UInt_t word = channel >> 6;
+      if ( word >= fWords.size() ) return -1;
+      ULong64_t bits = fWords[word] & ( ~0ULL << ( channel & 63 ) );
+      while ( ! bits ) {
+        if ( ++word == fWords.size() ) return -1;
+        bits = fWords[word];
+      }
+      return Int_t( ( word << 6 ) + __builtin_ctzll(bits) );
+    }
+
+
+    /** @brief Check whether a channel is active **/
+    Bool_t IsSet(UShort_t channel) const {
+      assert( channel / 64 < fWords.size() );
+      return ( fWords[channel >> 6] >> ( channel & 63 ) ) & 1ULL;
+    }
+
+
+    /** @brief Deactivate all channels **/
+    void Reset() { fWords.assign(fWords.size(), 0); }
+
+
+    /** @brief Lowest channel of a run of active channels
+     ** @param channel  Active channel in the run
+     ** @param low      Lower limit of the run
+     ** @return First channel >= low of the run containing channel
+     **/
+    UShort_t RunStart(UShort_t channel, UShort_t low) const;
+
+
+    /** @brief Highest channel of a run of active channels
+     ** @param channel  Active channel in the run
+     ** @param high     Upper limit of the run
+     ** @return Last channel <= high of the run containing channel
+     **/
+    UShort_t RunStop(UShort_t channel, UShort_t high) const;
+
+
+    /** @brief Activate a channel **/
+    void Set(UShort_t channel) {
+      assert( channel / 64 < fWords.size() );
+      fWords[channel >> 6] |= 1ULL << ( channel & 63 );
+    }
+
+
+  private:
+
+    std::vector<ULong64_t> fWords;   ///< Bits of channels, 64 per word
+
+};
+
+#endif
@@ -6,7 +6,9 @@
 #include "CbmStsClusterAnalysis.h"
 
 #include <cassert>
+#include <vector>
 #include "TClonesArray.h"
+#include "FairLogger.h"
 #include "CbmDigiManager.h"
 #include "CbmStsAddress.h"
 #include "CbmStsCluster.h"
@@ -18,199 +20,339 @@ void CbmStsClusterAnalysis::Analyze(CbmStsCluster* cluster,
 		CbmStsModule* module) {
 
 	assert(cluster);
-	assert(module);
-
-	// --- For 1-strip clusters
-	if ( cluster->GetNofDigis() == 1 ) {
 
-		Int_t index = cluster->GetDigi(0);
-		const CbmStsDigi* digi = CbmDigiManager::Instance()->Get<CbmStsDigi>(index);
+	// --- Stage the digi properties. The buffers are per thread, such that
+	// --- no allocation is needed after the first few clusters.
+	Int_t nDigis = cluster->GetNofDigis();
+	thread_local std::vector<UShort_t> channel;
+	thread_local std::vector<UShort_t> adc;
+	thread_local std::vector<Double_t> time;
+	channel.resize(nDigis);
+	adc.resize(nDigis);
+	time.resize(nDigis);
+	for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+		const CbmStsDigi* digi =
+				CbmDigiManager::Instance()->Get<CbmStsDigi>(cluster->GetDigi(iDigi));
 		assert(digi);
-		auto& asic = module->GetAsicParameters(digi->GetChannel());
-		Double_t x = Double_t(digi->GetChannel());
-		Double_t time = digi->GetTime();
-		Double_t timeError = asic.GetTimeResolution();
-		Double_t charge = module->AdcToCharge(digi->GetCharge(), digi->GetChannel());
-		Double_t xError = 1. / sqrt(24.);
-
-		cluster->SetAddress(module->GetAddress());
-		cluster->SetProperties(charge, x, xError, time, timeError);
-		cluster->SetSize(1);
-
-	}  //? 1-strip clusters
-
+		channel[iDigi] = digi->GetChannel();
+		adc[iDigi]     = digi->GetCharge();
+		time[iDigi]    = digi->GetTime();
+	}
 
-	// --- For 2-strip clusters
-	else if ( cluster->GetNofDigis() == 2 )  {
-
-		Int_t index1 = cluster->GetDigi(0);
-		Int_t index2 = cluster->GetDigi(1);
-		const CbmStsDigi* digi1 = CbmDigiManager::Instance()->Get<CbmStsDigi>(index1);
-		const CbmStsDigi* digi2 = CbmDigiManager::Instance()->Get<CbmStsDigi>(index2);
-		assert(digi1);
-		assert(digi2);
-
-		auto& asic1 = module->GetAsicParameters(digi1->GetChannel());
-		auto& asic2 = module->GetAsicParameters(digi2->GetChannel());
+	Analyze(cluster, module, nDigis, channel.data(), adc.data(), time.data());
+}
+// --------------------------------------------------------------------------
 
 
-		// --- Uncertainties of the charge measurements
-		Double_t eNoiseSq = 0.5 * (asic1.GetNoise() * asic1.GetNoise() +
-															 asic2.GetNoise() * asic2.GetNoise());
-		Double_t chargePerAdc = 0.5 * (asic1.GetDynRange() / Double_t(asic1.GetNofAdc()) +
-																	 asic2.GetDynRange() / Double_t(asic2.GetNofAdc()));
-		Double_t eDigitSq = chargePerAdc * chargePerAdc / 12.;
 
+// -----   Algorithm on staged digi data   ---------------------------------
+void CbmStsClusterAnalysis::Analyze(CbmStsCluster* cluster,
+		CbmStsModule* module, Int_t nDigis, const UShort_t* channel,
+		const UShort_t* adc, const Double_t* time) {
 
-		Int_t chan1 = digi1->GetChannel();
-    Int_t chan2 = digi2->GetChannel();
-    assert( chan2 == chan1 + 1 ||
-            chan2 == chan1 - module->GetNofChannels()/2 + 1);
+	assert(cluster);
+	Int_t first[2] = { 0, nDigis };
+	AnalyzeBatch(module, 1, &cluster, first, channel, adc, time);
 
-    // Channel positions and charge
-    Double_t x1 = Double_t(chan1);
-    Double_t q1 = module->AdcToCharge(digi1->GetCharge(), digi1->GetChannel());
-//        Double_t x2 = Double_t(chan2);
-    Double_t q2 = module->AdcToCharge(digi2->GetCharge(), digi2->GetChannel());
+}
+// --------------------------------------------------------------------------
 
-    // Periodic position for clusters round the edge
-    if ( chan1 > chan2 ) x1 -= Double_t(module->GetNofChannels() / 2);
 
-		// Uncertainties of the charge measurements
-        Double_t width1 = fPhysics->LandauWidth(q1);
-		Double_t eq1sq = width1 * width1 + eNoiseSq + eDigitSq;
-		Double_t width2 = fPhysics->LandauWidth(q2);
-		Double_t eq2sq = width2 * width2 + eNoiseSq + eDigitSq;
 
-		// Cluster time
-		Double_t time = 0.5 * ( digi1->GetTime() + digi2->GetTime());
-		Double_t timeError = 0.5 * (asic1.GetTimeResolution() +
-												 			  asic2.GetTimeResolution() ) * 0.70710678; // 1/sqrt(2)
-
-		// Cluster position
-		// See corresponding software note.
-		Double_t x = x1 + 0.5 + ( q2 - q1 ) / 3. /  TMath::Max(q1, q2);
-
-		// Correct negative position for clusters around the edge
-		if ( x < -0.5 ) x += Double_t(module->GetNofChannels() / 2);
-
-		// Uncertainty on cluster position. See software note.
-		Double_t ex0sq = 0.;    // error for ideal charge measurements
-		Double_t ex1sq = 0.;    // error from first charge
-		Double_t ex2sq = 0.;    // error from second charge
-		if ( q1 < q2 ) {
-			ex0sq = (q2 - q1) * (q2 -q1) / q2 / q2 / 72.;
-			ex1sq = eq1sq / q2 / q2 / 9.;
-			ex2sq = eq2sq * q1 * q1 / q2 / q2 / q2 / q2 / 9.;
+// -----   Per-thread work space of the batch analysis   -------------------
+namespace {
+
+	struct BatchBuffers {
+
+		// --- Properties of all digis in the batch
+		std::vector<Double_t> fCharge;        // charge [e]
+		std::vector<Double_t> fNoiseSq;       // squared noise [e^2]
+		std::vector<Double_t> fChargePerAdc;  // ADC bin width [e]
+		std::vector<Double_t> fDigitErrorSq;  // squared digitisation error [e^2]
+		std::vector<Double_t> fTimeResol;     // time resolution [ns]
+		std::vector<Double_t> fLandauWidth;   // Landau width of charge [e]
+		std::vector<Double_t> fChargeErrSq;   // squared charge error [e^2]
+
+		// --- Cluster indices per size bucket (1, 2, n strips)
+		std::vector<Int_t> fBucket[3];
+
+		// --- Cluster input quantities (SoA, per bucket)
+		std::vector<Double_t> fChanF;   // first channel
+		std::vector<Double_t> fChanL;   // last channel
+		std::vector<Double_t> fQF;      // charge first channel
+		std::vector<Double_t> fQM;      // charge middle channels
+		std::vector<Double_t> fQL;      // charge last channel
+		std::vector<Double_t> fEqFsq;   // squared error of qF
+		std::vector<Double_t> fEqMsq;   // squared error of qM
+		std::vector<Double_t> fEqLsq;   // squared error of qL
+		std::vector<Double_t> fTime;    // time sum
+		std::vector<Double_t> fTimeErr; // time resolution sum
+		std::vector<Double_t> fNofDigis;// number of digis
+
+		// --- Cluster results (SoA, per bucket)
+		std::vector<Double_t> fX;
+		std::vector<Double_t> fXError;
+		std::vector<Double_t> fQSum;
+
+		void Resize(Int_t nClusters) {
+			for (auto vec : { &fChanF, &fChanL, &fQF, &fQM, &fQL, &fEqFsq,
+			                  &fEqMsq, &fEqLsq, &fTime, &fTimeErr, &fNofDigis,
+			                  &fX, &fXError, &fQSum } )
+				vec->resize(nClusters);
 		}
-		else {
-			ex0sq = (q2 - q1) * (q2-q1) / q1 / q1 / 72.;
-			ex1sq = eq1sq * q2 * q2 / q1 / q1 / q1 / q1 / 9.;
-			ex2sq = eq2sq / q1 / q1 / 9.;
-		}
-		Double_t xError = TMath::Sqrt( ex0sq + ex1sq + ex2sq);
 
-		// Cluster charge
-		Double_t charge = q1 + q2;
+	};
 
-		cluster->SetAddress(module->GetAddress());
-		cluster->SetProperties(charge, x, xError, time, timeError);
-		cluster->SetSize(2);
+}
+// --------------------------------------------------------------------------
 
-	} //? 2-strip cluster
 
 
-	// --- For clusters with more than 2 strips
-	// It is assumed that the digis are ordered w.r.t. channel number
-	else {
-
-		Double_t tSum = 0.;  // sum of digi times
-//		Double_t eqMidSq = 0.;  // sum of errors of digi charges (middle)
-		Int_t chanF = 9999999;  // first channel in cluster
-		Int_t chanL = -1;  // last channel in cluster
-		Double_t qF = 0.; // charge in first channel
-		Double_t qM = 0.;  // sum of charges in middle channels
-		Double_t qL = 0.; // charge in last cluster
-		Double_t eqFsq = 0.; // uncertainty of qF
-		Double_t eqMsq = 0.;  // uncertainty of qMid
-		Double_t eqLsq = 0.; // uncertainty of qL
-		Double_t prevChannel = 0;
-		Double_t tResolSum = 0.;
-
-		for (Int_t iDigi = 0; iDigi < cluster->GetNofDigis(); iDigi++) {
-
-			Int_t index = cluster->GetDigi(iDigi);
-			const CbmStsDigi* digi = CbmDigiManager::Instance()->Get<CbmStsDigi>(index);
-			assert(digi);
-			Int_t channel = digi->GetChannel();
-
-			auto& asic = module->GetAsicParameters(channel);
-			// --- Uncertainties of the charge measurements
-			Double_t eNoiseSq = asic.GetNoise() * asic.GetNoise();
-			Double_t chargePerAdc = asic.GetDynRange() / Double_t(asic.GetNofAdc());
-			Double_t eDigitSq = chargePerAdc * chargePerAdc / 12.;
-			tResolSum += asic.GetTimeResolution();
-
-			tSum += digi->GetTime();
-			Double_t charge = module->AdcToCharge(digi->GetCharge(), channel);
-			Double_t lWidth = fPhysics->LandauWidth(charge);
-			Double_t eChargeSq = lWidth*lWidth + eNoiseSq + eDigitSq;
-
-			// Check ascending order of channel number
-			if ( iDigi > 0 )
-			  assert(channel == prevChannel + 1 ||
-			         channel == prevChannel - module->GetNofChannels() / 2 + 1);
-			prevChannel = channel;
-
-			if ( iDigi == 0 ) {  // first channel
-				chanF = channel;
-				qF = charge;
-				eqFsq = eChargeSq;
-			}
-			else if ( iDigi == cluster->GetNofDigis()-1) { // last channel
-				chanL = channel;
-				qL = charge;
-				eqLsq = eChargeSq;
-			}
-			else {   // one of the middle channels
-				qM += charge;
-				eqMsq += eChargeSq;
-			}
+// -----   Batch algorithm on staged digi data   ----------------------------
+void CbmStsClusterAnalysis::AnalyzeBatch(CbmStsModule* module,
+		Int_t nClusters, CbmStsCluster* const* clusters, const Int_t* first,
+		const UShort_t* channel, const UShort_t* adc, const Double_t* time) {
 
-		} //# digis in cluster
+	assert(module);
+	if ( nClusters <= 0 ) return;
+
+	thread_local BatchBuffers buf;
+	const Int_t offset = first[0];
+	const Int_t nDigis = first[nClusters] - offset;
+	const Double_t half = Double_t(module->GetNofChannels() / 2);
+	const Int_t halfInt = module->GetNofChannels() / 2;
+	const Int_t address = module->GetAddress();
+
+	// --- Digi properties from the ASIC tables of the module. The tables are
+	// --- built in the Init of the reco tasks; they cannot be rebuilt here
+	// --- since the batches of a module may be analysed concurrently.
+	if ( ! module->HasValidAsicTables() )
+		LOG(fatal) << GetName() << ": ASIC tables of module "
+				<< module->GetName() << " are outdated; call UpdateAsicTables "
+				<< "after modifying the parameters";
+	buf.fCharge.resize(nDigis);
+	buf.fNoiseSq.resize(nDigis);
+	buf.fChargePerAdc.resize(nDigis);
+	buf.fDigitErrorSq.resize(nDigis);
+	buf.fTimeResol.resize(nDigis);
+	buf.fLandauWidth.resize(nDigis);
+	buf.fChargeErrSq.resize(nDigis);
+	for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+		UShort_t chan = channel[offset + iDigi];
+		UShort_t adcValue = adc[offset + iDigi];
+		const CbmStsModule::AsicTable& asic = module->GetAsicTable(chan);
+		buf.fCharge[iDigi] = ( adcValue < asic.fCharge.size()
+				? asic.fCharge[adcValue] : module->AdcToCharge(adcValue, chan) );
+		buf.fNoiseSq[iDigi] = asic.fNoiseSq;
+		buf.fChargePerAdc[iDigi] = asic.fChargePerAdc;
+		buf.fDigitErrorSq[iDigi] = asic.fDigitErrorSq;
+		buf.fTimeResol[iDigi] = asic.fTimeResolution;
+	}
+	fPhysics->LandauWidth(nDigis, buf.fCharge.data(), buf.fLandauWidth.data());
+
+	// --- Bucket the clusters by size
+	for (auto& bucket : buf.fBucket) bucket.clear();
+	for (Int_t iCluster = 0; iCluster < nClusters; iCluster++) {
+		Int_t size = first[iCluster+1] - first[iCluster];
+		assert(size > 0);
+		buf.fBucket[ size < 3 ? size - 1 : 2 ].push_back(iCluster);
+	}
 
-		// Periodic channel position for clusters round the edge
-		if ( chanF > chanL ) chanF -= module->GetNofChannels()/2;
 
-		// Cluster time and total charge
-		tSum = tSum / Double_t(cluster->GetNofDigis());
-		Double_t tError = (tResolSum / Double_t(cluster->GetNofDigis()))
-				        / TMath::Sqrt(Double_t(cluster->GetNofDigis()));
-		Double_t qSum = qF + qM + qL;
+	// --- For 1-strip clusters
+	const Double_t xError1 = 1. / sqrt(24.);
+	for (Int_t iCluster : buf.fBucket[0]) {
+		Int_t digi = first[iCluster];
+		CbmStsCluster* cluster = clusters[iCluster];
+		cluster->SetAddress(address);
+		cluster->SetProperties(buf.fCharge[digi - offset], Double_t(channel[digi]),
+		                       xError1, time[digi], buf.fTimeResol[digi - offset]);
+		cluster->SetSize(1);
+	} //# 1-strip clusters
 
-		// Average charge in middle strips
-		qM /= Double_t(cluster->GetNofDigis() - 2);
-		eqMsq /= Double_t(cluster->GetNofDigis() - 2);
 
-		// Cluster position
-		Double_t x = 0.5 * ( Double_t( chanF + chanL ) + ( qL - qF ) / qM );
+	// --- For 2-strip clusters
+	// The first and second channel are stored as F and L.
+	const std::vector<Int_t>& bucket2 = buf.fBucket[1];
+	Int_t n2 = bucket2.size();
+	buf.Resize(n2);
+	for (Int_t index = 0; index < n2; index++) {
+		Int_t digi = first[bucket2[index]];
+		Int_t local = digi - offset;
+		assert( channel[digi+1] == channel[digi] + 1 ||
+		        channel[digi+1] == channel[digi] - halfInt + 1);
+		buf.fChanF[index] = Double_t(channel[digi]);
+		buf.fChanL[index] = Double_t(channel[digi+1]);
+		buf.fQF[index] = buf.fCharge[local];
+		buf.fQL[index] = buf.fCharge[local+1];
 
-		// Correct negative cluster position for clusters round the edge
-		if ( x < - 0.5 ) x += Double_t(module->GetNofChannels() / 2);
+		// Uncertainties of the charge measurements
+		Double_t eNoiseSq = 0.5 * ( buf.fNoiseSq[local] + buf.fNoiseSq[local+1] );
+		Double_t chargePerAdc = 0.5 * ( buf.fChargePerAdc[local]
+		                                + buf.fChargePerAdc[local+1] );
+		Double_t eDigitSq = chargePerAdc * chargePerAdc / 12.;
+		Double_t width1 = buf.fLandauWidth[local];
+		Double_t width2 = buf.fLandauWidth[local+1];
+		buf.fEqFsq[index] = width1 * width1 + eNoiseSq + eDigitSq;
+		buf.fEqLsq[index] = width2 * width2 + eNoiseSq + eDigitSq;
 
-		// Cluster position error
-		Double_t exFsq = eqFsq / qM / qM / 4.;  // error from first charge
-		Double_t exMsq = eqMsq * (qL - qF) * (qL - qF) / qM / qM / qM / qM / 4.;
-		Double_t exLsq = eqLsq / qM / qM / 4.;
-//		Double_t ex1sq = 0.;    // error from first charge
-//		Double_t ex2sq = 0.;    // error from second charge
-		Double_t xError = TMath::Sqrt(exFsq + exMsq + exLsq);
+		// Cluster time
+		buf.fTime[index] = 0.5 * ( time[digi] + time[digi+1] );
+		buf.fTimeErr[index] = 0.5 * ( buf.fTimeResol[local]
+		                              + buf.fTimeResol[local+1] ) * 0.70710678;
+	}
+	{
+		const Double_t* chan1 = buf.fChanF.data();
+		const Double_t* chan2 = buf.fChanL.data();
+		const Double_t* q1 = buf.fQF.data();
+		const Double_t* q2 = buf.fQL.data();
+		const Double_t* eq1sq = buf.fEqFsq.data();
+		const Double_t* eq2sq = buf.fEqLsq.data();
+		Double_t* xOut = buf.fX.data();
+		Double_t* xErrOut = buf.fXError.data();
+		Double_t* qOut = buf.fQSum.data();
+		for (Int_t index = 0; index < n2; index++) {
+
+			// Periodic position for clusters round the edge
+			Double_t x1 = chan1[index] - ( chan1[index] > chan2[index] ? half : 0. );
+
+			// Cluster position. See corresponding software note.
+			Double_t qMax = ( q1[index] >= q2[index] ? q1[index] : q2[index] );
+			Double_t x = x1 + 0.5 + ( q2[index] - q1[index] ) / 3. / qMax;
+
+			// Correct negative position for clusters around the edge
+			xOut[index] = x + ( x < -0.5 ? half : 0. );
+
+			// Uncertainty on cluster position. See software note.
+			Bool_t isSecondLarger = q1[index] < q2[index];
+			Double_t dq = q2[index] - q1[index];
+			Double_t ex0sq = dq * dq / qMax / qMax / 72.;
+			Double_t ex1sq = ( isSecondLarger
+					? eq1sq[index] / q2[index] / q2[index] / 9.
+					: eq1sq[index] * q2[index] * q2[index]
+					  / q1[index] / q1[index] / q1[index] / q1[index] / 9. );
+			Double_t ex2sq = ( isSecondLarger
+					? eq2sq[index] * q1[index] * q1[index]
+					  / q2[index] / q2[index] / q2[index] / q2[index] / 9.
+					: eq2sq[index] / q1[index] / q1[index] / 9. );
+			xErrOut[index] = sqrt( ex0sq + ex1sq + ex2sq );
+
+			// Cluster charge
+			qOut[index] = q1[index] + q2[index];
+		}
+	}
+	for (Int_t index = 0; index < n2; index++) {
+		CbmStsCluster* cluster = clusters[bucket2[index]];
+		cluster->SetAddress(address);
+		cluster->SetProperties(buf.fQSum[index], buf.fX[index],
+		                       buf.fXError[index], buf.fTime[index],
+		                       buf.fTimeErr[index]);
+		cluster->SetSize(2);
+	} //# 2-strip clusters
 
-		cluster->SetAddress(module->GetAddress());
-		cluster->SetProperties(qSum, x, xError, tSum, tError);
-		cluster->SetSize(chanL - chanF + 1);
 
-	} //? n-strip cluster
+	// --- For clusters with more than 2 strips
+	// It is assumed that the digis are ordered w.r.t. channel number
+	const std::vector<Int_t>& bucketN = buf.fBucket[2];
+	Int_t nN = bucketN.size();
+	buf.Resize(nN);
+
+	// Uncertainties of the charge measurements
+	for (Int_t iCluster : bucketN) {
+		for (Int_t local = first[iCluster] - offset;
+				local < first[iCluster+1] - offset; local++) {
+			Double_t lWidth = buf.fLandauWidth[local];
+			buf.fChargeErrSq[local] = lWidth * lWidth + buf.fNoiseSq[local]
+					+ buf.fDigitErrorSq[local];
+		}
+	}
+
+	// Sums over the digis of the clusters
+	for (Int_t index = 0; index < nN; index++) {
+		Int_t iCluster = bucketN[index];
+		Int_t firstLocal = first[iCluster] - offset;
+		Int_t lastLocal = first[iCluster+1] - offset - 1;
+		Double_t tSum = 0.;
+		Double_t tResolSum = 0.;
+		Double_t qM = 0.;
+		Double_t eqMsq = 0.;
+		for (Int_t local = firstLocal; local <= lastLocal; local++) {
+			tSum += time[offset + local];
+			tResolSum += buf.fTimeResol[local];
+			if ( local > firstLocal ) {
+				// Check ascending order of channel number
+				assert( channel[offset+local] == channel[offset+local-1] + 1 ||
+				        channel[offset+local] == channel[offset+local-1] - halfInt + 1);
+				if ( local < lastLocal ) {
+					qM += buf.fCharge[local];
+					eqMsq += buf.fChargeErrSq[local];
+				}
+			}
+		}
+		buf.fChanF[index] = Double_t(channel[offset + firstLocal]);
+		buf.fChanL[index] = Double_t(channel[offset + lastLocal]);
+		buf.fQF[index] = buf.fCharge[firstLocal];
+		buf.fQL[index] = buf.fCharge[lastLocal];
+		buf.fQM[index] = qM;
+		buf.fEqFsq[index] = buf.fChargeErrSq[firstLocal];
+		buf.fEqLsq[index] = buf.fChargeErrSq[lastLocal];
+		buf.fEqMsq[index] = eqMsq;
+		buf.fTime[index] = tSum;
+		buf.fTimeErr[index] = tResolSum;
+		buf.fNofDigis[index] = Double_t(lastLocal - firstLocal + 1);
+	}
+	{
+		Double_t* chanF = buf.fChanF.data();
+		const Double_t* chanL = buf.fChanL.data();
+		const Double_t* qF = buf.fQF.data();
+		const Double_t* qMid = buf.fQM.data();
+		const Double_t* qL = buf.fQL.data();
+		const Double_t* eqFsq = buf.fEqFsq.data();
+		const Double_t* eqMid = buf.fEqMsq.data();
+		const Double_t* eqLsq = buf.fEqLsq.data();
+		const Double_t* nDig = buf.fNofDigis.data();
+		Double_t* tOut = buf.fTime.data();
+		Double_t* tErrOut = buf.fTimeErr.data();
+		Double_t* xOut = buf.fX.data();
+		Double_t* xErrOut = buf.fXError.data();
+		Double_t* qOut = buf.fQSum.data();
+		for (Int_t index = 0; index < nN; index++) {
+
+			// Periodic channel position for clusters round the edge
+			chanF[index] -= ( chanF[index] > chanL[index] ? half : 0. );
+
+			// Cluster time and total charge
+			tErrOut[index] = ( tErrOut[index] / nDig[index] ) / sqrt(nDig[index]);
+			tOut[index] = tOut[index] / nDig[index];
+			qOut[index] = qF[index] + qMid[index] + qL[index];
+
+			// Average charge in middle strips
+			Double_t qM = qMid[index] / ( nDig[index] - 2. );
+			Double_t eqMsq = eqMid[index] / ( nDig[index] - 2. );
+
+			// Cluster position
+			Double_t x = 0.5 * ( ( chanF[index] + chanL[index] )
+			                     + ( qL[index] - qF[index] ) / qM );
+
+			// Correct negative cluster position for clusters round the edge
+			xOut[index] = x + ( x < -0.5 ? half : 0. );
+
+			// Cluster position error
+			Double_t dq = qL[index] - qF[index];
+			Double_t exFsq = eqFsq[index] / qM / qM / 4.;
+			Double_t exMsq = eqMsq * dq * dq / qM / qM / qM / qM / 4.;
+			Double_t exLsq = eqLsq[index] / qM / qM / 4.;
+			xErrOut[index] = sqrt( exFsq + exMsq + exLsq );
+		}
+	}
+	for (Int_t index = 0; index < nN; index++) {
+		CbmStsCluster* cluster = clusters[bucketN[index]];
+		cluster->SetAddress(address);
+		cluster->SetProperties(buf.fQSum[index], buf.fX[index],
+		                       buf.fXError[index], buf.fTime[index],
+		                       buf.fTimeErr[index]);
+		cluster->SetSize(Int_t(buf.fChanL[index] - buf.fChanF[index]) + 1);
+	} //# n-strip clusters
 
 }
 // --------------------------------------------------------------------------
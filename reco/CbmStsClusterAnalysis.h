@@ -47,6 +47,45 @@ class CbmStsClusterAnalysis : public TObject
 		void Analyze(CbmStsCluster* cluster, CbmStsModule* module);
 
 
+		/** Algorithm implementation on staged digi data
+		 ** @param cluster    Pointer to cluster object
+		 ** @param module     Pointer to CbmStsModule to be operated on
+		 ** @param nDigis     Number of digis in the cluster
+		 ** @param channel    Array of digi channels, in cluster order
+		 ** @param adc        Array of digi ADC values
+		 ** @param time       Array of digi times [ns]
+		 **
+		 ** Same algorithm as above, but the digi properties are read from
+		 ** the arrays instead of being fetched through CbmDigiManager.
+		 **/
+		void Analyze(CbmStsCluster* cluster, CbmStsModule* module,
+		             Int_t nDigis, const UShort_t* channel,
+		             const UShort_t* adc, const Double_t* time);
+
+
+		/** @brief Batch analysis of the clusters of one module
+		 ** @param module     Pointer to CbmStsModule the clusters belong to
+		 ** @param nClusters  Number of clusters
+		 ** @param clusters   Array of cluster pointers
+		 ** @param first      Array of nClusters+1 offsets: the digis of
+		 **                   cluster i are [first[i], first[i+1]) in the
+		 **                   digi arrays
+		 ** @param channel    Array of digi channels, in cluster order
+		 ** @param adc        Array of digi ADC values
+		 ** @param time       Array of digi times [ns]
+		 **
+		 ** Same algorithm as Analyze, but the clusters are bucketed by size
+		 ** (1, 2, and more strips), and each bucket is processed in
+		 ** structure-of-arrays form with branch-free loops, which the
+		 ** compiler can vectorise. The results are identical to those of
+		 ** the per-cluster analysis.
+		 **/
+		void AnalyzeBatch(CbmStsModule* module, Int_t nClusters,
+		                  CbmStsCluster* const* clusters, const Int_t* first,
+		                  const UShort_t* channel, const UShort_t* adc,
+		                  const Double_t* time);
+
+
 	protected:
 
 		CbmStsPhysics* fPhysics;  //! Instance of physics tool
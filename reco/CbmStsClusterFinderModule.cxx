@@ -20,7 +20,8 @@ ClassImp(CbmStsClusterFinderModule)
 CbmStsClusterFinderModule::CbmStsClusterFinderModule() :
   TNamed(), fSize(0), fTimeCutInSigma(3.), fTimeCut(-1.),
   fConnectEdgeFront(kFALSE), fConnectEdgeBack(kFALSE),
-  fModule(NULL), fClusters(NULL), fIndex(), fTime()
+  fModule(NULL), fClusters(NULL), fIndex(), fTime(), fActive(), fTimeCutTable(),
+  fParameterVersion(0)
 {
 }
 // -------------------------------------------------------------------------
@@ -42,9 +43,13 @@ CbmStsClusterFinderModule::CbmStsClusterFinderModule(UShort_t nChannels,
   fConnectEdgeBack(kFALSE),
   fModule(module),
   fClusters(output),
-  fIndex(fSize),
-  fTime(fSize)
+  fIndex(fSize, -1),
+  fTime(fSize, 0.),
+  fActive(fSize),
+  fTimeCutTable(),
+  fParameterVersion(0)
 {
+  if ( ! fModule || fModule->IsSet() ) UpdateTimeCuts();
 }
 // -------------------------------------------------------------------------
 
@@ -69,12 +74,9 @@ Bool_t CbmStsClusterFinderModule::CheckChannel(UShort_t channel,
 
   assert( time >= fTime[channel] );
 
-  Double_t deltaT = fTimeCutInSigma * TMath::Sqrt(2.) * fModule->GetAsicParameters(channel).GetTimeResolution();
-  if ( fTimeCut > 0. ) deltaT = fTimeCut;
-
   // Channel is active, but time is not matching: close cluster
   // and return no match.
-  if ( time - fTime[channel] > deltaT ) {
+  if ( time - fTime[channel] > fTimeCutTable[channel] ) {
     FinishCluster(channel);
     return kFALSE;
   }
@@ -105,6 +107,7 @@ void CbmStsClusterFinderModule::CreateCluster(UShort_t first,
     cluster->AddDigi(fIndex[channel]);
     fIndex[channel] = -1;
     fTime[channel] = 0.;
+    fActive.Clear(channel);
     if ( channel == last ) break;
     channel++;
     if ( last < first && channel == fSize/2 ) channel = 0; // round the edge, front side
@@ -124,72 +127,28 @@ void CbmStsClusterFinderModule::CreateCluster(UShort_t first,
 // -----   Close a cluster   -----------------------------------------------
 void CbmStsClusterFinderModule::FinishCluster(UShort_t channel) {
 
-  // Find start and stop channel of cluster
-  UShort_t start = channel;
-  UShort_t stop = channel;
-  UShort_t testChannel;
-
-  // Case: front-side channel
-  if ( channel < fSize/2 ) {
-
-    // Normal clustering
-    if ( ! fConnectEdgeFront ) {
-      while ( start > 0 && fIndex[start-1] > -1 ) start--;
-      while ( stop < fSize/2 - 1 && fIndex[stop+1] > -1 ) stop++;
-    } //? normal clustering
-
-    // Clustering round-the-edge
-    else {
-      testChannel = ( channel ? channel - 1 : fSize/2 - 1);
-      while ( fIndex[testChannel] > -1 ) {
-        start = testChannel;
-        testChannel = ( start ? start - 1 : fSize/2 - 1);
-      }
-      testChannel = ( channel == fSize/2 - 1 ? 0 : channel + 1);
-      while ( fIndex[testChannel] > -1 ) {
-        stop = testChannel;
-        testChannel = ( stop == fSize/2 - 1 ? 0 : stop + 1);
-      }
-    } //? clustering round the edge
-
-  } //? Front-side channel
-
-
-  // Case: back-side channel
-  else  {
-
-    // Normal clustering
-    if ( ! fConnectEdgeBack ) {
-      while ( start > fSize/2 && fIndex[start-1] > -1 ) start--;
-      while ( stop < fSize - 1 && fIndex[stop+1] > -1 ) stop++;
-    }
-
-    // Clustering round-the-edge
-    else {
-      testChannel = ( channel == fSize/2 ? fSize - 1 : channel - 1);
-      while ( fIndex[testChannel] > -1 ) {
-        start = testChannel;
-        testChannel = ( start == fSize/2 ? fSize - 1 : start - 1);
-      }
-      testChannel = ( channel == fSize - 1 ? fSize/2 : channel + 1);
-      while ( fIndex[testChannel] > -1 ) {
-        stop = testChannel;
-        testChannel = ( stop == fSize - 1 ? fSize/2 : stop + 1);
-      }
-    } //? clustering round the edge
-
-  }//? back-side channel
-
-  // Create a cluster object
+  // Channel range of the module side
+  UShort_t low  = ( channel < fSize/2 ? 0 : fSize/2 );
+  UShort_t high = low + fSize/2 - 1;
+  Bool_t connectEdge = ( channel < fSize/2 ? fConnectEdgeFront
+                                           : fConnectEdgeBack );
+
+  // Find start and stop channel of cluster from the runs of active channels
+  UShort_t start = fActive.RunStart(channel, low);
+  UShort_t stop = fActive.RunStop(channel, high);
+
+  // Clustering round-the-edge: continue the run on the other end of the side.
+  // If all channels of the side are active, the cluster spans the full side.
+  if ( connectEdge && ! ( start == low && stop == high ) ) {
+    if ( start == low && fActive.IsSet(high) )
+      start = fActive.RunStart(high, stop + 1);
+    if ( stop == high && fActive.IsSet(low) )
+      stop = fActive.RunStop(low, start - 1);
+  } //? clustering round the edge
+
+  // Create a cluster object. The channels are reset there.
   CreateCluster(start, stop);
 
-  // Reset channels added to the cluster
-  for (UShort_t iChannel = start; iChannel <= stop; iChannel++) {
-    assert( iChannel <= fSize );
-    fIndex[iChannel] = -1;
-    fTime[iChannel] = 0.;
-  }
-
 }
 // -------------------------------------------------------------------------
 
@@ -198,10 +157,10 @@ void CbmStsClusterFinderModule::FinishCluster(UShort_t channel) {
 // -----   Process active clusters   ---------------------------------------
 void CbmStsClusterFinderModule::ProcessBuffer() {
 
-  for (UShort_t channel = 0; channel < fSize; channel++) {
-    if ( fIndex[channel] == - 1 ) continue;
+  // Active channels are found from the bitmap in ascending order
+  for (Int_t channel = fActive.FindNext(0); channel >= 0;
+       channel = fActive.FindNext(channel))
     FinishCluster(channel);
-  }
 
 }
 // -------------------------------------------------------------------------
@@ -239,6 +198,7 @@ Bool_t CbmStsClusterFinderModule::ProcessDigi(UShort_t channel, Double_t time,
   // Set channel active
   fIndex[channel] = index;
   fTime[channel] = time;
+  fActive.Set(channel);
 
   return kTRUE;
 }
@@ -246,11 +206,38 @@ Bool_t CbmStsClusterFinderModule::ProcessDigi(UShort_t channel, Double_t time,
 
 
 
+// -----   Update the time cut table   -------------------------------------
+void CbmStsClusterFinderModule::UpdateTimeCuts() {
+
+  // Nothing to do if the module parameters did not change
+  if ( ! fTimeCutTable.empty()
+       && ( ! fModule || fModule->GetParameterVersion() == fParameterVersion ) )
+    return;
+
+  fTimeCutTable.resize(fSize);
+  for (UShort_t channel = 0; channel < fSize; channel++) {
+    if ( fTimeCut > 0. || ! fModule ) fTimeCutTable[channel] = fTimeCut;
+    else fTimeCutTable[channel] = fTimeCutInSigma * TMath::Sqrt(2.)
+        * fModule->GetAsicParameters(channel).GetTimeResolution();
+  }
+  if ( fModule ) fParameterVersion = fModule->GetParameterVersion();
+
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Reset the channel vectors   -------------------------------------
 void CbmStsClusterFinderModule::Reset() {
 
-  fIndex.assign(fSize, -1);
-  fTime.assign(fSize, 0.);
+  // Only the active channels need to be reset
+  for (Int_t channel = fActive.FindNext(0); channel >= 0;
+       channel = fActive.FindNext(channel + 1)) {
+    fIndex[channel] = -1;
+    fTime[channel] = 0.;
+  }
+  fActive.Reset();
+  UpdateTimeCuts();
 
 }
 // -------------------------------------------------------------------------
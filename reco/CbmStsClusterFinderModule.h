@@ -8,6 +8,7 @@
 
 #include <vector>
 #include "TNamed.h"
+#include "CbmStsChannelBitmap.h"
 #include "CbmStsModule.h"
 
 class TClonesArray;
@@ -138,6 +139,9 @@ class CbmStsClusterFinderModule : public TNamed
     TClonesArray* fClusters;      //! Output array for clusters
     std::vector<Int_t> fIndex;    //! Channel -> digi index
     std::vector<Double_t> fTime;  //! Channel -> digi time
+    CbmStsChannelBitmap fActive;  //! Channels with active digi
+    std::vector<Double_t> fTimeCutTable; //! Channel -> max. time difference [ns]
+    UInt_t fParameterVersion;     //! Module parameter version of the table
 
 
     /** Check for a matching digi in a given channel
@@ -159,6 +163,14 @@ class CbmStsClusterFinderModule : public TNamed
     void CreateCluster(UShort_t first, UShort_t last);
 
 
+    /** @brief Update the time cut per channel
+     **
+     ** The table is built from the time resolution of the asics (or from
+     ** the user-set value) and rebuilt when the module parameters changed.
+     **/
+    void UpdateTimeCuts();
+
+
     /** Close an active cluster
      ** @param channel  Channel number
      **/
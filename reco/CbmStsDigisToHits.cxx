@@ -5,6 +5,7 @@
 
 #include "CbmStsDigisToHits.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
 #include <omp.h>
@@ -50,6 +51,22 @@ CbmStsDigisToHits::CbmStsDigisToHits(ECbmMode mode, Bool_t ClusterOutputMode, Bo
     , fModuleIndex()
     , fClusterOutputMode(ClusterOutputMode)
     , fParallelism_enabled(Parallelism_enabled)
+    , fDigiChannel()
+    , fDigiTime()
+    , fDigiCharge()
+    , fDigiIndex()
+    , fDigiModule()
+    , fChunkOffset()
+    , fModuleOffset()
+    , fModuleLoad()
+    , fScheduler()
+    , fTiming()
+    , fTimingFile()
+    , fClusterOffset()
+    , fHitOffset()
+    , fWorkspaces()
+    , fArenas()
+    , fEventOutput()
     , fNofHits(0.)
     , fNofTimeslices(0)
     , fNofEvents(0)
@@ -73,14 +90,52 @@ CbmStsDigisToHits::~CbmStsDigisToHits() {
   if ( fAna ) delete fAna;
 
   // Delete cluster finder modules
-  auto it = fModules.begin();
-  while ( it != fModules.end() ) delete it->second;
+  for (auto it = fModules.begin(); it != fModules.end(); it++)
+    delete it->second;
+
+  // Delete event workspaces
+  for (EventWorkspace* workspace : fWorkspaces) {
+    for (CbmStsDigisToHitsModule* module : workspace->fModules) delete module;
+    delete workspace;
+  }
+
+  // Delete arenas
+  for (CbmStsRecoArena* arena : fArenas) delete arena;
 
 }
 // -------------------------------------------------------------------------
 
 
 
+// -----   Instantiate a reco module   -------------------------------------
+CbmStsDigisToHitsModule* CbmStsDigisToHits::CreateModule(Int_t iModule) {
+
+  CbmStsModule* module = fSetup->GetModule(iModule);
+  assert(module);
+  assert(module->IsSet());
+  const char* name = module->GetName();
+  UShort_t nChannels = module->GetNofChannels();
+  CbmStsDigisToHitsModule* finderModule =
+      new CbmStsDigisToHitsModule(nChannels, fTimeCutDigisInNs, fTimeCutDigisInSigma, fTimeCutClustersInNs, fTimeCutClustersInSigma, name, module, iModule, fAna);
+
+  // --- Check whether there be round-the corner clustering. This happens
+  // --- only for DssdStereo sensors with non-vanishing stereo angle, where
+  // --- a double-metal layer horizontally connects strips.
+  CbmStsSensorDssdStereo* sensor =
+      dynamic_cast<CbmStsSensorDssdStereo*>(module->GetDaughter(0));
+  if ( sensor ) {
+    if ( TMath::Abs(sensor->GetStereoAngle(0)) > 1. )
+      finderModule->ConnectEdgeFront();
+    if ( TMath::Abs(sensor->GetStereoAngle(1)) > 1. )
+      finderModule->ConnectEdgeBack();
+  }
+
+  return finderModule;
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Initialise the cluster finding modules   ------------------------
 Int_t CbmStsDigisToHits::CreateModules() {
 
@@ -91,31 +146,16 @@ Int_t CbmStsDigisToHits::CreateModules() {
   }
 
   Int_t nModules = fSetup->GetNofModules();
-  fModuleIndex.reserve(nModules);
+  fModuleIndex.resize(nModules);
   for (Int_t iModule = 0; iModule < nModules; iModule++) {
-    CbmStsModule* module = fSetup->GetModule(iModule);
-    assert(module);
-    assert(module->IsSet());
-    Int_t address = module->GetAddress();
-    const char* name = module->GetName();
-    UShort_t nChannels = module->GetNofChannels();
-    CbmStsDigisToHitsModule* finderModule =
-        new CbmStsDigisToHitsModule(nChannels, fTimeCutDigisInNs, fTimeCutDigisInSigma, fTimeCutClustersInNs, fTimeCutClustersInSigma, name, module, iModule, fAna);
-
-    // --- Check whether there be round-the corner clustering. This happens
-    // --- only for DssdStereo sensors with non-vanishing stereo angle, where
-    // --- a double-metal layer horizontally connects strips.
-    CbmStsSensorDssdStereo* sensor =
-        dynamic_cast<CbmStsSensorDssdStereo*>(module->GetDaughter(0));
-    if ( sensor ) {
-      if ( TMath::Abs(sensor->GetStereoAngle(0)) > 1. )
-        finderModule->ConnectEdgeFront();
-      if ( TMath::Abs(sensor->GetStereoAngle(1)) > 1. )
-        finderModule->ConnectEdgeBack();
-    }
-    fModules[address] = finderModule;
+    fSetup->GetModule(iModule)->UpdateAsicTables();  // used by the analysis
+    CbmStsDigisToHitsModule* finderModule = CreateModule(iModule);
+    fModules[fSetup->GetModule(iModule)->GetAddress()] = finderModule;
     fModuleIndex[iModule] = finderModule;
   }
+  fTiming.Init(nModules, omp_get_max_threads());
+  for (Int_t iModule = 0; iModule < nModules; iModule++)
+    fTiming.SetModuleName(iModule, fSetup->GetModule(iModule)->GetName());
   LOG(info) << GetName() << ": " << fModules.size()
   		<< " reco modules created.";
 
@@ -134,11 +174,15 @@ void CbmStsDigisToHits::SetParContainers()
 // -----   Task execution   ------------------------------------------------
 void CbmStsDigisToHits::Exec(Option_t*) {
 
-  // --- Clear output array
-  fHits->Delete();
+  // --- Clear output arrays. The objects are kept and overwritten
+  // --- by assignment, which reuses the storage of the digi lists.
+  fHits->Clear("C");
+  fClusters->Clear("C");
 
-  // --- Reset output array
-  fClusters->Delete();
+  // --- Reset the arenas of the threads
+  Int_t nThreads = ( fParallelism_enabled ? omp_get_max_threads() : 1 );
+  ResetArenas(nThreads);
+  fTiming.Init(fModuleIndex.size(), nThreads);
 
   // --- Time-slice mode: process entire array
   if ( fMode == kCbmTimeslice ) ProcessData(nullptr);
@@ -150,13 +194,10 @@ void CbmStsDigisToHits::Exec(Option_t*) {
     LOG(info) << setw(20) << left << GetName() << ": Processing time slice "
         << fNofTimeslices << " with " << nEvents
         << (nEvents == 1 ? " event" : " events");
-    for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
-      CbmEvent* event = dynamic_cast<CbmEvent*>(fEvents->At(iEvent));
-      assert(event);
-      ProcessData(event);
-    } //# events
+    ProcessEvents();
   } //? event mode
 
+  fTiming.EndSlice();
   fNofTimeslices++;
 }
 // -------------------------------------------------------------------------
@@ -170,6 +211,38 @@ void CbmStsDigisToHits::Finish() {
   LOG(info) << "=====================================";
   LOG(info) << GetName() << ": Run summary";
   LOG(info) << "Time slices           : " << fNofTimeslices;
+  LOG(info) << "Module scheduling     : " << fScheduler.ToString();
+  Long64_t bytesNew = 0;
+  Long64_t bytesReused = 0;
+  for (CbmStsRecoArena* arena : fArenas) {
+    arena->Reset();
+    bytesNew += arena->GetBytesNew();
+    bytesReused += arena->GetBytesReused();
+  }
+  LOG(info) << "Arena storage         : " << bytesReused / 1048576.
+      << " MB reused, " << bytesNew / 1048576. << " MB newly allocated";
+  Long64_t nPairsTested = 0;
+  Long64_t nPairsAccepted = 0;
+  Long64_t nPairsTotal = 0;
+  std::vector<CbmStsDigisToHitsModule*> finderModules(fModuleIndex);
+  for (EventWorkspace* workspace : fWorkspaces)
+    for (CbmStsDigisToHitsModule* module : workspace->fModules)
+      if ( module ) finderModules.push_back(module);
+  for (CbmStsDigisToHitsModule* module : finderModules) {
+    const CbmStsClusterPairing& pairing = module->GetHitContext().GetPairing();
+    nPairsTested += pairing.GetNofPairsTested();
+    nPairsAccepted += pairing.GetNofPairsAccepted();
+    nPairsTotal += pairing.GetNofPairsTotal();
+  }
+  LOG(info) << "Cluster pairs         : " << nPairsTested << " tested, "
+      << nPairsAccepted << " accepted (of " << nPairsTotal << ")";
+  LOG(info) << "Stage timing          : \n" << fTiming.ToString();
+  if ( ! fTimingFile.empty() ) {
+    if ( fTiming.Write(fTimingFile, GetName()) )
+      LOG(info) << "Timing summary written to " << fTimingFile;
+    else LOG(error) << GetName() << ": Cannot write timing summary to "
+        << fTimingFile;
+  }
 
   // --- Time-slice mode
   if ( fMode == kCbmTimeslice ) {
@@ -313,132 +386,160 @@ InitStatus CbmStsDigisToHits::Init()
 
 
 
+// -----   Provide and reset the per-thread arenas   -----------------------
+void CbmStsDigisToHits::ResetArenas(Int_t nThreads) {
+  while ( Int_t(fArenas.size()) < nThreads )
+    fArenas.push_back(new CbmStsRecoArena());
+  for (CbmStsRecoArena* arena : fArenas) arena->Reset();
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Process one time slice or event   -------------------------------
 void CbmStsDigisToHits::ProcessData(CbmEvent* event) {
 
-  // --- Reset all cluster finder modules
-  fTimer.Start();
 	Int_t nGood    = 0;
 	Int_t nIgnored = 0;
 
-  #pragma omp parallel for schedule(static) if(fParallelism_enabled)
-  for (UInt_t it = 0; it < fModules.size(); it++){
-    fModuleIndex[it]->Reset();
-  }
-  fTimer.Stop();
-  Double_t time1 = fTimer.RealTime();
-
-  // --- Start index of newly created clusters
+  // --- Start index of newly created hits
   Int_t indexFirst = fHits->GetEntriesFast();
 
   // --- Number of input digis
-  fTimer.Start();
   Int_t nDigis = (event ? event->GetNofData(kStsDigi)
       : fDigiManager->GetNofDigis(kSts) );
 
-  // --- Loop over input digis and distribute them to the different modules/sensors
-  Int_t digiIndex = -1;
-  #pragma omp parallel for schedule(static) if(fParallelism_enabled)
-  for (Int_t iDigi = 0; iDigi < nDigis; iDigi++){
-
-    digiIndex = (event ? event->GetIndex(kStsDigi, iDigi) : iDigi);
-    LOG(debug) <<  "digiIndex in loop over input digis: " << digiIndex; 
-
-    //    if (ProcessDigi(digiIndex)) nGood++;
-    //  else nIgnored++;
-    
-    const CbmStsDigi* digi = fDigiManager->Get<const CbmStsDigi>(iDigi);
-    assert(digi);
-    //digi->SetIndex(digiIndex);
-
-    CbmStsDigisToHitsModule* module = fModules.at(digi->GetAddress());
-    assert(module);
-
-    // --- Digi channel
-    UShort_t channel = digi->GetChannel();
-    assert ( channel < module->GetSize() );
-     
-    module->AddDigiToQueue(digi, iDigi);
-  }
-  fTimer.Stop();
-  Double_t time2 = fTimer.RealTime();
-
-  // --- Process remaining clusters in the buffers
-  fTimer.Start();
-  //  Int_t clusterCount = 0;
-
-
-  // Run only parallel if the cluster information is not written to the output
-  // If the cluster information is written to the output the hits and the clusters have to be absorbed
-  // from the modules in exactely the same order. Otherwise the reindexing of the cluster ids in the hit
-  // objects can't be done
-  if (!fClusterOutputMode) {
-    LOG(info) << "Availabe Threads: " << omp_get_max_threads();
-    //#pragma omp declare reduction(combineHitOutput:TClonesArray*: omp_out->AbsorbObjects(omp_in)) initializer(omp_priv = new TClonesArray("CbmStsHit", 1e1))
-    #pragma omp declare reduction(combineHitOutputVector: std::vector<CbmStsHit>: omp_out.insert(omp_out.end(), std::make_move_iterator(omp_in.begin()), std::make_move_iterator(omp_in.end())))
-    //TClonesArray* fHitsCopy = new TClonesArray("CbmStsHit", 2000000);
-    std::vector<CbmStsHit> fHitsVectorCopy;
-    // Each Cluster consists of approximately 3 digis
-    fHitsVectorCopy.reserve(static_cast<int>(nDigis/3));
-    //#pragma omp parallel for reduction(combineHitOutput:fHitsCopy) if(fParallelism_enabled)
-
-    #pragma omp parallel for reduction(combineHitOutputVector:fHitsVectorCopy) if(fParallelism_enabled)
-    for (UInt_t it = 0; it < fModules.size(); it++){
-      if (it == 0) LOG(info) << "Processing with " << omp_get_num_threads() << " threads";
-      // Proces Digis in current modul
-      std::vector<CbmStsHit> temp = fModuleIndex[it]->ProcessDigisAndAbsorbAsVector(event);
-
-      // Insert new hits from current modul to all hits
-      fHitsVectorCopy.insert(fHitsVectorCopy.end(), std::make_move_iterator(temp.begin()), std::make_move_iterator(temp.end()));
-    }
+  // --- The time slice is processed in one parallel region, such that the
+  // --- threads are forked and joined only once. Barriers remain only where
+  // --- a stage depends on all chunks of the input or on all modules: after
+  // --- the counting and the scattering of the digis, and before the output
+  // --- is copied. In between, each module is a task (reset, clustering
+  // --- with cluster analysis, hit finding), which overlaps with the tasks
+  // --- of the other modules.
+  // --- The distribution of the digis to the modules is done lock-free in
+  // --- two passes over contiguous chunks of the input, one chunk per
+  // --- thread. The first pass counts the digis per module in each chunk.
+  // --- A prefix sum over modules and chunks gives each chunk a private
+  // --- write range in the staging arrays (structure of arrays), into which
+  // --- the second pass scatters. Since the chunks are ordered and each is
+  // --- scanned sequentially, the input order of the digis is preserved
+  // --- within each module.
+  Int_t nModules = fModuleIndex.size();
+  Int_t nThreads = ( fParallelism_enabled ? omp_get_max_threads() : 1 );
+  Int_t nChunks  = nThreads;
+  Int_t chunkSize = ( nDigis + nChunks - 1 ) / nChunks;
+  fDigiModule.resize(nDigis);
+  fChunkOffset.assign(nChunks * nModules, 0);
+  fModuleOffset.resize(nModules + 1);
+  fModuleLoad.resize(nModules);
+  fClusterOffset.resize(nModules + 1);
+  fHitOffset.resize(nModules + 1);
+  Double_t tStart = omp_get_wtime();
+  Double_t tDistributed = tStart;
+  Double_t tProcessed = tStart;
+
+  #pragma omp parallel if(fParallelism_enabled)
+  {
+    Int_t thread = omp_get_thread_num();
+
+    // --- First pass: module of each digi and histogram per chunk
+    #pragma omp for schedule(static, 1)
+    for (Int_t iChunk = 0; iChunk < nChunks; iChunk++) {
+      Int_t* count = fChunkOffset.data() + iChunk * nModules;
+      Int_t lastDigi = std::min(nDigis, (iChunk + 1) * chunkSize);
+      for (Int_t iDigi = iChunk * chunkSize; iDigi < lastDigi; iDigi++) {
+        Int_t digiIndex = (event ? event->GetIndex(kStsDigi, iDigi) : iDigi);
+        const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(digiIndex);
+        assert(digi);
+        Int_t iModule = fSetup->GetModuleIndex(digi->GetAddress());
+        assert( iModule >= 0 && iModule < nModules );
+        assert ( digi->GetChannel() < fModuleIndex[iModule]->GetSize() );
+        fDigiModule[iDigi] = iModule;
+        count[iModule]++;
+      } //# digis in chunk
+    } //# chunks
+
+    // --- Prefix sum: convert counts into write positions. Schedule the
+    // --- modules by their number of digis, largest first; threads running
+    // --- out of work steal modules from the others.
+    #pragma omp single
+    {
+      Int_t offset = 0;
+      for (Int_t iModule = 0; iModule < nModules; iModule++) {
+        fModuleOffset[iModule] = offset;
+        for (Int_t iChunk = 0; iChunk < nChunks; iChunk++) {
+          Int_t nInChunk = fChunkOffset[iChunk * nModules + iModule];
+          fChunkOffset[iChunk * nModules + iModule] = offset;
+          offset += nInChunk;
+        } //# chunks
+        fModuleLoad[iModule] = offset - fModuleOffset[iModule];
+      } //# modules
+      fModuleOffset[nModules] = offset;
+      assert( offset == nDigis );
+      fDigiChannel.resize(nDigis);
+      fDigiTime.resize(nDigis);
+      fDigiCharge.resize(nDigis);
+      fDigiIndex.resize(nDigis);
+      fScheduler.Schedule(fModuleLoad, omp_get_num_threads());
+    } //# single
+
+    // --- Second pass: scatter digi data into the module ranges
+    #pragma omp for schedule(static, 1)
+    for (Int_t iChunk = 0; iChunk < nChunks; iChunk++) {
+      Int_t* position = fChunkOffset.data() + iChunk * nModules;
+      Int_t lastDigi = std::min(nDigis, (iChunk + 1) * chunkSize);
+      for (Int_t iDigi = iChunk * chunkSize; iDigi < lastDigi; iDigi++) {
+        Int_t digiIndex = (event ? event->GetIndex(kStsDigi, iDigi) : iDigi);
+        const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(digiIndex);
+        Int_t target = position[fDigiModule[iDigi]]++;
+        fDigiChannel[target] = digi->GetChannel();
+        fDigiTime[target]    = digi->GetTime();
+        fDigiCharge[target]  = digi->GetCharge();
+        fDigiIndex[target]   = digiIndex;
+      } //# digis in chunk
+    } //# chunks
+    #pragma omp single nowait
+    tDistributed = omp_get_wtime();
+
+    // --- Module tasks, independent of each other. The modules write their
+    // --- clusters (and, with cluster output, their hits) into the arena
+    // --- of the executing thread.
+    Double_t busy = 0.;
+    Int_t iModule = -1;
+    while ( ( iModule = fScheduler.Next(thread) ) >= 0 )
+      busy += ProcessModule(iModule, thread, event);
+    fScheduler.AddBusyTime(thread, busy);
+    #pragma omp barrier
+
+    // --- Prefix sums over the output sizes of the modules give their
+    // --- slot ranges in the output arrays. Without cluster output, only
+    // --- hits are written.
+    #pragma omp single
+    {
+      tProcessed = omp_get_wtime();
+      fClusterOffset[0] = fClusters->GetEntriesFast();
+      fHitOffset[0] = fHits->GetEntriesFast();
+      for (Int_t jModule = 0; jModule < nModules; jModule++) {
+        CbmStsDigisToHitsModule* module = fModuleIndex[jModule];
+        fClusterOffset[jModule+1] = fClusterOffset[jModule]
+          + ( fClusterOutputMode ? module->GetNofClusters() : 0 );
+        fHitOffset[jModule+1] = fHitOffset[jModule]
+          + ( fClusterOutputMode ? module->GetNofHits()
+                                 : Int_t(module->GetHitOutputVector().size()) );
+      }
+      if ( fClusterOutputMode ) fClusters->ExpandCreate(fClusterOffset[nModules]);
+      fHits->ExpandCreate(fHitOffset[nModules]);
+    } //# single
 
-    LOG(info) << "fHitsVectorCopy size is " << fHitsVectorCopy.size();
-    // Convert Vector to TClonesArray for comparison reasons only
-    //fHits->AbsorbObjects(Convert(fHitsVector));
-    fHitsVector = &fHitsVectorCopy;
-    // Works 
-    //fHits->AbsorbObjects(Convert(*fHitsVector));
-    LOG(info) << "fHitsVector size is " << fHitsVector->size();
-    fHitsVectorCopy.clear();
-    //LOG(info) << "fHitsVectorCopy size is " << fHitsVectorCopy.size();
-    //LOG(info) << "fHitsVector size is " << fHitsVector->size();
-    //fHits->AbsorbObjects(fHitsCopy);  //fHits = fHitsCopy;
-  } else {
-
-    // This part can run parallel
-    for (UInt_t it = 0; it < fModules.size(); it++){
-      fModuleIndex[it]->ProcessDigis(event);
-    }
+    // --- Copy the output of the modules into their slots, in module order.
+    // --- The output is thus the same as in serial processing.
+    #pragma omp for schedule(dynamic)
+    for (Int_t jModule = 0; jModule < nModules; jModule++)
+      CopyModuleOutput(jModule);
 
-    // Get the hits and the clusters from the modules
-    // Set the proper index for the clusters in the hit object
-    for (UInt_t it = 0; it < fModules.size(); it++){
-      UInt_t hitStartIndex = fHits->GetEntriesFast();
-      fHits->AbsorbObjects(fModuleIndex[it]->GetHitOutput());
-      UInt_t hitStopIndex = fHits->GetEntriesFast();
-
-      UInt_t clusterStartIndex = fClusters->GetEntriesFast();
-      fClusters->AbsorbObjects(fModuleIndex[it]->GetClusterOutput());
-      UInt_t clusterStopIndex = fClusters->GetEntriesFast();
-
-      for (UInt_t it1 = hitStartIndex; it1 < hitStopIndex;  ++it1){ 
-	LOG(debug) << it << ": Loop from " << hitStartIndex << " to " << hitStopIndex;
-	CbmStsHit* hit = static_cast<CbmStsHit*>(fHits->At(it1));
-        assert(hit);
-	LOG(debug) << "FClust:BClust:offset " << hit->GetFrontClusterId() << " " 
-		  << hit->GetBackClusterId() << " " << clusterStartIndex;
-	hit->SetFrontClusterId(hit->GetFrontClusterId()+clusterStartIndex);
-	hit->SetBackClusterId(hit->GetBackClusterId()+clusterStartIndex);
-      }
-      for (UInt_t it1 = clusterStartIndex; it1 < clusterStopIndex; ++it1){ 
-	CbmStsCluster* cluster = static_cast<CbmStsCluster*>(fClusters->At(it1));
-	assert(cluster);
-	cluster->SetIndex(it1);
-      }
-    }
-  }
-  fTimer.Stop();
-  Double_t time3 = fTimer.RealTime();
+  } //# parallel region
+  Double_t tEnd = omp_get_wtime();
+  fScheduler.AddWallTime(tProcessed - tDistributed);
 
     // --- Stop index of newly created clusters
   Int_t indexLast = fHits->GetEntriesFast();
@@ -446,35 +547,21 @@ void CbmStsDigisToHits::ProcessData(CbmEvent* event) {
   Int_t nClusters = fClusters->GetEntriesFast();
   LOG(info) << "Number of Clusters: " << nClusters;
 
-  // --- Determine cluster parameters
-  fTimer.Start();
-
-/*
-    for (Int_t index = indexFirst; index < indexLast; index++) {
-    CbmStsCluster* cluster = dynamic_cast<CbmStsCluster*>(fClusters->At(index));
-    CbmStsModule* module = dynamic_cast<CbmStsModule*>
-    (fSetup->GetElement(cluster->GetAddress(), kStsModule));
-    //fAna->Analyze(cluster, module);
-  } 
-*/
-
-  fTimer.Stop();
-  Double_t time4 = fTimer.RealTime();
-
   // --- In event-by-event mode: register clusters to event
-  fTimer.Start();
   if ( event ) {
     for (Int_t index = indexFirst; index < indexLast; index++)
       event->AddData(kStsCluster, index);
   } //? Event object
-
-  fTimer.Stop();
-  Double_t time5 = fTimer.RealTime();
+  Double_t time1 = tDistributed - tStart;
+  Double_t time2 = tProcessed - tDistributed;
+  Double_t time3 = omp_get_wtime() - tProcessed;
+  fTiming.AddTime(CbmStsRecoTiming::kDistribute, time1);
+  fTiming.AddTime(CbmStsRecoTiming::kOutput, time3);
 
   // --- Counters
   Int_t nHits = 0;
   nHits = indexLast - indexFirst;
-  Double_t realTime = time1 + time2 + time3 + time4 + time5;
+  Double_t realTime = time1 + time2 + time3;
   fNofEvents++;
   fNofDigis        += nDigis;
   fNofDigisUsed    += nGood;
@@ -486,9 +573,9 @@ void CbmStsDigisToHits::ProcessData(CbmEvent* event) {
   // --- Screen output
   LOG(debug) << GetName() << ": created " << nClusters << " from index "
       << indexFirst << " to " << indexLast;
-  LOG(info) << GetName() << ": reset " << time1 << ", distribute digis " << time2
-      << ", process digis " << time3 << ", unused timer " << time4 << ", unused timer "
-      << time5;
+  LOG(info) << GetName() << ": distribute digis " << time1
+      << ", process modules " << time2 << ", output " << time3
+      << " (parallel region " << tEnd - tStart << ")";
 
   if ( event) LOG(info) << setw(20) << left << GetName() << ": " << "Event "
       << right << setw(6) << event->GetNumber() << ", real time " << fixed
@@ -503,18 +590,309 @@ void CbmStsDigisToHits::ProcessData(CbmEvent* event) {
 
 
 
+// -----   Process one module (task)   -------------------------------------
+Double_t CbmStsDigisToHits::ProcessModule(Int_t iModule, Int_t thread,
+                                          CbmEvent* event) {
+
+  CbmStsDigisToHitsModule* module = fModuleIndex[iModule];
+  Double_t tStart = omp_get_wtime();
+
+  // --- Reset and hand over the digis and the arena
+  module->Reset();
+  Int_t first = fModuleOffset[iModule];
+  module->SetDigiQueue(fDigiChannel.data() + first,
+                       fDigiTime.data() + first,
+                       fDigiCharge.data() + first,
+                       fDigiIndex.data() + first,
+                       fModuleOffset[iModule+1] - first);
+  module->SetArena(fArenas[thread]);
+  Double_t tReset = omp_get_wtime();
+
+  // --- Cluster finding and analysis
+  module->ClusterDigis();
+  Double_t tCluster = omp_get_wtime();
+  module->AnalyzeClusters();
+  Double_t tAnalyse = omp_get_wtime();
+
+  // --- Hit finding; without cluster output, the hits are kept in a vector
+  if ( fClusterOutputMode ) module->FindHits(event);
+  else module->FindHitsVector(event);
+  Double_t tHits = omp_get_wtime();
+
+  fTiming.AddTime(thread, CbmStsRecoTiming::kReset, tReset - tStart, iModule);
+  fTiming.AddTime(thread, CbmStsRecoTiming::kCluster,
+                  tCluster - tReset, iModule);
+  fTiming.AddTime(thread, CbmStsRecoTiming::kAnalyse,
+                  tAnalyse - tCluster, iModule);
+  fTiming.AddTime(thread, CbmStsRecoTiming::kHitFind,
+                  tHits - tAnalyse, iModule);
+  return tHits - tStart;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Copy the output of one module   ---------------------------------
+void CbmStsDigisToHits::CopyModuleOutput(Int_t iModule) {
+
+  CbmStsDigisToHitsModule* module = fModuleIndex[iModule];
+
+  // --- Without cluster output: hits from the vector of the module. The
+  // --- cluster ids in the hits are made module-local.
+  if ( ! fClusterOutputMode ) {
+    const std::vector<CbmStsHit>& hits = module->GetHitOutputVector();
+    Int_t clusterShift = - module->GetFirstCluster();
+    for (UInt_t iHit = 0; iHit < hits.size(); iHit++) {
+      CbmStsHit* hit = static_cast<CbmStsHit*>
+        (fHits->UncheckedAt(fHitOffset[iModule] + iHit));
+      assert(hit);
+      *hit = hits[iHit];
+      hit->SetFrontClusterId(hit->GetFrontClusterId() + clusterShift);
+      hit->SetBackClusterId(hit->GetBackClusterId() + clusterShift);
+    } //# hits in module
+    return;
+  } //? no cluster output
+
+  // --- With cluster output: clusters and hits from the arena. Set the
+  // --- cluster indices and remap the cluster ids in the hits.
+  CbmStsRecoArena* arena = module->GetArena();
+  if ( ! arena ) return;
+  for (Int_t iCluster = 0; iCluster < module->GetNofClusters(); iCluster++) {
+    Int_t index = fClusterOffset[iModule] + iCluster;
+    CbmStsCluster* cluster =
+        static_cast<CbmStsCluster*>(fClusters->UncheckedAt(index));
+    *cluster = *arena->GetCluster(module->GetFirstCluster() + iCluster);
+    cluster->SetIndex(index);
+  } //# clusters in module
+  Int_t clusterShift = fClusterOffset[iModule] - module->GetFirstCluster();
+  for (Int_t iHit = 0; iHit < module->GetNofHits(); iHit++) {
+    CbmStsHit* hit = static_cast<CbmStsHit*>
+      (fHits->UncheckedAt(fHitOffset[iModule] + iHit));
+    *hit = *arena->GetHit(module->GetFirstHit() + iHit);
+    hit->SetFrontClusterId(hit->GetFrontClusterId() + clusterShift);
+    hit->SetBackClusterId(hit->GetBackClusterId() + clusterShift);
+  } //# hits in module
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Process one event in a workspace   ------------------------------
+void CbmStsDigisToHits::ProcessEvent(CbmEvent* event,
+                                     EventWorkspace& workspace,
+                                     CbmStsRecoArena* arena,
+                                     EventOutput& output) {
+
+  assert(event);
+  Int_t nModules = fModuleIndex.size();
+  if ( workspace.fCount.empty() ) {
+    workspace.fCount.assign(nModules, 0);
+    workspace.fModules.assign(nModules, nullptr);
+  }
+
+  // --- Determine the modules touched by the event and count their digis
+  Int_t thread = output.fThread;
+  Double_t tStart = omp_get_wtime();
+  Int_t nDigis = event->GetNofData(kStsDigi);
+  workspace.fTouched.clear();
+  workspace.fDigiModule.resize(nDigis);
+  for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+    Int_t digiIndex = event->GetIndex(kStsDigi, iDigi);
+    const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(digiIndex);
+    assert(digi);
+    Int_t iModule = fSetup->GetModuleIndex(digi->GetAddress());
+    assert( iModule >= 0 && iModule < nModules );
+    assert ( digi->GetChannel() < fModuleIndex[iModule]->GetSize() );
+    workspace.fDigiModule[iDigi] = iModule;
+    if ( workspace.fCount[iModule]++ == 0 )
+      workspace.fTouched.push_back(iModule);
+  } //# digis in event
+
+  // --- Process touched modules in the order of the setup, as in the
+  // --- time-slice mode. The digi counts become write positions.
+  std::sort(workspace.fTouched.begin(), workspace.fTouched.end());
+  Int_t nTouched = workspace.fTouched.size();
+  workspace.fFirst.resize(nTouched + 1);
+  Int_t offset = 0;
+  for (Int_t iTouched = 0; iTouched < nTouched; iTouched++) {
+    Int_t iModule = workspace.fTouched[iTouched];
+    workspace.fFirst[iTouched] = offset;
+    Int_t nInModule = workspace.fCount[iModule];
+    workspace.fCount[iModule] = offset;
+    offset += nInModule;
+  }
+  workspace.fFirst[nTouched] = offset;
+
+  // --- Stage the digi data per module (stable w.r.t. input order)
+  workspace.fDigiChannel.resize(nDigis);
+  workspace.fDigiTime.resize(nDigis);
+  workspace.fDigiCharge.resize(nDigis);
+  workspace.fDigiIndex.resize(nDigis);
+  for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+    Int_t digiIndex = event->GetIndex(kStsDigi, iDigi);
+    const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(digiIndex);
+    Int_t target = workspace.fCount[workspace.fDigiModule[iDigi]]++;
+    workspace.fDigiChannel[target] = digi->GetChannel();
+    workspace.fDigiTime[target]    = digi->GetTime();
+    workspace.fDigiCharge[target]  = digi->GetCharge();
+    workspace.fDigiIndex[target]   = digiIndex;
+  } //# digis in event
+  fTiming.AddTime(thread, CbmStsRecoTiming::kDistribute,
+                  omp_get_wtime() - tStart);
+
+  // --- Cluster and hit finding in the touched modules
+  output.fNofDigis = nDigis;
+  output.fFirstCluster = arena->GetNofClusters();
+  output.fFirstHit = arena->GetNofHits();
+  for (Int_t iTouched = 0; iTouched < nTouched; iTouched++) {
+    Int_t iModule = workspace.fTouched[iTouched];
+    CbmStsDigisToHitsModule* module = workspace.fModules[iModule];
+    if ( ! module ) {
+      #pragma omp critical(CbmStsDigisToHits_CreateModule)
+      module = CreateModule(iModule);
+      workspace.fModules[iModule] = module;
+    }
+    Int_t first = workspace.fFirst[iTouched];
+    module->Reset();
+    module->SetArena(arena);
+    module->SetDigiQueue(workspace.fDigiChannel.data() + first,
+                         workspace.fDigiTime.data() + first,
+                         workspace.fDigiCharge.data() + first,
+                         workspace.fDigiIndex.data() + first,
+                         workspace.fFirst[iTouched+1] - first);
+    Double_t tModule = omp_get_wtime();
+    module->ClusterDigis();
+    Double_t tCluster = omp_get_wtime();
+    module->AnalyzeClusters();
+    Double_t tAnalyse = omp_get_wtime();
+    module->FindHits(nullptr);
+    Double_t tHits = omp_get_wtime();
+    fTiming.AddTime(thread, CbmStsRecoTiming::kCluster,
+                    tCluster - tModule, iModule);
+    fTiming.AddTime(thread, CbmStsRecoTiming::kAnalyse,
+                    tAnalyse - tCluster, iModule);
+    fTiming.AddTime(thread, CbmStsRecoTiming::kHitFind,
+                    tHits - tAnalyse, iModule);
+    workspace.fCount[iModule] = 0;
+  } //# touched modules
+  output.fNofClusters = arena->GetNofClusters() - output.fFirstCluster;
+  output.fNofHits = arena->GetNofHits() - output.fFirstHit;
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Process all events of the time slice   --------------------------
+void CbmStsDigisToHits::ProcessEvents() {
+
+  assert(fEvents);
+  Int_t nEvents = fEvents->GetEntriesFast();
+  Int_t nThreads = ( fParallelism_enabled ? omp_get_max_threads() : 1 );
+
+  // --- Workspaces, one per thread
+  while ( Int_t(fWorkspaces.size()) < nThreads )
+    fWorkspaces.push_back(new EventWorkspace());
+  assert( Int_t(fArenas.size()) >= nThreads );
+  fEventOutput.assign(nEvents, EventOutput());
+
+  // --- Process the events concurrently, each in the workspace of its thread
+  fTimer.Start();
+  #pragma omp parallel for schedule(dynamic, 1) if(fParallelism_enabled)
+  for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
+    CbmEvent* event = static_cast<CbmEvent*>(fEvents->At(iEvent));
+    Int_t thread = omp_get_thread_num();
+    fEventOutput[iEvent].fThread = thread;
+    ProcessEvent(event, *fWorkspaces[thread], fArenas[thread],
+                 fEventOutput[iEvent]);
+  } //# events
+  fTimer.Stop();
+  Double_t time1 = fTimer.RealTime();
+
+  // --- Prefix sums over the events give the positions in the output.
+  // --- Without cluster output, the cluster ids in the hits refer to the
+  // --- clusters in the event.
+  fTimer.Start();
+  Int_t nDigis = 0;
+  Int_t clusterOffset = ( fClusterOutputMode ? fClusters->GetEntriesFast() : 0 );
+  Int_t hitOffset = fHits->GetEntriesFast();
+  Int_t nClusters = 0;
+  Int_t nHits = 0;
+  for (EventOutput& output : fEventOutput) {
+    output.fClusterOffset = clusterOffset;
+    output.fHitOffset = hitOffset;
+    if ( fClusterOutputMode ) clusterOffset += output.fNofClusters;
+    hitOffset += output.fNofHits;
+    nDigis += output.fNofDigis;
+    nClusters += output.fNofClusters;
+    nHits += output.fNofHits;
+  }
+  if ( fClusterOutputMode ) fClusters->ExpandCreate(clusterOffset);
+  fHits->ExpandCreate(hitOffset);
+
+  // --- Copy clusters and hits into their slots, remap the cluster ids
+  // --- and register clusters and hits to the event
+  #pragma omp parallel for schedule(dynamic) if(fParallelism_enabled)
+  for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
+    CbmEvent* event = static_cast<CbmEvent*>(fEvents->At(iEvent));
+    const EventOutput& output = fEventOutput[iEvent];
+    CbmStsRecoArena* arena = fArenas[output.fThread];
+    if ( fClusterOutputMode ) {
+      for (Int_t iCluster = 0; iCluster < output.fNofClusters; iCluster++) {
+        Int_t index = output.fClusterOffset + iCluster;
+        CbmStsCluster* cluster =
+            static_cast<CbmStsCluster*>(fClusters->UncheckedAt(index));
+        *cluster = *arena->GetCluster(output.fFirstCluster + iCluster);
+        cluster->SetIndex(index);
+        event->AddData(kStsCluster, index);
+      } //# clusters in event
+    } //? cluster output
+    Int_t clusterShift = output.fClusterOffset - output.fFirstCluster;
+    for (Int_t iHit = 0; iHit < output.fNofHits; iHit++) {
+      Int_t index = output.fHitOffset + iHit;
+      CbmStsHit* hit = static_cast<CbmStsHit*>(fHits->UncheckedAt(index));
+      *hit = *arena->GetHit(output.fFirstHit + iHit);
+      hit->SetFrontClusterId(hit->GetFrontClusterId() + clusterShift);
+      hit->SetBackClusterId(hit->GetBackClusterId() + clusterShift);
+      event->AddData(kStsHit, index);
+    } //# hits in event
+  } //# events
+  fTimer.Stop();
+  Double_t time2 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kOutput, time2);
+
+  // --- Counters
+  Double_t realTime = time1 + time2;
+  fNofEvents       += nEvents;
+  fNofDigis        += nDigis;
+  fNofClusters     += nClusters;
+  fNofHits         += nHits;
+  fTimeTot         += realTime;
+
+  // --- Screen output
+  LOG(info) << setw(20) << left << GetName() << ": " << "Time-slice "
+      << right << setw(6) << fNofTimeslices << ", events " << nEvents
+      << ", real time " << fixed << setprecision(6) << realTime
+      << " s (process " << time1 << " s, output " << time2 << " s), digis: "
+      << nDigis << ", clusters: " << nClusters << ", hits: " << nHits;
+
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Process one digi object   ---------------------------------------
 Bool_t CbmStsDigisToHits::ProcessDigi(Int_t index) {
 
   // --- Get the digi object
   const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(index);
   assert(digi);
-  UInt_t moduleAddress = CbmStsAddress::GetMotherAddress(digi->GetAddress(),
-											 kStsModule);
+  Int_t iModule = fSetup->GetModuleIndex(digi->GetAddress());
 
   // --- Get the cluster finder module
-  assert( fModules.count(moduleAddress) );
-  CbmStsDigisToHitsModule* module = fModules[moduleAddress];
+  assert( iModule >= 0 );
+  CbmStsDigisToHitsModule* module = fModuleIndex[iModule];
   assert(module);
 
   // --- Digi channel
@@ -522,7 +900,7 @@ Bool_t CbmStsDigisToHits::ProcessDigi(Int_t index) {
   assert ( channel < module->GetSize() );
 
   // --- Process digi in module
-  return module->ProcessDigi(channel, digi->GetTime(), index);
+  return module->ProcessDigi(channel, digi->GetTime(), digi->GetCharge(), index);
 
 }
 // -------------------------------------------------------------------------
@@ -544,8 +922,7 @@ Int_t CbmStsDigisToHits::SortClusters(CbmEvent* event) {
     assert(cluster);
     UInt_t address = cluster->GetAddress();
     cluster->SetIndex(index);
-    CbmStsModule* module =
-        static_cast<CbmStsModule*>(fSetup->GetElement(address, kStsModule));
+    CbmStsModule* module = fSetup->GetModule(fSetup->GetModuleIndex(address));
 
     // --- Assign cluster to module
     module->AddCluster(cluster);
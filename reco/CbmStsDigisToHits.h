@@ -5,11 +5,16 @@
 #ifndef CbmStsDigisToHits_H
 #define CbmStsDigisToHits_H 1
 
+#include <string>
+#include <vector>
 #include "TStopwatch.h"
 #include "FairTask.h"
 #include "CbmStsHit.h"
 #include "TClonesArray.h"
 #include "CbmStsReco.h"
+#include "CbmStsModuleScheduler.h"
+#include "CbmStsRecoArena.h"
+#include "CbmStsRecoTiming.h"
 
 class TClonesArray;
 class CbmDigiManager;
@@ -30,8 +35,21 @@ class CbmStsSetup;
  ** the module they are registered by; the cluster finding is then performed
  ** in each module.
  **
+ ** In time-slice mode, the distribution of the digis, the per-module
+ ** processing and the output run in a single parallel region. Each module
+ ** (reset, cluster finding, hit finding) is a task taken from a
+ ** load-balancing scheduler.
+ **
  ** The task can operate both on time-slice and event input.
  ** Use SetEventMode() to choose event-by-event operation.
+ ** In event mode, the events are processed concurrently if parallelism
+ ** is enabled. Each thread uses its own clustering workspace, in which
+ ** only the modules touched by the respective event are processed.
+ ** The output is appended to the output arrays in event order.
+ **
+ ** Clusters and hits are first created in per-thread arenas, which keep
+ ** their storage from one time slice to the next, and then copied into
+ ** the output arrays.
  **
  ** The actual cluster finding algorithm is defined in the class
  ** CbmStsDigisToHitsModule.
@@ -139,6 +157,17 @@ class CbmStsDigisToHits : public FairTask
     virtual void SetParContainers();
 
 
+    /** @brief Set the file for the timing summary
+     ** @param fileName  Output file (CSV if ending with ".csv", else JSON)
+     **
+     ** If set, the execution times per stage (reset, distribution,
+     ** cluster finding, cluster analysis, hit finding, output) are written
+     ** to this file at the end of the run; the module-level stages are
+     ** also recorded per module and thread.
+     **/
+    void SetTimingFile(const char* fileName) { fTimingFile = fileName; }
+
+
   private:
 
     TClonesArray* fEvents;            //! Input array of events
@@ -158,27 +187,52 @@ class CbmStsDigisToHits : public FairTask
     std::vector<CbmStsDigisToHitsModule*> fModuleIndex;
     Bool_t fClusterOutputMode;
     TClonesArray* fHits;
-    std::vector<CbmStsHit>* fHitsVector; //!
     Bool_t fParallelism_enabled;
 
-    // Convert a vector of CbmStsHits to a TClonesArray of those hits
-    // Needed for correctness evaluation
-    TClonesArray* Convert(std::vector<CbmStsHit> arr)
-    {
-      TClonesArray* tca;
-      tca = new TClonesArray("CbmStsHit", 6e3);
-      Int_t entries = arr.size();
-      if (entries > 0) {
-        for(int i=0; i< entries; ++i) {
-          CbmStsHit hit = static_cast<CbmStsHit>(arr[i]);
-          //tca->AddAt(&hit, i);
-          CbmStsHit* newHit = new ( (*tca)[i] ) CbmStsHit();
-          *newHit = hit;
-        }
-      }
-      return tca;
-    }
-
+    // --- Buffers for the lock-free distribution of digis to the modules
+    std::vector<UShort_t> fDigiChannel; //! Staged digi channels, ordered by module
+    std::vector<Double_t> fDigiTime;    //! Staged digi times, ordered by module
+    std::vector<UShort_t> fDigiCharge;  //! Staged digi charges, ordered by module
+    std::vector<Int_t> fDigiIndex;      //! Staged digi indices, ordered by module
+    std::vector<Int_t> fDigiModule;   //! Input digi -> module index
+    std::vector<Int_t> fChunkOffset;  //! Write position per (chunk, module)
+    std::vector<Int_t> fModuleOffset; //! Module -> first digi in buffer
+
+    // --- Load-balanced distribution of modules to threads
+    std::vector<Int_t> fModuleLoad;     //! Number of digis per module
+    CbmStsModuleScheduler fScheduler;   //! Module queues and thread timing
+    CbmStsRecoTiming fTiming;           //! Time per stage, module and thread
+    std::string fTimingFile;            ///< Output file for timing summary
+    std::vector<Int_t> fClusterOffset;  //! Module -> first cluster in output
+    std::vector<Int_t> fHitOffset;      //! Module -> first hit in output
+
+    // --- Event-parallel processing
+    /** Per-thread workspace for the processing of events **/
+    struct EventWorkspace {
+      std::vector<CbmStsDigisToHitsModule*> fModules; ///< Module -> workspace module (created on first use)
+      std::vector<Int_t> fTouched;      ///< Modules with digis in current event
+      std::vector<Int_t> fFirst;        ///< Touched module -> first staged digi
+      std::vector<Int_t> fCount;        ///< Module -> number of digis / write position
+      std::vector<Int_t> fDigiModule;   ///< Digi in event -> module index
+      std::vector<UShort_t> fDigiChannel; ///< Staged digi channels
+      std::vector<Double_t> fDigiTime;    ///< Staged digi times
+      std::vector<UShort_t> fDigiCharge;  ///< Staged digi charges
+      std::vector<Int_t> fDigiIndex;      ///< Staged digi indices
+    };
+    /** Output of one event in its workspace and in the output arrays **/
+    struct EventOutput {
+      Int_t fThread = 0;         ///< Thread (workspace) the event was processed in
+      Int_t fNofDigis = 0;       ///< Number of digis in event
+      Int_t fFirstCluster = 0;   ///< First cluster in workspace
+      Int_t fNofClusters = 0;    ///< Number of clusters
+      Int_t fFirstHit = 0;       ///< First hit in workspace
+      Int_t fNofHits = 0;        ///< Number of hits
+      Int_t fClusterOffset = 0;  ///< First cluster in output array
+      Int_t fHitOffset = 0;      ///< First hit in output array
+    };
+    std::vector<EventWorkspace*> fWorkspaces;    //! One per thread
+    std::vector<CbmStsRecoArena*> fArenas;       //! Cluster and hit storage, one per thread
+    std::vector<EventOutput> fEventOutput;       //! One per event
 
     /** @brief Sort clusters into modules
      ** @param event  Pointer to event object. If null, use entire
@@ -204,6 +258,13 @@ class CbmStsDigisToHits : public FairTask
     std::map<Int_t, CbmStsDigisToHitsModule*> fModules;  //!
 
 
+    /** @brief Instantiate a reco module
+     ** @param iModule  Index of module in the setup
+     ** @value Pointer to new reco module
+     **/
+    CbmStsDigisToHitsModule* CreateModule(Int_t iModule);
+
+
     /** @brief Instantiate cluster finding modules
      ** @value Number of modules created
      **/
@@ -218,6 +279,15 @@ class CbmStsDigisToHits : public FairTask
     void InitSettings();
 
 
+    /** @brief Provide and reset the per-thread arenas
+     ** @param nThreads  Number of threads
+     **
+     ** Arenas are created on demand and kept for the run; their storage
+     ** is reused from one time slice to the next.
+     **/
+    void ResetArenas(Int_t nThreads);
+
+
     /** @brief Process one time slice or event
      ** @param event  Pointer to CbmEvent object
      **
@@ -226,6 +296,47 @@ class CbmStsDigisToHits : public FairTask
     void ProcessData(CbmEvent* event = NULL);
 
 
+    /** @brief Process one module of the time slice (task)
+     ** @param iModule  Index of module in the setup
+     ** @param thread   Executing thread
+     ** @param event    Pointer to event object (nullptr for time slice)
+     ** @return Execution time [s]
+     **
+     ** Reset, cluster finding (with analysis) and hit finding of the
+     ** module. The digis of the module must have been distributed.
+     **/
+    Double_t ProcessModule(Int_t iModule, Int_t thread, CbmEvent* event);
+
+
+    /** @brief Copy the output of one module into the output arrays
+     ** @param iModule  Index of module in the setup
+     **
+     ** The slot ranges (fClusterOffset, fHitOffset) must have been set.
+     **/
+    void CopyModuleOutput(Int_t iModule);
+
+
+    /** @brief Process one event in a workspace
+     ** @param event      Pointer to CbmEvent object
+     ** @param workspace  Workspace of the calling thread
+     ** @param arena      Arena of the calling thread
+     ** @param output     Bookkeeping of the event output
+     **
+     ** Only the modules touched by the event are reset and processed.
+     ** Clusters and hits are appended to the arena of the thread.
+     **/
+    void ProcessEvent(CbmEvent* event, EventWorkspace& workspace,
+                      CbmStsRecoArena* arena, EventOutput& output);
+
+
+    /** @brief Process all events of the time slice
+     **
+     ** The events are processed concurrently if parallelism is enabled.
+     ** Their output is then appended in event order to the output arrays.
+     **/
+    void ProcessEvents();
+
+
     /** @brief Process one STS digi
      ** @param index  Index of STS digi in its TClonesArray
      **/
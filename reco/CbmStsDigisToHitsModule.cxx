@@ -2,7 +2,6 @@
  **/
 
 #include "CbmStsDigisToHitsModule.h"
-#include <tuple>
 
 #include <cassert>
 #include "TClonesArray.h"
@@ -10,6 +9,7 @@
 #include "CbmStsAddress.h"
 #include "CbmStsCluster.h"
 #include "CbmStsClusterAnalysis.h"
+#include "CbmStsRecoArena.h"
 
 
 
@@ -30,13 +30,32 @@ CbmStsDigisToHitsModule::CbmStsDigisToHitsModule()
   , fClusters(nullptr)
   , fIndex()
   , fTime()
-  , fDigiQueue()
+  , fActive()
+  , fCharge()
+  , fTimeCutTable()
+  , fParameterVersion(0)
+  , fDigiChannel(nullptr)
+  , fDigiTime(nullptr)
+  , fDigiCharge(nullptr)
+  , fDigiIndex(nullptr)
+  , fNofDigisInQueue(0)
+  , fDigiOrder()
+  , fDigiOrderTemp()
+  , fClusterChannel()
+  , fClusterCharge()
+  , fClusterTime()
+  , fClusterFirst(1, 0)
   , moduleNumber()
   , fAna(nullptr)
-  , fClusterOutput(new TClonesArray("CbmStsCluster", 6e3))
-  , fHitOutput(new TClonesArray("CbmStsHit", 6e3))  
+  , fArena(nullptr)
+  , fFirstCluster(0)
+  , fFirstHit(0)
+  , fNofHits(0)
+  , fClusterDigis()
+  , fModuleClusters()
+  , fHitOutputVector()
+  , fHitContext()
 {
-  fDigiQueue.reserve(60000);
 }
 // -------------------------------------------------------------------------
 
@@ -62,15 +81,35 @@ CbmStsDigisToHitsModule::CbmStsDigisToHitsModule(UShort_t nChannels,
   , fConnectEdgeBack(kFALSE)
   , fModule(module)
   , fClusters(nullptr)
-  , fIndex(fSize)
-  , fTime(fSize)
-  , fDigiQueue()
+  , fIndex(fSize, -1)
+  , fTime(fSize, 0.)
+  , fActive(fSize)
+  , fCharge(fSize)
+  , fTimeCutTable()
+  , fParameterVersion(0)
+  , fDigiChannel(nullptr)
+  , fDigiTime(nullptr)
+  , fDigiCharge(nullptr)
+  , fDigiIndex(nullptr)
+  , fNofDigisInQueue(0)
+  , fDigiOrder()
+  , fDigiOrderTemp()
+  , fClusterChannel()
+  , fClusterCharge()
+  , fClusterTime()
+  , fClusterFirst(1, 0)
   , moduleNumber(mNumber)
   , fAna(clusterAna)
-  , fClusterOutput(new TClonesArray("CbmStsCluster", 6e3))
-  , fHitOutput(new TClonesArray("CbmStsHit", 6e3))  
+  , fArena(nullptr)
+  , fFirstCluster(0)
+  , fFirstHit(0)
+  , fNofHits(0)
+  , fClusterDigis()
+  , fModuleClusters()
+  , fHitOutputVector()
+  , fHitContext()
 {
-  fDigiQueue.reserve(60000);
+  if ( ! fModule || fModule->IsSet() ) UpdateTimeCuts();
 }
 // -------------------------------------------------------------------------
 
@@ -95,12 +134,9 @@ Bool_t CbmStsDigisToHitsModule::CheckChannel(UShort_t channel,
 
   assert( time >= fTime[channel] );
 
-  Double_t deltaT = fTimeCutDigisInSigma * TMath::Sqrt(2.) * fModule->GetAsicParameters(channel).GetTimeResolution();
-  if ( fTimeCutDigisInNs > 0. ) deltaT = fTimeCutDigisInNs;
-
   // Channel is active, but time is not matching: close cluster
   // and return no match.
-  if ( time - fTime[channel] > deltaT ) {
+  if ( time - fTime[channel] > fTimeCutTable[channel] ) {
     FinishCluster(channel);
     return kFALSE;
   }
@@ -124,35 +160,41 @@ void CbmStsDigisToHitsModule::CreateCluster(UShort_t first,
   } //? cluster array
   else cluster = new CbmStsCluster(); */
   //DigisToHits
-  Int_t index = fClusterOutput->GetEntriesFast();
-  cluster = new ((*fClusterOutput)[index]) CbmStsCluster();
-
-  cluster->SetIndex(index);
-
-  // Register cluster in module
-  fModule->AddCluster(cluster);
-
-  // --- Add digis to cluster and reset the respective channel
+  // --- Collect the digis of the cluster and reset the respective channels.
+  // --- The digi properties are appended to the staging arrays for the
+  // --- batch cluster analysis.
+  fClusterDigis.clear();
   UShort_t channel = first;
   while ( kTRUE ) {
     assert( fIndex[channel] > - 1 );
-    cluster->AddDigi(fIndex[channel]);
+    fClusterDigis.push_back(fIndex[channel]);
+    fClusterChannel.push_back(channel);
+    fClusterCharge.push_back(fCharge[channel]);
+    fClusterTime.push_back(fTime[channel]);
     fIndex[channel] = -1;
     fTime[channel] = 0.;
+    fActive.Clear(channel);
     if ( channel == last ) break;
     channel++;
     if ( last < first && channel == fSize/2 ) channel = 0; // round the edge, front side
     if ( last < first && channel == fSize ) channel = fSize/2; // round the edge, back side
   }
 
+  // --- Cluster object from the arena of the calling thread
+  assert(fArena);
+  cluster = fArena->NewCluster(fClusterDigis);
+  cluster->SetIndex(fArena->GetNofClusters() - 1);
+
+  // Register cluster for the hit finding in this module
+  fModuleClusters.push_back(cluster);
+
   if ( fModule ) cluster->SetAddress(fModule->GetAddress());
 
   // --- Delete cluster object if no output array is there
   //if ( ! fClusters ) delete cluster;
 
-  // Analyse cluster
-  //LOG(INFO) << "Analysing cluster";
-  fAna->Analyze(cluster, fModule);
+  // --- The cluster is analysed later, together with the others
+  fClusterFirst.push_back(fClusterChannel.size());
 }
 // -------------------------------------------------------------------------
 
@@ -161,72 +203,28 @@ void CbmStsDigisToHitsModule::CreateCluster(UShort_t first,
 // -----   Close a cluster   -----------------------------------------------
 void CbmStsDigisToHitsModule::FinishCluster(UShort_t channel) {
 
-  // Find start and stop channel of cluster
-  UShort_t start = channel;
-  UShort_t stop = channel;
-  UShort_t testChannel;
-
-  // Case: front-side channel
-  if ( channel < fSize/2 ) {
-
-    // Normal clustering
-    if ( ! fConnectEdgeFront ) {
-      while ( start > 0 && fIndex[start-1] > -1 ) start--;
-      while ( stop < fSize/2 - 1 && fIndex[stop+1] > -1 ) stop++;
-    } //? normal clustering
-
-    // Clustering round-the-edge
-    else {
-      testChannel = ( channel ? channel - 1 : fSize/2 - 1);
-      while ( fIndex[testChannel] > -1 ) {
-        start = testChannel;
-        testChannel = ( start ? start - 1 : fSize/2 - 1);
-      }
-      testChannel = ( channel == fSize/2 - 1 ? 0 : channel + 1);
-      while ( fIndex[testChannel] > -1 ) {
-        stop = testChannel;
-        testChannel = ( stop == fSize/2 - 1 ? 0 : stop + 1);
-      }
-    } //? clustering round the edge
-
-  } //? Front-side channel
-
-
-  // Case: back-side channel
-  else  {
-
-    // Normal clustering
-    if ( ! fConnectEdgeBack ) {
-      while ( start > fSize/2 && fIndex[start-1] > -1 ) start--;
-      while ( stop < fSize - 1 && fIndex[stop+1] > -1 ) stop++;
-    }
-
-    // Clustering round-the-edge
-    else {
-      testChannel = ( channel == fSize/2 ? fSize - 1 : channel - 1);
-      while ( fIndex[testChannel] > -1 ) {
-        start = testChannel;
-        testChannel = ( start == fSize/2 ? fSize - 1 : start - 1);
-      }
-      testChannel = ( channel == fSize - 1 ? fSize/2 : channel + 1);
-      while ( fIndex[testChannel] > -1 ) {
-        stop = testChannel;
-        testChannel = ( stop == fSize - 1 ? fSize/2 : stop + 1);
-      }
-    } //? clustering round the edge
-
-  }//? back-side channel
-
-  // Create a cluster object
+  // Channel range of the module side
+  UShort_t low  = ( channel < fSize/2 ? 0 : fSize/2 );
+  UShort_t high = low + fSize/2 - 1;
+  Bool_t connectEdge = ( channel < fSize/2 ? fConnectEdgeFront
+                                           : fConnectEdgeBack );
+
+  // Find start and stop channel of cluster from the runs of active channels
+  UShort_t start = fActive.RunStart(channel, low);
+  UShort_t stop = fActive.RunStop(channel, high);
+
+  // Clustering round-the-edge: continue the run on the other end of the side.
+  // If all channels of the side are active, the cluster spans the full side.
+  if ( connectEdge && ! ( start == low && stop == high ) ) {
+    if ( start == low && fActive.IsSet(high) )
+      start = fActive.RunStart(high, stop + 1);
+    if ( stop == high && fActive.IsSet(low) )
+      stop = fActive.RunStop(low, start - 1);
+  } //? clustering round the edge
+
+  // Create a cluster object. The channels are reset there.
   CreateCluster(start, stop);
 
-  // Reset channels added to the cluster
-  for (UShort_t iChannel = start; iChannel <= stop; iChannel++) {
-    assert( iChannel <= fSize );
-    fIndex[iChannel] = -1;
-    fTime[iChannel] = 0.;
-  }
-
 }
 // -------------------------------------------------------------------------
 
@@ -235,94 +233,180 @@ void CbmStsDigisToHitsModule::FinishCluster(UShort_t channel) {
 // -----   Process active clusters   ---------------------------------------
 void CbmStsDigisToHitsModule::ProcessBuffer() {
 
-  for (UShort_t channel = 0; channel < fSize; channel++) {
-    if ( fIndex[channel] == - 1 ) continue;
+  // Active channels are found from the bitmap in ascending order
+  for (Int_t channel = fActive.FindNext(0); channel >= 0;
+       channel = fActive.FindNext(channel))
     FinishCluster(channel);
+
+}
+// -------------------------------------------------------------------------
+
+
+// -----   Order the staged digis by input index   -------------------------
+void CbmStsDigisToHitsModule::SortDigis() {
+
+  fDigiOrder.clear();
+
+  // The distribution preserves the input order, so the staged digis
+  // are usually sorted already. This is checked first.
+  Bool_t isSorted = kTRUE;
+  for (Int_t iDigi = 1; iDigi < fNofDigisInQueue; iDigi++) {
+    if ( fDigiIndex[iDigi] < fDigiIndex[iDigi-1] ) {
+      isSorted = kFALSE;
+      break;
+    }
+  }
+  if ( isSorted ) return;
+
+  // Else: LSD radix sort of the processing order on the (non-negative)
+  // digi index, 8 bits per pass. Passes in which all keys fall into the
+  // same bucket are skipped.
+  LOG(debug2) << GetName() << ": Sorting " << fNofDigisInQueue << " digis";
+  fDigiOrder.resize(fNofDigisInQueue);
+  fDigiOrderTemp.resize(fNofDigisInQueue);
+  for (Int_t iDigi = 0; iDigi < fNofDigisInQueue; iDigi++)
+    fDigiOrder[iDigi] = iDigi;
+  for (UInt_t shift = 0; shift < 32; shift += 8) {
+    Int_t count[257] = { 0 };
+    for (Int_t iDigi : fDigiOrder)
+      count[ ( ( UInt_t(fDigiIndex[iDigi]) >> shift ) & 0xFF ) + 1 ]++;
+    Bool_t isTrivial = kFALSE;
+    for (Int_t bucket = 1; bucket <= 256; bucket++)
+      if ( count[bucket] == fNofDigisInQueue ) isTrivial = kTRUE;
+    if ( isTrivial ) continue;
+    for (Int_t bucket = 1; bucket <= 256; bucket++)
+      count[bucket] += count[bucket-1];
+    for (Int_t iDigi : fDigiOrder)
+      fDigiOrderTemp[ count[ ( UInt_t(fDigiIndex[iDigi]) >> shift ) & 0xFF ]++ ]
+          = iDigi;
+    fDigiOrder.swap(fDigiOrderTemp);
   }
 
 }
 // -------------------------------------------------------------------------
 
 
-// --------------- Add single digi to buffer ------------------------------
-void CbmStsDigisToHitsModule::AddDigiToQueue(const CbmStsDigi* digi, Int_t digiIndex) {
 
-  lock.lock();
+// -----   Analyse the clusters of this module   ---------------------------
+void CbmStsDigisToHitsModule::AnalyzeClusters() {
 
-  fDigiQueue.push_back(std::make_tuple(digi, digiIndex));
-  //fDigiIndex.push_back(digiIndex);
+  // The clusters not yet analysed are the last ones in the module list
+  Int_t nClusters = fClusterFirst.size() - 1;
+  if ( nClusters ) {
+    assert( fAna );
+    assert( Int_t(fModuleClusters.size()) >= nClusters );
+    fAna->AnalyzeBatch(fModule, nClusters,
+                       fModuleClusters.data() + fModuleClusters.size() - nClusters,
+                       fClusterFirst.data(), fClusterChannel.data(),
+                       fClusterCharge.data(), fClusterTime.data());
+  }
 
+  // Reset the staging arrays
+  fClusterChannel.clear();
+  fClusterCharge.clear();
+  fClusterTime.clear();
+  fClusterFirst.assign(1, 0);
 
-  lock.unlock();
 }
 // -------------------------------------------------------------------------
 
 
-// -----   Process all digis of module   -----------------------------------
-void CbmStsDigisToHitsModule::ProcessDigis(CbmEvent* event) {
 
-  // Sort the Digi Buffer by time
-  //LOG(INFO) << "Sorting digiQueue" << FairLogger::endl;
-  std::sort(fDigiQueue.begin(), fDigiQueue.end(), [] (std::tuple<const CbmStsDigi*, Int_t> digi1, std::tuple<const CbmStsDigi*, Int_t> digi2) {return std::get<1>(digi1) < std::get<1>(digi2);});
+// -----   Cluster the staged digis   --------------------------------------
+void CbmStsDigisToHitsModule::ClusterDigis() {
 
-  //Process each individual digi
-  //LOG(INFO) << "Processing individual digis" << FairLogger::endl;
-  for (UInt_t iDigi = 0; iDigi < fDigiQueue.size(); iDigi++){
-    ProcessDigi(std::get<0>(fDigiQueue[iDigi])->GetChannel(), std::get<0>(fDigiQueue[iDigi])->GetTime(), std::get<1>(fDigiQueue[iDigi]));
-  }
+  // Processing order: ascending input index
+  SortDigis();
 
-  //LOG(INFO) << "Processing remaining digis" << FairLogger::endl;
-  // Process Remaining Digis
-  for (UShort_t channel = 0; channel < fSize; channel++) {
-    if ( fIndex[channel] == - 1 ) continue;
-    FinishCluster(channel);
+  // Process each individual digi
+  if ( fDigiOrder.empty() ) {
+    for (Int_t iDigi = 0; iDigi < fNofDigisInQueue; iDigi++)
+      ProcessDigi(fDigiChannel[iDigi], fDigiTime[iDigi], fDigiCharge[iDigi],
+                  fDigiIndex[iDigi]);
+  }
+  else {
+    for (Int_t iDigi : fDigiOrder)
+      ProcessDigi(fDigiChannel[iDigi], fDigiTime[iDigi], fDigiCharge[iDigi],
+                  fDigiIndex[iDigi]);
   }
 
-  //LOG(INFO) << "Sorting Cluster in Modules" << FairLogger::endl;
+  // Process remaining digis in channels
+  ProcessBuffer();
+
+}
+// -------------------------------------------------------------------------
+
+
+// -----   Find hits from the clusters of this module   --------------------
+Int_t CbmStsDigisToHitsModule::FindHits(CbmEvent* event) {
+
+  // Sort clusters by time for optimized hit finding
+  CbmStsModule::SortClustersByTime(fModuleClusters);
+
+  assert(fArena);
+  fHitContext.SetOutput(fArena->GetHits(), event);
+  Int_t nHits = fModule->FindHits(fModuleClusters, fHitContext,
+                                  fTimeCutClustersInNs, fTimeCutClustersInSigma);
+  fNofHits += nHits;
+  return nHits;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Find hits from the clusters of this module (vector output)   ---
+Int_t CbmStsDigisToHitsModule::FindHitsVector(CbmEvent* event) {
+
+  //Sort clusters by time in module for optimized hit finding
+  CbmStsModule::SortClustersByTime(fModuleClusters);
+
+  fHitContext.SetOutput(&fHitOutputVector, event);
+  return fModule->FindHits(fModuleClusters, fHitContext,
+                           fTimeCutClustersInNs, fTimeCutClustersInSigma);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Set the output storage   ---------------------------------------
+void CbmStsDigisToHitsModule::SetArena(CbmStsRecoArena* arena) {
+  assert(arena);
+  fArena = arena;
+  fFirstCluster = arena->GetNofClusters();
+  fFirstHit = arena->GetNofHits();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Process all digis of module   -----------------------------------
+void CbmStsDigisToHitsModule::ProcessDigis(CbmEvent* event) {
+
+  // Cluster the staged digis
+  ClusterDigis();
+  AnalyzeClusters();
+
   // Process Clusters to Hits
-  
-  fModule->SortClustersByTime();
-  //LOG(INFO) << "Calculating hits from clusters" << FairLogger::endl;
-  // Int_t clusters = fModule->GetNofClsters();
-  //LOG(INFO) << "Clusters in Module" << moduleNumber << " is " << fModule->GetClusters().size();
-  //LOG(INFO) << "CutInNs = " << fTimeCutClustersInNs << " CutInSigma = " << fTimeCutClustersInSigma;
   LOG(DEBUG) << "Processing module number " << fModule;
-  //  Int_t nModuleHits = fModule->FindHits(fHitOutput, event, fTimeCutClustersInNs, fTimeCutClustersInSigma);
-  fModule->FindHits(fHitOutput, event, fTimeCutClustersInNs, fTimeCutClustersInSigma);
+  FindHits(event);
 
 
   //return fDigiQueue.size(); 
-  //return fClusterOutput->GetEntriesFast();
-  //return fHitOutput->GetEntriesFast();
   //LOG(INFO) << "nModule Hits = " << nModuleHits;
   //return nModuleHits;
-//  return fHitOutput;
 }
 // -------------------------------------------------------------------------
 
 
 // -----   Process all digis of module   -----------------------------------
-std::vector<CbmStsHit> CbmStsDigisToHitsModule::ProcessDigisAndAbsorbAsVector(CbmEvent* event) {
-
-  // Sort the Digi Buffer by time
-  std::sort(fDigiQueue.begin(), fDigiQueue.end(), [] (std::tuple<const CbmStsDigi*, Int_t> digi1, std::tuple<const CbmStsDigi*, Int_t> digi2) {return std::get<1>(digi1) < std::get<1>(digi2);});
-
-  //Process each individual digi
-  for (UInt_t iDigi = 0; iDigi < fDigiQueue.size(); iDigi++){
-    ProcessDigi(std::get<0>(fDigiQueue[iDigi])->GetChannel(), std::get<0>(fDigiQueue[iDigi])->GetTime(), std::get<1>(fDigiQueue[iDigi]));
-  }
-
-  // Process Remaining Digis in channels  
-  for (UShort_t channel = 0; channel < fSize; channel++) {
-    if ( fIndex[channel] == - 1 ) continue;
-    FinishCluster(channel);
-  }
+const std::vector<CbmStsHit>& CbmStsDigisToHitsModule::ProcessDigisAndAbsorbAsVector(CbmEvent* event) {
 
-  //Sort clusters by time in module for optimized hit finding
-  fModule->SortClustersByTime();
+  // Cluster the staged digis
+  ClusterDigis();
+  AnalyzeClusters();
 
   // Process Clusters to Hits
-  fModule->FindHitsVector(&fHitOutputVector, event, fTimeCutClustersInNs, fTimeCutClustersInSigma);
+  FindHitsVector(event);
 
   return fHitOutputVector;
 }
@@ -331,7 +415,7 @@ std::vector<CbmStsHit> CbmStsDigisToHitsModule::ProcessDigisAndAbsorbAsVector(Cb
 
 // ----- Process an input digi   -------------------------------------------
 Bool_t CbmStsDigisToHitsModule::ProcessDigi(UShort_t channel, Double_t time,
-                                              Int_t index) {
+                                              UShort_t charge, Int_t index) {
 
   // Assert channel number
   assert ( channel < fSize );
@@ -360,6 +444,8 @@ Bool_t CbmStsDigisToHitsModule::ProcessDigi(UShort_t channel, Double_t time,
   // Set channel active
   fIndex[channel] = index;
   fTime[channel] = time;
+  fCharge[channel] = charge;
+  fActive.Set(channel);
 
   return kTRUE;
 }
@@ -367,17 +453,51 @@ Bool_t CbmStsDigisToHitsModule::ProcessDigi(UShort_t channel, Double_t time,
 
 
 
+// -----   Update the time cut table   -------------------------------------
+void CbmStsDigisToHitsModule::UpdateTimeCuts() {
+
+  // Nothing to do if the module parameters did not change
+  if ( ! fTimeCutTable.empty()
+       && ( ! fModule || fModule->GetParameterVersion() == fParameterVersion ) )
+    return;
+
+  fTimeCutTable.resize(fSize);
+  for (UShort_t channel = 0; channel < fSize; channel++) {
+    if ( fTimeCutDigisInNs > 0. || ! fModule ) fTimeCutTable[channel] = fTimeCutDigisInNs;
+    else fTimeCutTable[channel] = fTimeCutDigisInSigma * TMath::Sqrt(2.)
+        * fModule->GetAsicParameters(channel).GetTimeResolution();
+  }
+  if ( fModule ) fParameterVersion = fModule->GetParameterVersion();
+
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Reset the channel vectors   -------------------------------------
 void CbmStsDigisToHitsModule::Reset() {
 
-  fIndex.assign(fSize, -1);
-  fTime.assign(fSize, 0.);
+  // Only the active channels need to be reset
+  for (Int_t channel = fActive.FindNext(0); channel >= 0;
+       channel = fActive.FindNext(channel + 1)) {
+    fIndex[channel] = -1;
+    fTime[channel] = 0.;
+  }
+  fActive.Reset();
+  UpdateTimeCuts();
 
   //DigisToHits
-  fModule->ClearClusters();
+  fModuleClusters.clear();
+  fClusterChannel.clear();
+  fClusterCharge.clear();
+  fClusterTime.clear();
+  fClusterFirst.assign(1, 0);
   fHitOutputVector.clear();
-  fDigiQueue.clear();
-  fHitOutput->Clear();
-  fClusterOutput->Clear();
+  fDigiChannel = nullptr;
+  fDigiTime = nullptr;
+  fDigiCharge = nullptr;
+  fDigiIndex = nullptr;
+  fNofDigisInQueue = 0;
+  fNofHits = 0;
 }
 // -------------------------------------------------------------------------
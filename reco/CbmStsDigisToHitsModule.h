@@ -5,13 +5,15 @@
 #define CBMSTSDIGISTOHITSMODULE_H 1
 
 #include <vector>
-#include <mutex>
 #include "TNamed.h"
+#include "CbmStsChannelBitmap.h"
 #include "CbmStsModule.h"
 #include "CbmStsHit.h"
+#include "CbmStsHitContext.h"
 
 class TClonesArray;
 class CbmStsClusterAnalysis;
+class CbmStsRecoArena;
 
 /** @class CbmStsDigisToHitsModule
  ** @brief Class for finding clusters in one STS module
@@ -117,29 +119,130 @@ class CbmStsDigisToHitsModule : public TNamed
     /** Process an input digi
      ** @param channel   Channel number
      ** @param time      Digi time [ns]
+     ** @param charge    Digi charge [ADC units]
      ** @param index     Index of digi object in its TClonesArray
      ** @return  kTRUE is digi was successfully processed
      **/
-    Bool_t ProcessDigi(UShort_t channel, Double_t time, Int_t index);
+    Bool_t ProcessDigi(UShort_t channel, Double_t time, UShort_t charge,
+                       Int_t index);
 
 
     /** Reset the internal bookkeeping **/
     void Reset();
 
     //DigisToHits
-    void AddDigiToQueue(const CbmStsDigi* digi, Int_t digiIndex);
+    /** @brief Index of the module in the setup **/
+    Int_t GetModuleNumber() const { return moduleNumber; }
 
-    TClonesArray* ProcessDigisAndAbsorb(CbmEvent* event)
-    {
-      ProcessDigis(event);
-      return fHitOutput;
+
+    /** @brief Set the digis to be processed by this module
+     ** @param channel  Array of digi channels
+     ** @param time     Array of digi times [ns]
+     ** @param charge   Array of digi charges [ADC units]
+     ** @param index    Array of digi indices in the input
+     ** @param nDigis   Number of digis
+     **
+     ** The digi data are staged as structure of arrays. They are not owned
+     ** by the module; they live in the common distribution buffer of
+     ** CbmStsDigisToHits and must stay valid until the module has been
+     ** processed.
+     **/
+    void SetDigiQueue(const UShort_t* channel, const Double_t* time,
+                      const UShort_t* charge, const Int_t* index,
+                      Int_t nDigis) {
+      fDigiChannel = channel;
+      fDigiTime = time;
+      fDigiCharge = charge;
+      fDigiIndex = index;
+      fNofDigisInQueue = nDigis;
     }
+
+
+    /** @brief Determine the parameters of the found clusters
+     **
+     ** The clusters found since the last call are analysed in one batch
+     ** (see CbmStsClusterAnalysis::AnalyzeBatch). Must be called after
+     ** ClusterDigis and before the hit finding.
+     **/
+    void AnalyzeClusters();
+
+
+    /** @brief Run the clustering over the staged digis
+     **
+     ** Digis are processed in ascending order of their input index;
+     ** afterwards, the remaining active channels are flushed. The digi
+     ** properties of the clusters are staged for AnalyzeClusters.
+     **/
+    void ClusterDigis();
+
+
+    /** @brief Find hits from the clusters of this module
+     ** @param event  Pointer to event object (nullptr for time slice)
+     ** @return Number of created hits
+     **
+     ** The clusters are sorted w.r.t. time; the hits are appended to the
+     ** hit array of the arena. The state of the hit finding is kept in the
+     ** context of this object, such that several finder modules may process
+     ** the same module concurrently.
+     **/
+    Int_t FindHits(CbmEvent* event);
+
+
+    /** @brief Find hits from the clusters of this module, with vector output
+     ** @param event  Pointer to event object (nullptr for time slice)
+     ** @return Number of created hits
+     **
+     ** As FindHits, but the hits are stored in the hit vector of the module
+     ** (see GetHitOutputVector).
+     **/
+    Int_t FindHitsVector(CbmEvent* event);
+
+
+    /** @brief Set the storage for clusters and hits
+     ** @param arena  Arena of the calling thread (not owned)
+     **
+     ** The clusters and hits of the module are appended to the arena.
+     ** Their range in the arena starts at the current arena size; the
+     ** cluster indices (and thus the cluster ids in the hits) refer to
+     ** the arena. The arena has to be set before processing.
+     **/
+    void SetArena(CbmStsRecoArena* arena);
+
+
+    /** @brief Cluster and hit finding with output to the arena
+     ** @param event  Pointer to event object (nullptr for time slice)
+     **/
     void ProcessDigis(CbmEvent* event);
 
-    std::vector<CbmStsHit> ProcessDigisAndAbsorbAsVector(CbmEvent* event);
+    /** @brief Cluster and hit finding with hits stored in a vector
+     ** @param event  Pointer to event object (nullptr for time slice)
+     ** @return Reference to the hit vector of this module
+     **
+     ** The hits stay owned by the module until the next Reset().
+     **/
+    const std::vector<CbmStsHit>& ProcessDigisAndAbsorbAsVector(CbmEvent* event);
 
-    TClonesArray* GetClusterOutput() { return fClusterOutput;}
-    TClonesArray* GetHitOutput() { return fHitOutput;}
+    /** @brief Arena the output was written to **/
+    CbmStsRecoArena* GetArena() const { return fArena; }
+
+    /** @brief Index of the first cluster of this module in the arena **/
+    Int_t GetFirstCluster() const { return fFirstCluster; }
+
+    /** @brief Index of the first hit of this module in the arena **/
+    Int_t GetFirstHit() const { return fFirstHit; }
+
+    /** @brief Number of clusters found since the last Reset() **/
+    Int_t GetNofClusters() const { return fModuleClusters.size(); }
+
+    /** @brief Number of hits found in the arena since the last Reset() **/
+    Int_t GetNofHits() const { return fNofHits; }
+
+    const std::vector<CbmStsHit>& GetHitOutputVector() const {
+      return fHitOutputVector;
+    }
+
+    /** @brief Context of the hit finding (output and pairing counters) **/
+    const CbmStsHitContext& GetHitContext() const { return fHitContext; }
 
 
   private:
@@ -155,16 +258,34 @@ class CbmStsDigisToHitsModule : public TNamed
     TClonesArray* fClusters;      //! Output array for clusters
     std::vector<Int_t> fIndex;    //! Channel -> digi index
     std::vector<Double_t> fTime;  //! Channel -> digi time
+    CbmStsChannelBitmap fActive;  //! Channels with active digi
+    std::vector<UShort_t> fCharge; //! Channel -> digi charge (ADC)
+    std::vector<Double_t> fTimeCutTable; //! Channel -> max. time difference [ns]
+    UInt_t fParameterVersion;     //! Module parameter version of the table
 
     //DigisToHits
-    std::vector<std::tuple<const CbmStsDigi*, Int_t>> fDigiQueue;
+    const UShort_t* fDigiChannel; //! Staged digi channels (not owned)
+    const Double_t* fDigiTime;    //! Staged digi times (not owned)
+    const UShort_t* fDigiCharge;  //! Staged digi charges (not owned)
+    const Int_t* fDigiIndex;      //! Staged digi indices (not owned)
+    Int_t fNofDigisInQueue;       //! Number of staged digis
+    std::vector<Int_t> fDigiOrder;         //! Processing order of staged digis
+    std::vector<Int_t> fDigiOrderTemp;     //! Work buffer for sorting
+    std::vector<UShort_t> fClusterChannel; //! Channels of staged clusters
+    std::vector<UShort_t> fClusterCharge;  //! Charges of staged clusters
+    std::vector<Double_t> fClusterTime;    //! Times of staged clusters
+    std::vector<Int_t> fClusterFirst;      //! First staged digi per cluster
     Int_t clusterCount = 1;
     Int_t moduleNumber;
     CbmStsClusterAnalysis* fAna;
-    TClonesArray* fClusterOutput;
-    TClonesArray* fHitOutput;
+    CbmStsRecoArena* fArena;               //! Output storage (not owned)
+    Int_t fFirstCluster;                   //! First cluster in arena
+    Int_t fFirstHit;                       //! First hit in arena
+    Int_t fNofHits;                        //! Hits in arena
+    std::vector<Int_t> fClusterDigis;      //! Digi indices of current cluster
+    std::vector<CbmStsCluster*> fModuleClusters; //! Clusters of this module
     std::vector<CbmStsHit> fHitOutputVector;
-    std::mutex lock;
+    CbmStsHitContext fHitContext;          //! Output and work space of hit finding
     //std::vector<Int_t> fDigiIndex;
 
 
@@ -187,6 +308,23 @@ class CbmStsDigisToHitsModule : public TNamed
     void CreateCluster(UShort_t first, UShort_t last);
 
 
+    /** @brief Determine the processing order of the staged digis
+     **
+     ** If the staged digis are already sorted w.r.t. their input index,
+     ** fDigiOrder is left empty. Else, it is filled with the permutation
+     ** that sorts them (stable LSD radix sort).
+     **/
+    void SortDigis();
+
+
+    /** @brief Update the time cut per channel
+     **
+     ** The table is built from the time resolution of the asics (or from
+     ** the user-set value) and rebuilt when the module parameters changed.
+     **/
+    void UpdateTimeCuts();
+
+
     /** Close an active cluster
      ** @param channel  Channel number
      **/
@@ -5,8 +5,10 @@
 
 #include "CbmStsFindClusters.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iomanip>
+#include <omp.h>
 #include "TClonesArray.h"
 #include "FairEventHeader.h"
 #include "FairRun.h"
@@ -40,6 +42,8 @@ CbmStsFindClusters::CbmStsFindClusters(ECbmMode mode)
     , fDigiPar(nullptr)
     , fAna(nullptr)
     , fTimer()
+    , fTiming()
+    , fTimingFile()
     , fMode(mode)
     , fTimeCutInSigma(3.)
     , fTimeCut(-1.)
@@ -51,6 +55,10 @@ CbmStsFindClusters::CbmStsFindClusters(ECbmMode mode)
     , fNofClusters(0.)
     , fTimeTot(0.)
     , fModules()
+    , fModuleIndex()
+    , fParallelism_enabled(kFALSE)
+    , fWorkspaces()
+    , fEventOutput()
 {
 }
 // -------------------------------------------------------------------------
@@ -64,14 +72,51 @@ CbmStsFindClusters::~CbmStsFindClusters() {
   if ( fAna ) delete fAna;
 
   // Delete cluster finder modules
-  auto it = fModules.begin();
-  while ( it != fModules.end() ) delete it->second;
+  for (auto it = fModules.begin(); it != fModules.end(); it++)
+    delete it->second;
+
+  // Delete event workspaces
+  for (EventWorkspace* workspace : fWorkspaces) {
+    for (CbmStsClusterFinderModule* module : workspace->fModules) delete module;
+    delete workspace->fClusters;
+    delete workspace;
+  }
 
 }
 // -------------------------------------------------------------------------
 
 
 
+// -----   Instantiate a cluster finding module   --------------------------
+CbmStsClusterFinderModule* CbmStsFindClusters::CreateModule(Int_t iModule,
+                                                        TClonesArray* output) {
+
+  CbmStsModule* module = fSetup->GetModule(iModule);
+  assert(module);
+  assert(module->IsSet());
+  const char* name = module->GetName();
+  UShort_t nChannels = module->GetNofChannels();
+  CbmStsClusterFinderModule* finderModule =
+      new CbmStsClusterFinderModule(nChannels, fTimeCut, fTimeCutInSigma, name, module, output);
+
+  // --- Check whether there be round-the corner clustering. This happens
+  // --- only for DssdStereo sensors with non-vanishing stereo angle, where
+  // --- a double-metal layer horizontally connects strips.
+  CbmStsSensorDssdStereo* sensor =
+      dynamic_cast<CbmStsSensorDssdStereo*>(module->GetDaughter(0));
+  if ( sensor ) {
+    if ( TMath::Abs(sensor->GetStereoAngle(0)) > 1. )
+      finderModule->ConnectEdgeFront();
+    if ( TMath::Abs(sensor->GetStereoAngle(1)) > 1. )
+      finderModule->ConnectEdgeBack();
+  }
+
+  return finderModule;
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Initialise the cluster finding modules   ------------------------
 Int_t CbmStsFindClusters::CreateModules() {
 
@@ -82,29 +127,14 @@ Int_t CbmStsFindClusters::CreateModules() {
   }
 
   Int_t nModules = fSetup->GetNofModules();
+  fModuleIndex.resize(nModules);
   for (Int_t iModule = 0; iModule < nModules; iModule++) {
-    CbmStsModule* module = fSetup->GetModule(iModule);
-    assert(module);
-    assert(module->IsSet());
-    Int_t address = module->GetAddress();
-    const char* name = module->GetName();
-    UShort_t nChannels = module->GetNofChannels();
-    CbmStsClusterFinderModule* finderModule =
-        new CbmStsClusterFinderModule(nChannels, fTimeCut, fTimeCutInSigma, name, module, fClusters);
-
-    // --- Check whether there be round-the corner clustering. This happens
-    // --- only for DssdStereo sensors with non-vanishing stereo angle, where
-    // --- a double-metal layer horizontally connects strips.
-    CbmStsSensorDssdStereo* sensor =
-        dynamic_cast<CbmStsSensorDssdStereo*>(module->GetDaughter(0));
-    if ( sensor ) {
-      if ( TMath::Abs(sensor->GetStereoAngle(0)) > 1. )
-        finderModule->ConnectEdgeFront();
-      if ( TMath::Abs(sensor->GetStereoAngle(1)) > 1. )
-        finderModule->ConnectEdgeBack();
-    }
-    fModules[address] = finderModule;
+    fSetup->GetModule(iModule)->UpdateAsicTables();  // used by the analysis
+    CbmStsClusterFinderModule* finderModule = CreateModule(iModule, fClusters);
+    fModules[fSetup->GetModule(iModule)->GetAddress()] = finderModule;
+    fModuleIndex[iModule] = finderModule;
   }
+  fTiming.Init(nModules, omp_get_max_threads());
   LOG(info) << GetName() << ": " << fModules.size()
   		<< " reco modules created.";
 
@@ -125,6 +155,8 @@ void CbmStsFindClusters::Exec(Option_t*) {
 
   // --- Reset output array
   fClusters->Delete();
+  fTiming.Init(fModuleIndex.size(),
+               fParallelism_enabled ? omp_get_max_threads() : 1);
 
   // --- Time-slice mode: process entire array
   if ( fMode == kCbmTimeslice ) ProcessData(nullptr);
@@ -136,13 +168,10 @@ void CbmStsFindClusters::Exec(Option_t*) {
     LOG(info) << setw(20) << left << GetName() << ": Processing time slice "
         << fNofTimeslices << " with " << nEvents
         << (nEvents == 1 ? " event" : " events");
-    for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
-      CbmEvent* event = dynamic_cast<CbmEvent*>(fEvents->At(iEvent));
-      assert(event);
-      ProcessData(event);
-    } //# events
+    ProcessEvents();
   } //? event mode
 
+  fTiming.EndSlice();
   fNofTimeslices++;
 }
 // -------------------------------------------------------------------------
@@ -188,6 +217,13 @@ void CbmStsFindClusters::Finish() {
         << fTimeTot / Double_t(fNofEvents) << " s ";
   } //? event mode
 
+  LOG(info) << "Stage timing          : \n" << fTiming.ToString();
+  if ( ! fTimingFile.empty() ) {
+    if ( fTiming.Write(fTimingFile, GetName()) )
+      LOG(info) << "Timing summary written to " << fTimingFile;
+    else LOG(error) << GetName() << ": Cannot write timing summary to "
+        << fTimingFile;
+  }
   LOG(info) << "=====================================";
 
 }
@@ -267,6 +303,7 @@ void CbmStsFindClusters::ProcessData(CbmEvent* event) {
     it->second->Reset();
   fTimer.Stop();
   Double_t time1 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kReset, time1);
 
   // --- Start index of newly created clusters
   Int_t indexFirst = fClusters->GetEntriesFast();
@@ -292,6 +329,7 @@ void CbmStsFindClusters::ProcessData(CbmEvent* event) {
     it->second->ProcessBuffer();
   fTimer.Stop();
   Double_t time3 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kCluster, time2 + time3);
 
   // --- Stop index of newly created clusters
   Int_t indexLast = fClusters->GetEntriesFast();
@@ -300,12 +338,13 @@ void CbmStsFindClusters::ProcessData(CbmEvent* event) {
   fTimer.Start();
   for (Int_t index = indexFirst; index < indexLast; index++) {
     CbmStsCluster* cluster = dynamic_cast<CbmStsCluster*>(fClusters->At(index));
-    CbmStsModule* module = dynamic_cast<CbmStsModule*>
-    (fSetup->GetElement(cluster->GetAddress(), kStsModule));
+    CbmStsModule* module =
+        fSetup->GetModule(fSetup->GetModuleIndex(cluster->GetAddress()));
     fAna->Analyze(cluster, module);
   }
   fTimer.Stop();
   Double_t time4 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kAnalyse, time4);
 
   // --- In event-by-event mode: register clusters to event
   fTimer.Start();
@@ -316,6 +355,7 @@ void CbmStsFindClusters::ProcessData(CbmEvent* event) {
 
   fTimer.Stop();
   Double_t time5 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kOutput, time5);
 
   // --- Counters
   Int_t nClusters = indexLast - indexFirst;
@@ -348,18 +388,177 @@ void CbmStsFindClusters::ProcessData(CbmEvent* event) {
 
 
 
+// -----   Process one event in a workspace   ------------------------------
+void CbmStsFindClusters::ProcessEvent(CbmEvent* event,
+                                      EventWorkspace& workspace,
+                                      EventOutput& output) {
+
+  assert(event);
+  Int_t nModules = fModuleIndex.size();
+  if ( workspace.fModules.empty() ) {
+    workspace.fModules.assign(nModules, nullptr);
+    workspace.fIsTouched.assign(nModules, kFALSE);
+  }
+  output.fFirstCluster = workspace.fClusters->GetEntriesFast();
+
+  // --- Loop over input digis. Modules are reset when first touched.
+  Int_t thread = output.fThread;
+  Double_t tStart = omp_get_wtime();
+  Int_t nDigis = event->GetNofData(kStsDigi);
+  Int_t nGood = 0;
+  workspace.fTouched.clear();
+  for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+    Int_t digiIndex = event->GetIndex(kStsDigi, iDigi);
+    const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(digiIndex);
+    assert(digi);
+    Int_t iModule = fSetup->GetModuleIndex(digi->GetAddress());
+    assert( iModule >= 0 && iModule < nModules );
+    CbmStsClusterFinderModule* module = workspace.fModules[iModule];
+    if ( ! module ) {
+      #pragma omp critical(CbmStsFindClusters_CreateModule)
+      module = CreateModule(iModule, workspace.fClusters);
+      workspace.fModules[iModule] = module;
+    }
+    if ( ! workspace.fIsTouched[iModule] ) {
+      module->Reset();
+      workspace.fIsTouched[iModule] = kTRUE;
+      workspace.fTouched.push_back(iModule);
+    }
+    UShort_t channel = digi->GetChannel();
+    assert ( channel < module->GetSize() );
+    if ( module->ProcessDigi(channel, digi->GetTime(), digiIndex) ) nGood++;
+  } //# digis in event
+
+  // --- Process remaining clusters in the buffers of the touched modules,
+  // --- in the same order as in ProcessData (by module address)
+  std::sort(workspace.fTouched.begin(), workspace.fTouched.end(),
+            [this] (Int_t module1, Int_t module2) {
+              return fSetup->GetModule(module1)->GetAddress()
+                   < fSetup->GetModule(module2)->GetAddress();
+            });
+  for (Int_t iModule : workspace.fTouched) {
+    workspace.fModules[iModule]->ProcessBuffer();
+    workspace.fIsTouched[iModule] = kFALSE;
+  }
+
+  // --- Determine cluster parameters
+  Double_t tCluster = omp_get_wtime();
+  Int_t indexLast = workspace.fClusters->GetEntriesFast();
+  for (Int_t index = output.fFirstCluster; index < indexLast; index++) {
+    CbmStsCluster* cluster =
+        static_cast<CbmStsCluster*>(workspace.fClusters->UncheckedAt(index));
+    CbmStsModule* module =
+        fSetup->GetModule(fSetup->GetModuleIndex(cluster->GetAddress()));
+    fAna->Analyze(cluster, module);
+  }
+  Double_t tAnalyse = omp_get_wtime();
+  fTiming.AddTime(thread, CbmStsRecoTiming::kCluster, tCluster - tStart);
+  fTiming.AddTime(thread, CbmStsRecoTiming::kAnalyse, tAnalyse - tCluster);
+
+  output.fNofDigis = nDigis;
+  output.fNofGood = nGood;
+  output.fNofClusters = indexLast - output.fFirstCluster;
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Process all events of the time slice   --------------------------
+void CbmStsFindClusters::ProcessEvents() {
+
+  assert(fEvents);
+  Int_t nEvents = fEvents->GetEntriesFast();
+  Int_t nThreads = ( fParallelism_enabled ? omp_get_max_threads() : 1 );
+
+  // --- Workspaces, one per thread
+  while ( Int_t(fWorkspaces.size()) < nThreads ) {
+    EventWorkspace* workspace = new EventWorkspace();
+    workspace->fClusters = new TClonesArray("CbmStsCluster", 1000);
+    fWorkspaces.push_back(workspace);
+  }
+  for (EventWorkspace* workspace : fWorkspaces)
+    workspace->fClusters->Delete();
+  fEventOutput.assign(nEvents, EventOutput());
+
+  // --- Process the events concurrently, each in the workspace of its thread
+  fTimer.Start();
+  #pragma omp parallel for schedule(dynamic, 1) if(fParallelism_enabled)
+  for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
+    CbmEvent* event = static_cast<CbmEvent*>(fEvents->At(iEvent));
+    Int_t thread = omp_get_thread_num();
+    fEventOutput[iEvent].fThread = thread;
+    ProcessEvent(event, *fWorkspaces[thread], fEventOutput[iEvent]);
+  } //# events
+  fTimer.Stop();
+  Double_t time1 = fTimer.RealTime();
+
+  // --- Prefix sum over the events gives the positions in the output
+  fTimer.Start();
+  Int_t nDigis = 0;
+  Int_t nGood = 0;
+  Int_t offset = fClusters->GetEntriesFast();
+  for (EventOutput& output : fEventOutput) {
+    output.fClusterOffset = offset;
+    offset += output.fNofClusters;
+    nDigis += output.fNofDigis;
+    nGood += output.fNofGood;
+  }
+  Int_t nClusters = offset - fClusters->GetEntriesFast();
+  fClusters->ExpandCreate(offset);
+
+  // --- Copy the clusters into their slots and register them to the event
+  #pragma omp parallel for schedule(dynamic) if(fParallelism_enabled)
+  for (Int_t iEvent = 0; iEvent < nEvents; iEvent++) {
+    CbmEvent* event = static_cast<CbmEvent*>(fEvents->At(iEvent));
+    const EventOutput& output = fEventOutput[iEvent];
+    TClonesArray* clusters = fWorkspaces[output.fThread]->fClusters;
+    for (Int_t iCluster = 0; iCluster < output.fNofClusters; iCluster++) {
+      Int_t index = output.fClusterOffset + iCluster;
+      CbmStsCluster* cluster =
+          static_cast<CbmStsCluster*>(fClusters->UncheckedAt(index));
+      *cluster = *static_cast<CbmStsCluster*>
+        (clusters->UncheckedAt(output.fFirstCluster + iCluster));
+      event->AddData(kStsCluster, index);
+    } //# clusters in event
+  } //# events
+  fTimer.Stop();
+  Double_t time2 = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kOutput, time2);
+
+  // --- Counters
+  Double_t realTime = time1 + time2;
+  fNofEvents       += nEvents;
+  fNofDigis        += nDigis;
+  fNofDigisUsed    += nGood;
+  fNofDigisIgnored += nDigis - nGood;
+  fNofClusters     += nClusters;
+  fTimeTot         += realTime;
+
+  // --- Screen output
+  LOG(info) << setw(20) << left << GetName() << ": " << "Time-slice "
+      << right << setw(6) << fNofTimeslices << ", events " << nEvents
+      << ", real time " << fixed << setprecision(6) << realTime
+      << " s (process " << time1 << " s, output " << time2
+      << " s), digis used: " << nGood << ", ignored: " << nDigis - nGood
+      << ", clusters: " << nClusters;
+
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Process one digi object   ---------------------------------------
 Bool_t CbmStsFindClusters::ProcessDigi(Int_t index) {
 
   // --- Get the digi object
   const CbmStsDigi* digi = fDigiManager->Get<CbmStsDigi>(index);
   assert(digi);
-  UInt_t moduleAddress = CbmStsAddress::GetMotherAddress(digi->GetAddress(),
-																												 kStsModule);
+  Int_t iModule = fSetup->GetModuleIndex(digi->GetAddress());
 
   // --- Get the cluster finder module
-  assert( fModules.count(moduleAddress) );
-  CbmStsClusterFinderModule* module = fModules[moduleAddress];
+  assert( iModule >= 0 );
+  CbmStsClusterFinderModule* module = fModuleIndex[iModule];
   assert(module);
 
   // --- Digi channel
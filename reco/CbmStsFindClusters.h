@@ -7,9 +7,13 @@
 #ifndef CBMSTSFINDCLUSTERS_H
 #define CBMSTSFINDCLUSTERS_H 1
 
+#include <map>
+#include <string>
+#include <vector>
 #include "TStopwatch.h"
 #include "FairTask.h"
 #include "CbmStsReco.h"
+#include "CbmStsRecoTiming.h"
 
 class TClonesArray;
 class CbmDigiManager;
@@ -32,6 +36,10 @@ class CbmStsSetup;
  **
  ** The task can operate both on time-slice and event input.
  ** Use SetEventMode() to choose event-by-event operation.
+ ** In event mode, each event is processed in a workspace covering only
+ ** the modules touched by the event. With SetParallelism(), the events
+ ** are processed concurrently, one workspace per thread. The output is
+ ** appended to the output array in event order.
  **
  ** The actual cluster finding algorithm is defined in the class
  ** CbmStsClusterFinderModule.
@@ -112,10 +120,32 @@ class CbmStsFindClusters : public FairTask
     void SetMode(ECbmMode mode) { fMode = mode; }
 
 
+    /** @brief Enable parallel processing of events (OpenMP)
+     ** @param choice  If true, events are processed concurrently
+     **
+     ** Only effective in event mode. The output is the same as for
+     ** serial processing.
+     **/
+    void SetParallelism(Bool_t choice = kTRUE) {
+      fParallelism_enabled = choice;
+    }
+
+
     /** @brief Define the needed parameter containers **/
     virtual void SetParContainers();
 
 
+    /** @brief Set the file for the timing summary
+     ** @param fileName  Output file (CSV if ending with ".csv", else JSON)
+     **
+     ** If set, the execution times per stage (reset, cluster finding,
+     ** cluster analysis, output) are written to this file at the end of
+     ** the run; in the event-parallel mode, cluster finding and analysis
+     ** are also recorded per thread.
+     **/
+    void SetTimingFile(const char* fileName) { fTimingFile = fileName; }
+
+
   private:
 
     TClonesArray* fEvents;            //! Input array of events
@@ -125,6 +155,8 @@ class CbmStsFindClusters : public FairTask
     CbmStsDigitizeParameters* fDigiPar; //! digi parameters
     CbmStsClusterAnalysis* fAna;      //! Instance of Cluster Analysis tool
     TStopwatch    fTimer;             //! ROOT timer
+    CbmStsRecoTiming fTiming;         //! Time per stage and thread
+    std::string fTimingFile;          ///< Output file for timing summary
     ECbmMode fMode;                   ///< Time-slice or event
     Double_t fTimeCutInSigma;         ///< Multiple of error of time difference
     Double_t fTimeCut;                ///< User-set maximum time difference
@@ -141,6 +173,39 @@ class CbmStsFindClusters : public FairTask
     // --- Map from module address to cluster finding module
     std::map<Int_t, CbmStsClusterFinderModule*> fModules;  //!
 
+    // --- Cluster finding modules, indexed like the modules in CbmStsSetup
+    std::vector<CbmStsClusterFinderModule*> fModuleIndex;  //!
+
+    // --- Event-parallel processing
+    Bool_t fParallelism_enabled;      ///< Process events concurrently
+    /** Per-thread workspace for the processing of events **/
+    struct EventWorkspace {
+      std::vector<CbmStsClusterFinderModule*> fModules; ///< Module -> workspace module (created on first use)
+      std::vector<Int_t> fTouched;       ///< Modules with digis in current event
+      std::vector<Bool_t> fIsTouched;    ///< Module -> touched by current event
+      TClonesArray* fClusters = nullptr; ///< Clusters of all events of this thread
+    };
+    /** Output of one event in its workspace and in the output array **/
+    struct EventOutput {
+      Int_t fThread = 0;         ///< Thread (workspace) the event was processed in
+      Int_t fNofDigis = 0;       ///< Number of digis in event
+      Int_t fNofGood = 0;        ///< Number of used digis
+      Int_t fFirstCluster = 0;   ///< First cluster in workspace
+      Int_t fNofClusters = 0;    ///< Number of clusters
+      Int_t fClusterOffset = 0;  ///< First cluster in output array
+    };
+    std::vector<EventWorkspace*> fWorkspaces;    //! One per thread
+    std::vector<EventOutput> fEventOutput;       //! One per event
+
+
+    /** @brief Instantiate a cluster finding module
+     ** @param iModule  Index of module in the setup
+     ** @param output   Output array for clusters
+     ** @value Pointer to new cluster finding module
+     **/
+    CbmStsClusterFinderModule* CreateModule(Int_t iModule,
+                                            TClonesArray* output);
+
 
     /** @brief Instantiate cluster finding modules
      ** @value Number of modules created
@@ -164,6 +229,26 @@ class CbmStsFindClusters : public FairTask
     void ProcessData(CbmEvent* event = NULL);
 
 
+    /** @brief Process one event in a workspace
+     ** @param event      Pointer to CbmEvent object
+     ** @param workspace  Workspace of the calling thread
+     ** @param output     Bookkeeping of the event output
+     **
+     ** Only the modules touched by the event are reset and processed.
+     ** The clusters are appended to the workspace array and analysed.
+     **/
+    void ProcessEvent(CbmEvent* event, EventWorkspace& workspace,
+                      EventOutput& output);
+
+
+    /** @brief Process all events of the time slice
+     **
+     ** The events are processed concurrently if parallelism is enabled.
+     ** Their clusters are then appended in event order to the output array.
+     **/
+    void ProcessEvents();
+
+
     /** @brief Process one STS digi
      ** @param index  Index of STS digi in its TClonesArray
      **/
@@ -8,6 +8,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <omp.h>
 #include "TClonesArray.h"
 #include "FairEventHeader.h"
 #include "FairRunAna.h"
@@ -25,6 +26,9 @@ CbmStsFindHits::CbmStsFindHits(ECbmMode mode)
     , fHits(nullptr)
     , fSetup(nullptr)
     , fTimer()
+    , fTiming()
+    , fHitContext()
+    , fTimingFile()
     , fMode(mode)
     , fTimeCutInSigma(4.)
     , fTimeCutInNs(-1.)
@@ -70,6 +74,7 @@ void CbmStsFindHits::Exec(Option_t*) {
     } //# events
   } //? event mode
 
+  fTiming.EndSlice();
   fNofTimeslices++;
 
 }
@@ -108,6 +113,17 @@ void CbmStsFindHits::Finish() {
         << fTimeTot / Double_t(fNofEvents) << " s ";
   } //? event mode
 
+  const CbmStsClusterPairing& pairing = fHitContext.GetPairing();
+  LOG(info) << "Cluster pairs         : " << pairing.GetNofPairsTested()
+      << " tested, " << pairing.GetNofPairsAccepted() << " accepted (of "
+      << pairing.GetNofPairsTotal() << ")";
+  LOG(info) << "Stage timing          : \n" << fTiming.ToString();
+  if ( ! fTimingFile.empty() ) {
+    if ( fTiming.Write(fTimingFile, GetName()) )
+      LOG(info) << "Timing summary written to " << fTimingFile;
+    else LOG(error) << GetName() << ": Cannot write timing summary to "
+        << fTimingFile;
+  }
   LOG(info) << "=====================================";
 
 }
@@ -156,6 +172,11 @@ InitStatus CbmStsFindHits::Init() {
   assert(fSetup->IsModulesInit());
   assert(fSetup->IsSensorsInit());
 
+  // --- Timing per module
+  fTiming.Init(fSetup->GetNofModules(), 1);
+  for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++)
+    fTiming.SetModuleName(iModule, fSetup->GetModule(iModule)->GetName());
+
   LOG(info) << GetName() << ": Initialisation successful";
   LOG(info) << "==========================================================";
 
@@ -179,6 +200,7 @@ Int_t CbmStsFindHits::ProcessData(CbmEvent* event) {
   }
   fTimer.Stop();
   Double_t timeClear = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kReset, timeClear);
   LOG(debug) << GetName() << ": Cleared clusters in " << nModules
       << " modules. ";
 
@@ -187,16 +209,21 @@ Int_t CbmStsFindHits::ProcessData(CbmEvent* event) {
   Int_t nClusters = SortClusters(event);
   fTimer.Stop();
   Double_t timeSort = fTimer.RealTime();
+  fTiming.AddTime(CbmStsRecoTiming::kDistribute, timeSort);
 
   // --- Find hits in modules
   fTimer.Start();
   Int_t nHits = 0;
+  fHitContext.SetOutput(fHits, event);
   for (Int_t iModule = 0; iModule < fSetup->GetNofModules(); iModule++) {
     CbmStsModule* module = fSetup->GetModule(iModule);
     if ( module->GetNofClusters() == 0 ) continue;
+    Double_t tModule = omp_get_wtime();
     module->SortClustersByTime();  //Added time-sorting, DigisToHits
-    Int_t nHitsModule = module->FindHits(fHits, event,
-																				 fTimeCutInNs, fTimeCutInSigma);
+    Int_t nHitsModule = module->FindHits(fHitContext, fTimeCutInNs,
+                                         fTimeCutInSigma);
+    fTiming.AddTime(0, CbmStsRecoTiming::kHitFind,
+                    omp_get_wtime() - tModule, iModule);
     LOG(debug1) << GetName() << ": Module " << module->GetName()
          << ", clusters: " << module->GetNofClusters()
          << ", hits: " << nHitsModule;
@@ -246,8 +273,7 @@ Int_t CbmStsFindHits::SortClusters(CbmEvent* event) {
     assert(cluster);
     UInt_t address = cluster->GetAddress();
     cluster->SetIndex(index);
-    CbmStsModule* module =
-        static_cast<CbmStsModule*>(fSetup->GetElement(address, kStsModule));
+    CbmStsModule* module = fSetup->GetModule(fSetup->GetModuleIndex(address));
 
     // --- Assign cluster to module
     module->AddCluster(cluster);
@@ -8,10 +8,13 @@
 #define CBMSTSFINDHITS_H 1
 
 #include <set>
+#include <string>
 #include "TStopwatch.h"
 #include "FairTask.h"
+#include "CbmStsHitContext.h"
 #include "CbmStsModule.h"
 #include "CbmStsReco.h"
+#include "CbmStsRecoTiming.h"
 
 class TClonesArray;
 class CbmEvent;
@@ -95,6 +98,16 @@ class CbmStsFindHits : public FairTask
     void SetTimeCutInSigma(Double_t value) { fTimeCutInSigma = value; }
 
 
+    /** @brief Set the file for the timing summary
+     ** @param fileName  Output file (CSV if ending with ".csv", else JSON)
+     **
+     ** If set, the execution times per stage (reset, distribution, hit
+     ** finding) are written to this file at the end of the run; the hit
+     ** finding is also recorded per module.
+     **/
+    void SetTimingFile(const char* fileName) { fTimingFile = fileName; }
+
+
   private:
 
     TClonesArray* fEvents;        ///< Input array of CbmEvent
@@ -102,6 +115,9 @@ class CbmStsFindHits : public FairTask
     TClonesArray* fHits;          ///< Output array of CbmStsHits
     CbmStsSetup*  fSetup;         ///< Instance of STS setup
     TStopwatch    fTimer;         ///< ROOT timer
+    CbmStsRecoTiming fTiming;     //! Time per stage and module
+    CbmStsHitContext fHitContext; //! Output and work space of hit finding
+    std::string fTimingFile;      ///< Output file for timing summary
     ECbmMode fMode;               ///< Mode (time-slice or event)
     Double_t fTimeCutInSigma;     ///< Max. cluster timer difference in sigma
     Double_t fTimeCutInNs;        ///< Max. cluster timer difference in ns
@@ -165,8 +165,7 @@ Int_t CbmStsFindHitsSingleCluster::SortClusters() {
 		CbmStsCluster* cluster = static_cast<CbmStsCluster*> (fClusters->At(iCluster));
 		UInt_t address = cluster->GetAddress();
 		cluster->SetIndex(iCluster);
-		CbmStsModule* module =
-				static_cast<CbmStsModule*>(fSetup->GetElement(address, kStsModule));
+		CbmStsModule* module = fSetup->GetModule(fSetup->GetModuleIndex(address));
 
 	  // --- Update set of active modules
 		fActiveModules.insert(module);
@@ -0,0 +1,178 @@
+/** @file CbmStsModuleScheduler.cxx
+ **/
+
+#include "CbmStsModuleScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <sstream>
+
+
+// -----   Constructor   ---------------------------------------------------
+CbmStsModuleScheduler::CbmStsModuleScheduler()
+  : fNofQueues(0)
+  , fOrder()
+  , fQueueStart()
+  , fSorted()
+  , fQueueLoad()
+  , fQueueSize()
+  , fRange()
+  , fRangeSize(0)
+  , fBusyTime()
+  , fNofStolen()
+  , fWallTime(0.)
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add busy time of a thread   -------------------------------------
+void CbmStsModuleScheduler::AddBusyTime(Int_t thread, Double_t time) {
+  assert( thread >= 0 && thread < Int_t(fBusyTime.size()) );
+  fBusyTime[thread] += time;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Next module for a thread   --------------------------------------
+Int_t CbmStsModuleScheduler::Next(Int_t thread) {
+  assert( thread >= 0 && thread < fNofQueues );
+
+  // --- Own queue: take from the front
+  std::atomic<ULong64_t>& range = fRange[thread];
+  ULong64_t current = range.load(std::memory_order_relaxed);
+  while ( kTRUE ) {
+    UInt_t front = UInt_t(current);
+    UInt_t back  = UInt_t(current >> 32);
+    if ( front >= back ) break;
+    if ( range.compare_exchange_weak(current, current + 1,
+                                     std::memory_order_relaxed) )
+      return fOrder[fQueueStart[thread] + front];
+  }
+
+  // --- Own queue empty: steal from the others
+  for (Int_t offset = 1; offset < fNofQueues; offset++) {
+    Int_t module = Steal( (thread + offset) % fNofQueues );
+    if ( module >= 0 ) {
+      fNofStolen[thread]++;
+      return module;
+    }
+  }
+
+  return -1;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Reset statistics   ----------------------------------------------
+void CbmStsModuleScheduler::ResetStatistics() {
+  std::fill(fBusyTime.begin(), fBusyTime.end(), 0.);
+  std::fill(fNofStolen.begin(), fNofStolen.end(), 0);
+  fWallTime = 0.;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Distribute modules to queues   ----------------------------------
+void CbmStsModuleScheduler::Schedule(const std::vector<Int_t>& load,
+                                     Int_t nThreads) {
+  assert( nThreads > 0 );
+  Int_t nModules = load.size();
+  fNofQueues = nThreads;
+
+  // --- Longest processing time first. Ties are resolved by the module
+  // --- index, such that the schedule is reproducible.
+  fSorted.resize(nModules);
+  for (Int_t iModule = 0; iModule < nModules; iModule++)
+    fSorted[iModule] = iModule;
+  std::sort(fSorted.begin(), fSorted.end(),
+            [&load] (Int_t module1, Int_t module2) {
+              return ( load[module1] != load[module2] ?
+                       load[module1] > load[module2] : module1 < module2 );
+            });
+
+  // --- Deal each module to the queue with the smallest total load.
+  // --- Within each queue, modules stay in LPT order.
+  fQueueLoad.assign(nThreads, 0);
+  fQueueSize.assign(nThreads, 0);
+  std::vector<Int_t> queueOfModule(nModules);
+  for (Int_t module : fSorted) {
+    Int_t queue = std::min_element(fQueueLoad.begin(), fQueueLoad.end())
+                  - fQueueLoad.begin();
+    queueOfModule[module] = queue;
+    fQueueLoad[queue] += load[module];
+    fQueueSize[queue]++;
+  } //# modules
+
+  // --- Fill the queues
+  fQueueStart.resize(nThreads + 1);
+  fQueueStart[0] = 0;
+  for (Int_t queue = 0; queue < nThreads; queue++)
+    fQueueStart[queue + 1] = fQueueStart[queue] + fQueueSize[queue];
+  fOrder.resize(nModules);
+  std::vector<Int_t> position(fQueueStart.begin(), fQueueStart.end() - 1);
+  for (Int_t module : fSorted)
+    fOrder[ position[queueOfModule[module]]++ ] = module;
+
+  // --- Queue ranges
+  if ( fRangeSize < nThreads ) {
+    fRange.reset(new std::atomic<ULong64_t>[nThreads]);
+    fRangeSize = nThreads;
+  }
+  for (Int_t queue = 0; queue < nThreads; queue++)
+    fRange[queue].store(ULong64_t(fQueueSize[queue]) << 32,
+                        std::memory_order_relaxed);
+
+  // --- Statistics per thread
+  if ( Int_t(fBusyTime.size()) < nThreads ) {
+    fBusyTime.resize(nThreads, 0.);
+    fNofStolen.resize(nThreads, 0);
+  }
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Take a module from the back of a queue   ------------------------
+Int_t CbmStsModuleScheduler::Steal(Int_t queue) {
+
+  std::atomic<ULong64_t>& range = fRange[queue];
+  ULong64_t current = range.load(std::memory_order_relaxed);
+  while ( kTRUE ) {
+    UInt_t front = UInt_t(current);
+    UInt_t back  = UInt_t(current >> 32);
+    if ( front >= back ) return -1;
+    ULong64_t next = ( ULong64_t(back - 1) << 32 ) | front;
+    if ( range.compare_exchange_weak(current, next,
+                                     std::memory_order_relaxed) )
+      return fOrder[fQueueStart[queue] + back - 1];
+  }
+
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Summary of the load balance   -----------------------------------
+std::string CbmStsModuleScheduler::ToString() const {
+  std::stringstream ss;
+  ss << "Wall time " << std::fixed << std::setprecision(6) << fWallTime
+      << " s";
+  for (Int_t thread = 0; thread < GetNofThreads(); thread++) {
+    Double_t busy = GetBusyTime(thread);
+    ss << "\n  Thread " << std::setw(3) << thread << ": busy "
+        << std::setprecision(6) << busy << " s, idle "
+        << GetIdleTime(thread) << " s ("
+        << std::setprecision(1)
+        << ( fWallTime > 0. ? 100. * busy / fWallTime : 0. )
+        << " % busy), stolen modules " << fNofStolen[thread];
+  }
+  return ss.str();
+}
+// -------------------------------------------------------------------------
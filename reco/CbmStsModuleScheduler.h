@@ -0,0 +1,155 @@
+/** @file CbmStsModuleScheduler.h
+ **/
+
+#ifndef CBMSTSMODULESCHEDULER_H
+#define CBMSTSMODULESCHEDULER_H 1
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Rtypes.h"
+
+
+/** @class CbmStsModuleScheduler
+ ** @brief Load-balancing distribution of per-module work to threads
+ **
+ ** The modules of the STS carry very different loads: inner modules
+ ** receive orders of magnitude more digis than outer ones. With a static
+ ** distribution of modules to threads, most threads are idle at the
+ ** end of each time slice.
+ **
+ ** Before each parallel section, the modules are ordered by their load
+ ** (longest processing time first) and dealt to per-thread queues, each
+ ** module to the queue with the currently smallest total load. During
+ ** the parallel section, each thread takes modules from the front of its
+ ** own queue (largest first). A thread with an empty queue steals from
+ ** the back of the queues of the other threads. The queues are lock-free;
+ ** the front and back positions of each queue are packed into one atomic
+ ** word.
+ **
+ ** The busy time of each thread and the wall time of the parallel
+ ** sections are accumulated, such that the load balance can be checked.
+ **/
+class CbmStsModuleScheduler
+{
+
+  public:
+
+    /** @brief Constructor **/
+    CbmStsModuleScheduler();
+
+
+    /** @brief Destructor **/
+    virtual ~CbmStsModuleScheduler() { };
+
+
+    /** @brief Add busy time of a thread
+     ** @param thread  Thread number
+     ** @param time    Time spent in processing modules [s]
+     **/
+    void AddBusyTime(Int_t thread, Double_t time);
+
+
+    /** @brief Add wall time of a parallel section
+     ** @param time  Wall time of the parallel section [s]
+     **/
+    void AddWallTime(Double_t time) { fWallTime += time; }
+
+
+    /** @brief Busy time of a thread
+     ** @param thread  Thread number
+     ** @value Accumulated busy time [s]
+     **/
+    Double_t GetBusyTime(Int_t thread) const {
+      return ( thread < Int_t(fBusyTime.size()) ? fBusyTime[thread] : 0. );
+    }
+
+
+    /** @brief Idle time of a thread
+     ** @param thread  Thread number
+     ** @value Accumulated wall time minus busy time [s]
+     **/
+    Double_t GetIdleTime(Int_t thread) const {
+      return fWallTime - GetBusyTime(thread);
+    }
+
+
+    /** @brief Number of modules stolen by a thread
+     ** @param thread  Thread number
+     ** @value Accumulated number of modules taken from other queues
+     **/
+    Long64_t GetNofStolen(Int_t thread) const {
+      return ( thread < Int_t(fNofStolen.size()) ? fNofStolen[thread] : 0 );
+    }
+
+
+    /** @brief Number of threads seen so far **/
+    Int_t GetNofThreads() const { return fBusyTime.size(); }
+
+
+    /** @brief Next module for a thread
+     ** @param thread  Thread number
+     ** @value Module index; -1 if no work is left
+     **
+     ** Thread-safe. The own queue is served first; then the other
+     ** queues are scanned for work to steal.
+     **/
+    Int_t Next(Int_t thread);
+
+
+    /** @brief Reset the accumulated timing statistics **/
+    void ResetStatistics();
+
+
+    /** @brief Distribute modules to thread queues
+     ** @param load      Load (e.g. number of digis) per module
+     ** @param nThreads  Number of threads
+     **
+     ** Must be called outside of parallel sections. The calling threads
+     ** in the following parallel section must be numbered below nThreads.
+     **/
+    void Schedule(const std::vector<Int_t>& load, Int_t nThreads);
+
+
+    /** @brief Summary of the load balance (one line per thread) **/
+    std::string ToString() const;
+
+
+  private:
+
+    Int_t fNofQueues;                   ///< Number of thread queues
+    std::vector<Int_t> fOrder;          ///< Modules, grouped by queue
+    std::vector<Int_t> fQueueStart;     ///< Queue -> first entry in fOrder
+    std::vector<Int_t> fSorted;         ///< Modules in LPT order
+    std::vector<Long64_t> fQueueLoad;   ///< Total load per queue
+    std::vector<Int_t> fQueueSize;      ///< Number of modules per queue
+
+    /** Front (lower 32 bits) and back (upper 32 bits) position of
+     ** each queue relative to its start in fOrder **/
+    std::unique_ptr<std::atomic<ULong64_t>[]> fRange;
+    Int_t fRangeSize;                   ///< Allocated size of fRange
+
+    // --- Statistics
+    std::vector<Double_t> fBusyTime;    ///< Busy time per thread [s]
+    std::vector<Long64_t> fNofStolen;   ///< Stolen modules per thread
+    Double_t fWallTime;                 ///< Wall time of parallel sections [s]
+
+
+    /** @brief Take a module from the back of a foreign queue
+     ** @param queue  Queue number
+     ** @value Module index; -1 if the queue is empty
+     **/
+    Int_t Steal(Int_t queue);
+
+
+    /** @brief Copy constructor (forbidden) **/
+    CbmStsModuleScheduler(const CbmStsModuleScheduler&) = delete;
+
+
+    /** @brief Assignment operator (forbidden) **/
+    CbmStsModuleScheduler& operator=(const CbmStsModuleScheduler&) = delete;
+
+};
+
+#endif
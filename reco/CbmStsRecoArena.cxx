@@ -0,0 +1,109 @@
+/** @file CbmStsRecoArena.cxx
+ **/
+
+#include "CbmStsRecoArena.h"
+
+#include <algorithm>
+#include <cassert>
+#include "TClonesArray.h"
+#include "CbmStsCluster.h"
+#include "CbmStsHit.h"
+
+
+// -----   Constructor   ---------------------------------------------------
+CbmStsRecoArena::CbmStsRecoArena()
+  : fClusters(new TClonesArray("CbmStsCluster", 1000))
+  , fHits(new TClonesArray("CbmStsHit", 1000))
+  , fNofClusters(0)
+  , fNofClusterSlots(0)
+  , fNofHitSlots(0)
+  , fBytesNew(0)
+  , fBytesReused(0)
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Destructor   ----------------------------------------------------
+CbmStsRecoArena::~CbmStsRecoArena() {
+  fClusters->Delete();
+  fHits->Delete();
+  delete fClusters;
+  delete fHits;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Access to a cluster   -------------------------------------------
+CbmStsCluster* CbmStsRecoArena::GetCluster(Int_t index) const {
+  assert( index >= 0 && index < fNofClusters );
+  return static_cast<CbmStsCluster*>(fClusters->UncheckedAt(index));
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Access to a hit   -----------------------------------------------
+CbmStsHit* CbmStsRecoArena::GetHit(Int_t index) const {
+  assert( index >= 0 && index < GetNofHits() );
+  return static_cast<CbmStsHit*>(fHits->UncheckedAt(index));
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Number of hits   ------------------------------------------------
+Int_t CbmStsRecoArena::GetNofHits() const {
+  return fHits->GetEntriesFast();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Create a cluster   ----------------------------------------------
+CbmStsCluster* CbmStsRecoArena::NewCluster(const std::vector<Int_t>& digis) {
+
+  // --- ConstructedAt returns the old object if the slot was used before;
+  // --- its digi list keeps its storage when cleared.
+  Bool_t isReused = ( fNofClusters < fNofClusterSlots );
+  CbmStsCluster* cluster =
+      static_cast<CbmStsCluster*>(fClusters->ConstructedAt(fNofClusters++));
+  if ( ! isReused ) fNofClusterSlots = fNofClusters;
+  cluster->ClearDigis();
+  Long64_t capacity = cluster->GetDigis().capacity();
+  cluster->AddDigis(digis);
+
+  // --- Statistics
+  Long64_t nDigis = digis.size();
+  Long64_t growth = cluster->GetDigis().capacity() - capacity;
+  if ( isReused ) fBytesReused += sizeof(CbmStsCluster);
+  else            fBytesNew    += sizeof(CbmStsCluster);
+  fBytesReused += std::min(capacity, nDigis) * sizeof(Int_t);
+  fBytesNew    += growth * sizeof(Int_t);
+
+  return cluster;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Reset   ---------------------------------------------------------
+void CbmStsRecoArena::Reset() {
+
+  // --- Hit statistics: slots beyond the previous maximum are new
+  Int_t nHits = fHits->GetEntriesFast();
+  fBytesReused += Long64_t(std::min(nHits, fNofHitSlots)) * sizeof(CbmStsHit);
+  if ( nHits > fNofHitSlots ) {
+    fBytesNew += Long64_t(nHits - fNofHitSlots) * sizeof(CbmStsHit);
+    fNofHitSlots = nHits;
+  }
+
+  // --- Clear without destructing the objects
+  fClusters->Clear();
+  fHits->Clear();
+  fNofClusters = 0;
+
+}
+// -------------------------------------------------------------------------
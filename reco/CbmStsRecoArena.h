@@ -0,0 +1,116 @@
+/** @file CbmStsRecoArena.h
+ **/
+
+#ifndef CBMSTSRECOARENA_H
+#define CBMSTSRECOARENA_H 1
+
+#include <vector>
+#include "Rtypes.h"
+
+class TClonesArray;
+class CbmStsCluster;
+class CbmStsHit;
+
+
+/** @class CbmStsRecoArena
+ ** @brief Reusable storage for clusters and hits of one thread
+ **
+ ** The arena holds the cluster and hit objects created by the reco
+ ** modules processed by one thread. The objects live in slabs
+ ** (TClonesArrays) which are reset, but not freed, at the start of each
+ ** time slice. Clusters are reused as they are, including the storage of
+ ** their digi index lists; hits are re-constructed in their slots.
+ ** After the first few time slices, no heap allocation is needed.
+ **
+ ** The number of bytes served from reused storage and from newly
+ ** allocated storage is counted.
+ **
+ ** The arena is not thread-safe; each thread must use its own.
+ **/
+class CbmStsRecoArena
+{
+
+  public:
+
+    /** @brief Constructor **/
+    CbmStsRecoArena();
+
+
+    /** @brief Destructor **/
+    virtual ~CbmStsRecoArena();
+
+
+    /** @brief Bytes taken from newly allocated storage (accumulated) **/
+    Long64_t GetBytesNew() const { return fBytesNew; }
+
+
+    /** @brief Bytes taken from reused storage (accumulated) **/
+    Long64_t GetBytesReused() const { return fBytesReused; }
+
+
+    /** @brief Access to a cluster
+     ** @param index  Index of cluster in the arena
+     **/
+    CbmStsCluster* GetCluster(Int_t index) const;
+
+
+    /** @brief Access to a hit
+     ** @param index  Index of hit in the arena
+     **/
+    CbmStsHit* GetHit(Int_t index) const;
+
+
+    /** @brief Array of hits
+     **
+     ** Hits are created in this array by the hit finder (sensor).
+     **/
+    TClonesArray* GetHits() const { return fHits; }
+
+
+    /** @brief Number of clusters since the last reset **/
+    Int_t GetNofClusters() const { return fNofClusters; }
+
+
+    /** @brief Number of hits since the last reset **/
+    Int_t GetNofHits() const;
+
+
+    /** @brief Create a cluster
+     ** @param digis  Indices of the digis in the cluster
+     ** @return Pointer to cluster object, with the digis set
+     **
+     ** All other cluster properties have to be set by the caller.
+     ** The index of the new cluster is GetNofClusters() - 1.
+     **/
+    CbmStsCluster* NewCluster(const std::vector<Int_t>& digis);
+
+
+    /** @brief Reset the arena
+     **
+     ** The objects are kept for reuse. The hit statistics of the
+     ** finished period is added to the byte counters.
+     **/
+    void Reset();
+
+
+  private:
+
+    TClonesArray* fClusters;   ///< Cluster slab
+    TClonesArray* fHits;       ///< Hit slab
+    Int_t fNofClusters;        ///< Clusters since last reset
+    Int_t fNofClusterSlots;    ///< Constructed cluster objects
+    Int_t fNofHitSlots;        ///< Allocated hit slots
+    Long64_t fBytesNew;        ///< Bytes from new storage
+    Long64_t fBytesReused;     ///< Bytes from reused storage
+
+
+    /** @brief Copy constructor (forbidden) **/
+    CbmStsRecoArena(const CbmStsRecoArena&) = delete;
+
+
+    /** @brief Assignment operator (forbidden) **/
+    CbmStsRecoArena& operator=(const CbmStsRecoArena&) = delete;
+
+};
+
+#endif
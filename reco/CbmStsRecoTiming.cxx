@@ -0,0 +1,346 @@
+/** @file CbmStsRecoTiming.cxx
+ **/
+
+#include "CbmStsRecoTiming.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+const Int_t CbmStsRecoTiming::fgkBinsPerDecade;
+const Int_t CbmStsRecoTiming::fgkNofBins;
+
+
+// -----   Constructor   ---------------------------------------------------
+CbmStsRecoTiming::CbmStsRecoTiming()
+  : fNofModules(0)
+  , fThreads()
+  , fModuleNames()
+  , fSliceStats()
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Destructor   ----------------------------------------------------
+CbmStsRecoTiming::~CbmStsRecoTiming() {
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add one sample to the statistics   ------------------------------
+void CbmStsRecoTiming::Stats::Add(Double_t time) {
+  fCalls++;
+  fTotal += time;
+  fMax = std::max(fMax, time);
+  fHist[GetBin(time)]++;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Merge statistics   ----------------------------------------------
+void CbmStsRecoTiming::Stats::Merge(const Stats& other) {
+  fCalls += other.fCalls;
+  fTotal += other.fTotal;
+  fMax = std::max(fMax, other.fMax);
+  for (Int_t bin = 0; bin < fgkNofBins; bin++)
+    fHist[bin] += other.fHist[bin];
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add execution time   --------------------------------------------
+void CbmStsRecoTiming::AddTime(Int_t thread, EStage stage, Double_t time,
+                               Int_t module) {
+  assert( thread >= 0 && thread < Int_t(fThreads.size()) );
+  assert( stage >= 0 && stage < kNofStages );
+  ThreadData& data = *fThreads[thread];
+  data.fSlice[stage] += time;
+  data.fTotal[stage] += time;
+  if ( module < 0 ) return;
+
+  assert( module < fNofModules );
+  Int_t index = module * kNofStages + stage;
+  data.fModuleTime[index] += time;
+  data.fModuleCalls[index]++;
+  data.fModuleMax[index] = std::max(data.fModuleMax[index], time);
+  data.fModuleStats[stage].Add(time);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Close a time slice   --------------------------------------------
+void CbmStsRecoTiming::EndSlice() {
+  for (Int_t stage = 0; stage < kNofStages; stage++) {
+    Double_t time = 0.;
+    for (auto& data : fThreads) {
+      time += data->fSlice[stage];
+      data->fSlice[stage] = 0.;
+    }
+    if ( time > 0. ) fSliceStats[stage].Add(time);
+  } //# stages
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Histogram bin of a time   ---------------------------------------
+Int_t CbmStsRecoTiming::GetBin(Double_t time) {
+  if ( ! ( time >= 1.e-9 ) ) return 0;
+  Int_t bin = 1 + Int_t( fgkBinsPerDecade * ( std::log10(time) + 9. ) );
+  return std::min(bin, fgkNofBins - 1);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Merged statistics per module call   -----------------------------
+CbmStsRecoTiming::Stats CbmStsRecoTiming::GetModuleStats(Int_t stage) const {
+  Stats stats;
+  for (auto& data : fThreads) stats.Merge(data->fModuleStats[stage]);
+  return stats;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Percentile from a histogram   -----------------------------------
+Double_t CbmStsRecoTiming::GetPercentile(const Stats& stats,
+                                         Double_t fraction) {
+  if ( stats.fCalls == 0 ) return 0.;
+  Double_t target = fraction * stats.fCalls;
+  Long64_t count = 0;
+  for (Int_t bin = 0; bin < fgkNofBins; bin++) {
+    count += stats.fHist[bin];
+    if ( count < target || count == 0 ) continue;
+    if ( bin == 0 ) return std::min(1.e-9, stats.fMax);
+    if ( bin == fgkNofBins - 1 ) return stats.fMax;
+    // Geometric centre of the bin, but not above the maximum
+    Double_t centre =
+        std::pow(10., -9. + ( bin - 0.5 ) / Double_t(fgkBinsPerDecade));
+    return std::min(centre, stats.fMax);
+  }
+  return stats.fMax;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Percentile of the stage time per time slice   -------------------
+Double_t CbmStsRecoTiming::GetPercentile(EStage stage,
+                                         Double_t fraction) const {
+  assert( stage >= 0 && stage < kNofStages );
+  return GetPercentile(fSliceStats[stage], fraction);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Name of a stage   -----------------------------------------------
+const char* CbmStsRecoTiming::GetStageName(Int_t stage) {
+  switch ( stage ) {
+    case kReset:      return "reset";
+    case kDistribute: return "distribute";
+    case kCluster:    return "cluster";
+    case kAnalyse:    return "analyse";
+    case kHitFind:    return "hitfind";
+    case kOutput:     return "output";
+    default:          return "unknown";
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Total time in a stage   -----------------------------------------
+Double_t CbmStsRecoTiming::GetTotalTime(EStage stage) const {
+  assert( stage >= 0 && stage < kNofStages );
+  Double_t time = 0.;
+  for (auto& data : fThreads) time += data->fTotal[stage];
+  return time;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Prepare the storage   -------------------------------------------
+void CbmStsRecoTiming::Init(Int_t nModules, Int_t nThreads) {
+  assert( nModules >= 0 && nThreads > 0 );
+  if ( nModules > fNofModules ) {
+    fNofModules = nModules;
+    fModuleNames.resize(nModules);
+    for (auto& data : fThreads) {
+      data->fModuleTime.resize(nModules * kNofStages, 0.);
+      data->fModuleCalls.resize(nModules * kNofStages, 0);
+      data->fModuleMax.resize(nModules * kNofStages, 0.);
+    }
+  }
+  while ( Int_t(fThreads.size()) < nThreads ) {
+    std::unique_ptr<ThreadData> data(new ThreadData());
+    data->fModuleTime.assign(fNofModules * kNofStages, 0.);
+    data->fModuleCalls.assign(fNofModules * kNofStages, 0);
+    data->fModuleMax.assign(fNofModules * kNofStages, 0.);
+    fThreads.push_back(std::move(data));
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Set a module name   ---------------------------------------------
+void CbmStsRecoTiming::SetModuleName(Int_t module, const std::string& name) {
+  assert( module >= 0 && module < fNofModules );
+  fModuleNames[module] = name;
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Summary of the stage times   ------------------------------------
+std::string CbmStsRecoTiming::ToString() const {
+  std::stringstream ss;
+  ss << std::scientific << std::setprecision(3);
+  Bool_t isFirst = kTRUE;
+  for (Int_t stage = 0; stage < kNofStages; stage++) {
+    const Stats& stats = fSliceStats[stage];
+    if ( stats.fCalls == 0 ) continue;
+    if ( ! isFirst ) ss << "\n";
+    isFirst = kFALSE;
+    ss << "  " << std::left << std::setw(10) << GetStageName(stage)
+        << std::right << ": total " << stats.fTotal << " s, p50 "
+        << GetPercentile(stats, 0.50) << " s, p95 "
+        << GetPercentile(stats, 0.95) << " s, p99 "
+        << GetPercentile(stats, 0.99) << " s, max " << stats.fMax << " s";
+  } //# stages
+  return ss.str();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Write the timing summary to file   ------------------------------
+Bool_t CbmStsRecoTiming::Write(const std::string& fileName,
+                               const std::string& task) const {
+
+  std::ofstream out(fileName);
+  if ( ! out.good() ) return kFALSE;
+  out << std::setprecision(9);
+  Bool_t isCsv = ( fileName.size() >= 4
+                   && fileName.compare(fileName.size() - 4, 4, ".csv") == 0 );
+
+  // --- Per-module totals, merged over threads
+  Int_t nEntries = fNofModules * kNofStages;
+  std::vector<Double_t> moduleTime(nEntries, 0.);
+  std::vector<Long64_t> moduleCalls(nEntries, 0);
+  std::vector<Double_t> moduleMax(nEntries, 0.);
+  for (auto& data : fThreads) {
+    for (Int_t index = 0; index < nEntries; index++) {
+      moduleTime[index] += data->fModuleTime[index];
+      moduleCalls[index] += data->fModuleCalls[index];
+      moduleMax[index] = std::max(moduleMax[index], data->fModuleMax[index]);
+    }
+  }
+
+  // --- CSV: one row per (section, name, stage)
+  if ( isCsv ) {
+    out << "task,section,name,stage,calls,total,mean,p50,p95,p99,max\n";
+    for (Int_t stage = 0; stage < kNofStages; stage++) {
+      const Stats& slice = fSliceStats[stage];
+      const Stats module = GetModuleStats(stage);
+      for (const Stats* stats : { &slice, &module }) {
+        if ( stats->fCalls == 0 ) continue;
+        out << task << "," << ( stats == &slice ? "slice" : "module_call" )
+            << ",all," << GetStageName(stage) << "," << stats->fCalls << ","
+            << stats->fTotal << "," << stats->fTotal / stats->fCalls << ","
+            << GetPercentile(*stats, 0.50) << ","
+            << GetPercentile(*stats, 0.95) << ","
+            << GetPercentile(*stats, 0.99) << "," << stats->fMax << "\n";
+      }
+    } //# stages
+    for (UInt_t thread = 0; thread < fThreads.size(); thread++) {
+      for (Int_t stage = 0; stage < kNofStages; stage++) {
+        if ( fThreads[thread]->fTotal[stage] == 0. ) continue;
+        out << task << ",thread," << thread << "," << GetStageName(stage)
+            << ",," << fThreads[thread]->fTotal[stage] << ",,,,,\n";
+      }
+    } //# threads
+    for (Int_t module = 0; module < fNofModules; module++) {
+      for (Int_t stage = 0; stage < kNofStages; stage++) {
+        Int_t index = module * kNofStages + stage;
+        if ( moduleCalls[index] == 0 ) continue;
+        out << task << ",module," << fModuleNames[module] << ","
+            << GetStageName(stage) << "," << moduleCalls[index] << ","
+            << moduleTime[index] << ","
+            << moduleTime[index] / moduleCalls[index] << ",,,,"
+            << moduleMax[index] << "\n";
+      }
+    } //# modules
+    return out.good();
+  } //? CSV
+
+  // --- JSON
+  auto writeStats = [&out] (const Stats& stats) {
+    out << "{\"calls\": " << stats.fCalls << ", \"total\": " << stats.fTotal
+        << ", \"mean\": " << stats.fTotal / stats.fCalls
+        << ", \"p50\": " << GetPercentile(stats, 0.50)
+        << ", \"p95\": " << GetPercentile(stats, 0.95)
+        << ", \"p99\": " << GetPercentile(stats, 0.99)
+        << ", \"max\": " << stats.fMax << "}";
+  };
+  out << "{\n  \"task\": \"" << task << "\",\n  \"stages\": {";
+  Bool_t isFirst = kTRUE;
+  for (Int_t stage = 0; stage < kNofStages; stage++) {
+    const Stats& slice = fSliceStats[stage];
+    if ( slice.fCalls == 0 ) continue;
+    out << ( isFirst ? "\n" : ",\n" ) << "    \"" << GetStageName(stage)
+        << "\": {\"slice\": ";
+    isFirst = kFALSE;
+    writeStats(slice);
+    Stats module = GetModuleStats(stage);
+    if ( module.fCalls > 0 ) {
+      out << ", \"module_call\": ";
+      writeStats(module);
+    }
+    out << "}";
+  } //# stages
+  out << "\n  },\n  \"threads\": [";
+  for (UInt_t thread = 0; thread < fThreads.size(); thread++) {
+    out << ( thread ? ",\n" : "\n" ) << "    {";
+    for (Int_t stage = 0; stage < kNofStages; stage++)
+      out << ( stage ? ", " : "" ) << "\"" << GetStageName(stage) << "\": "
+          << fThreads[thread]->fTotal[stage];
+    out << "}";
+  } //# threads
+  out << "\n  ],\n  \"modules\": [";
+  isFirst = kTRUE;
+  for (Int_t module = 0; module < fNofModules; module++) {
+    Bool_t isActive = kFALSE;
+    for (Int_t stage = 0; stage < kNofStages; stage++)
+      if ( moduleCalls[module * kNofStages + stage] ) isActive = kTRUE;
+    if ( ! isActive ) continue;
+    out << ( isFirst ? "\n" : ",\n" ) << "    {\"index\": " << module
+        << ", \"name\": \"" << fModuleNames[module] << "\"";
+    isFirst = kFALSE;
+    for (Int_t stage = 0; stage < kNofStages; stage++) {
+      Int_t index = module * kNofStages + stage;
+      if ( moduleCalls[index] == 0 ) continue;
+      out << ", \"" << GetStageName(stage) << "\": {\"calls\": "
+          << moduleCalls[index] << ", \"total\": " << moduleTime[index]
+          << ", \"max\": " << moduleMax[index] << "}";
+    } //# stages
+    out << "}";
+  } //# modules
+  out << "\n  ]\n}\n";
+
+  return out.good();
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,170 @@
+/** @file CbmStsRecoTiming.h
+ **/
+
+#ifndef CBMSTSRECOTIMING_H
+#define CBMSTSRECOTIMING_H 1
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Rtypes.h"
+
+
+/** @class CbmStsRecoTiming
+ ** @brief Execution time per stage, module and thread of the STS reco
+ **
+ ** The reconstruction tasks report the time spent in the named stages
+ ** (reset, distribute, cluster, analyse, hit-find, output), optionally
+ ** broken down by module. The time is accumulated per module and per
+ ** thread. At the end of each time slice, EndSlice() takes one sample
+ ** per stage; for stages executed per module in parallel, this is the
+ ** sum over modules (thread time), not the wall time.
+ **
+ ** Over the run, the distributions of the stage times per time slice and
+ ** of the stage times per module call are kept in logarithmic histograms
+ ** (20 bins per decade between 1 ns and 1000 s), from which the
+ ** percentiles are obtained. Their relative precision is about 6 %.
+ **
+ ** The summary can be written to file as JSON or CSV.
+ **
+ ** AddTime may be called concurrently by different threads, provided
+ ** Init() was called with at least the number of threads before.
+ **/
+class CbmStsRecoTiming
+{
+
+  public:
+
+    /** @brief Processing stages **/
+    enum EStage {
+      kReset = 0,   ///< Reset of the modules
+      kDistribute,  ///< Distribution of the input to the modules
+      kCluster,     ///< Cluster finding
+      kAnalyse,     ///< Cluster analysis
+      kHitFind,     ///< Hit finding
+      kOutput,      ///< Filling of the output arrays
+      kNofStages
+    };
+
+
+    /** @brief Constructor **/
+    CbmStsRecoTiming();
+
+
+    /** @brief Destructor **/
+    virtual ~CbmStsRecoTiming();
+
+
+    /** @brief Add execution time
+     ** @param thread  Calling thread
+     ** @param stage   Processing stage
+     ** @param time    Execution time [s]
+     ** @param module  Module index in the setup; -1 if not per module
+     **/
+    void AddTime(Int_t thread, EStage stage, Double_t time,
+                 Int_t module = -1);
+
+
+    /** @brief Add execution time of a serial section (thread 0)
+     ** @param stage   Processing stage
+     ** @param time    Execution time [s]
+     **/
+    void AddTime(EStage stage, Double_t time) { AddTime(0, stage, time); }
+
+
+    /** @brief Close a time slice
+     **
+     ** One sample per stage with non-zero time in the time slice is taken.
+     ** Must not be called concurrently to AddTime.
+     **/
+    void EndSlice();
+
+
+    /** @brief Name of a stage **/
+    static const char* GetStageName(Int_t stage);
+
+
+    /** @brief Percentile of the stage time per time slice
+     ** @param stage     Processing stage
+     ** @param fraction  Fraction (0 to 1), e.g. 0.95
+     ** @return Time [s]
+     **/
+    Double_t GetPercentile(EStage stage, Double_t fraction) const;
+
+
+    /** @brief Total time in a stage [s] **/
+    Double_t GetTotalTime(EStage stage) const;
+
+
+    /** @brief Prepare the storage
+     ** @param nModules  Number of modules in the setup
+     ** @param nThreads  Maximal number of threads
+     **
+     ** May be called repeatedly; the storage only grows.
+     **/
+    void Init(Int_t nModules, Int_t nThreads);
+
+
+    /** @brief Set the name of a module for the output
+     ** @param module  Module index in the setup
+     ** @param name    Module name
+     **/
+    void SetModuleName(Int_t module, const std::string& name);
+
+
+    /** @brief Summary of the stage times for the log **/
+    std::string ToString() const;
+
+
+    /** @brief Write the timing summary to file
+     ** @param fileName  Output file; CSV if the name ends with ".csv",
+     **                  else JSON
+     ** @param task      Name of the reporting task
+     ** @return kFALSE if the file could not be written
+     **/
+    Bool_t Write(const std::string& fileName, const std::string& task) const;
+
+
+  private:
+
+    static const Int_t fgkBinsPerDecade = 20;   ///< Histogram resolution
+    static const Int_t fgkNofBins = 12 * 20 + 2; ///< 1 ns to 1000 s + under/overflow
+
+    /** Statistics of one stage **/
+    struct Stats {
+      Long64_t fCalls = 0;     ///< Number of samples
+      Double_t fTotal = 0.;    ///< Sum of samples [s]
+      Double_t fMax = 0.;      ///< Largest sample [s]
+      std::vector<Long64_t> fHist = std::vector<Long64_t>(fgkNofBins, 0);
+      void Add(Double_t time);
+      void Merge(const Stats& other);
+    };
+
+    /** Data filled by one thread **/
+    struct ThreadData {
+      Double_t fSlice[kNofStages] = { 0. };  ///< Time in current slice
+      Double_t fTotal[kNofStages] = { 0. };  ///< Time in the run
+      Stats fModuleStats[kNofStages];        ///< Times per module call
+      std::vector<Double_t> fModuleTime;     ///< (Module, stage) -> time
+      std::vector<Long64_t> fModuleCalls;    ///< (Module, stage) -> calls
+      std::vector<Double_t> fModuleMax;      ///< (Module, stage) -> max. time
+    };
+
+    Int_t fNofModules;                                   ///< Number of modules
+    std::vector<std::unique_ptr<ThreadData>> fThreads;  ///< Per-thread data
+    std::vector<std::string> fModuleNames;               ///< Module names
+    Stats fSliceStats[kNofStages];                       ///< Times per time slice
+
+
+    /** Histogram bin of a time **/
+    static Int_t GetBin(Double_t time);
+
+    /** Percentile from a histogram **/
+    static Double_t GetPercentile(const Stats& stats, Double_t fraction);
+
+    /** Merged per-module-call statistics of all threads **/
+    Stats GetModuleStats(Int_t stage) const;
+
+};
+
+#endif
@@ -0,0 +1,64 @@
+/** @file CbmStsHitContext.cxx
+ **/
+
+#include "CbmStsHitContext.h"
+
+#include "TClonesArray.h"
+#include "CbmEvent.h"
+
+
+// -----   Constructor without output   ------------------------------------
+CbmStsHitContext::CbmStsHitContext() :
+  fHitArray(nullptr), fHitVector(nullptr), fEvent(nullptr), fPairing(),
+  fPairFront(), fPairBack()
+{
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Constructor with TClonesArray output   --------------------------
+CbmStsHitContext::CbmStsHitContext(TClonesArray* hits, CbmEvent* event) :
+  CbmStsHitContext()
+{
+  SetOutput(hits, event);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Constructor with vector output   --------------------------------
+CbmStsHitContext::CbmStsHitContext(std::vector<CbmStsHit>* hits,
+                                   CbmEvent* event) :
+  CbmStsHitContext()
+{
+  SetOutput(hits, event);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Add a hit to the output   ---------------------------------------
+Int_t CbmStsHitContext::AddHit(Int_t address, const Double_t* position,
+                               const Double_t* error, Double_t covXY,
+                               Int_t indexF, Int_t indexB, Double_t time,
+                               Double_t timeError, Double_t du, Double_t dv) {
+
+  assert( fHitArray || fHitVector );
+  Int_t index = -1;
+  if ( fHitArray ) {
+    index = fHitArray->GetEntriesFast();
+    new ( (*fHitArray)[index] ) CbmStsHit(address, position, error, covXY,
+                                          indexF, indexB, time, timeError,
+                                          du, dv);
+  }
+  else {
+    index = fHitVector->size();
+    fHitVector->emplace_back(address, position, error, covXY, indexF, indexB,
+                             time, timeError, du, dv);
+  }
+  if ( fEvent ) fEvent->AddData(kStsHit, index);
+
+  return index;
+}
+// -------------------------------------------------------------------------
@@ -0,0 +1,142 @@
+/** @file CbmStsHitContext.h
+ **/
+
+#ifndef CBMSTSHITCONTEXT_H
+#define CBMSTSHITCONTEXT_H 1
+
+#include <cassert>
+#include <vector>
+#include "Rtypes.h"
+#include "CbmStsHit.h"
+#include "digitize/CbmStsClusterPairing.h"
+
+class TClonesArray;
+class CbmEvent;
+
+
+/** @class CbmStsHitContext
+ ** @brief Output sink and work space for the hit finding in a sensor
+ **
+ ** Holds all state of a call to CbmStsSensor::FindHits with context: the
+ ** output (a TClonesArray or a vector of hits, and optionally an event the
+ ** hits are registered to) and the work space for the pairing of front and
+ ** back clusters. The sensor itself is not modified, such that a sensor
+ ** can be processed by several threads at the same time, each with its own
+ ** context.
+ **
+ ** The work space is kept between calls, such that no allocation is
+ ** needed after the first ones. The pairing counters accumulate over all
+ ** calls with the same context.
+ **/
+class CbmStsHitContext
+{
+
+  public:
+
+    /** @brief Constructor without output **/
+    CbmStsHitContext();
+
+
+    /** @brief Constructor with TClonesArray output
+     ** @param hits   Array to store the hits in
+     ** @param event  Event to register the hits to (optional)
+     **/
+    CbmStsHitContext(TClonesArray* hits, CbmEvent* event = nullptr);
+
+
+    /** @brief Constructor with vector output
+     ** @param hits   Vector to store the hits in
+     ** @param event  Event to register the hits to (optional)
+     **/
+    CbmStsHitContext(std::vector<CbmStsHit>* hits, CbmEvent* event = nullptr);
+
+
+    /** @brief Add a hit to the output
+     ** @param address    Sensor address
+     ** @param position   Hit position in the global system [cm] (size 3)
+     ** @param error      Position errors [cm] (size 3)
+     ** @param covXY      Covariance of x and y [cm^2]
+     ** @param indexF     Index of front-side cluster
+     ** @param indexB     Index of back-side cluster
+     ** @param time       Hit time [ns]
+     ** @param timeError  Error of hit time [ns]
+     ** @param du         Error in u coordinate [cm]
+     ** @param dv         Error in v coordinate [cm]
+     ** @return Index of the hit in the output
+     **/
+    Int_t AddHit(Int_t address, const Double_t* position,
+                 const Double_t* error, Double_t covXY, Int_t indexF,
+                 Int_t indexB, Double_t time, Double_t timeError,
+                 Double_t du, Double_t dv);
+
+
+    /** @brief Edge positions of the clusters of one side [cm] **/
+    std::vector<Double_t>& GetEdgeX(Int_t side) {
+      assert( side == 0 || side == 1 );
+      return fEdgeX[side];
+    }
+
+
+    /** @brief Errors of the edge positions of one side [cm] **/
+    std::vector<Double_t>& GetEdgeError(Int_t side) {
+      assert( side == 0 || side == 1 );
+      return fEdgeError[side];
+    }
+
+
+    /** @brief Event the hits are registered to (may be null) **/
+    CbmEvent* GetEvent() const { return fEvent; }
+
+
+    /** @brief Back-cluster index of the accepted pairs **/
+    std::vector<Int_t>& GetPairBack() { return fPairBack; }
+
+
+    /** @brief Front-cluster index of the accepted pairs **/
+    std::vector<Int_t>& GetPairFront() { return fPairFront; }
+
+
+    /** @brief Pairing of front and back clusters **/
+    CbmStsClusterPairing& GetPairing() { return fPairing; }
+
+
+    /** @brief Pairing of front and back clusters (read access) **/
+    const CbmStsClusterPairing& GetPairing() const { return fPairing; }
+
+
+    /** @brief Set TClonesArray output
+     ** @param hits   Array to store the hits in
+     ** @param event  Event to register the hits to (optional)
+     **/
+    void SetOutput(TClonesArray* hits, CbmEvent* event = nullptr) {
+      fHitArray = hits;
+      fHitVector = nullptr;
+      fEvent = event;
+    }
+
+
+    /** @brief Set vector output
+     ** @param hits   Vector to store the hits in
+     ** @param event  Event to register the hits to (optional)
+     **/
+    void SetOutput(std::vector<CbmStsHit>* hits, CbmEvent* event = nullptr) {
+      fHitArray = nullptr;
+      fHitVector = hits;
+      fEvent = event;
+    }
+
+
+  private:
+
+    TClonesArray* fHitArray;                ///< Output array
+    std::vector<CbmStsHit>* fHitVector;     ///< Output vector
+    CbmEvent* fEvent;                       ///< Event for hit registration
+    CbmStsClusterPairing fPairing;          ///< Pairing of clusters
+    std::vector<Int_t> fPairFront;          ///< Accepted pairs, front index
+    std::vector<Int_t> fPairBack;           ///< Accepted pairs, back index
+    std::vector<Double_t> fEdgeX[2];        ///< Cluster edge positions [cm]
+    std::vector<Double_t> fEdgeError[2];    ///< Errors of edge positions [cm]
+
+};
+
+#endif
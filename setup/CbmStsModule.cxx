@@ -5,11 +5,13 @@
 
 #include "CbmStsModule.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include "TClonesArray.h"
 #include "TGeoManager.h"
-#include "TRandom.h"
+#include "TF1.h"
+#include "TMath.h"
 #include "TString.h"
 #include "FairLogger.h"
 #include "FairRunAna.h"
@@ -19,6 +21,7 @@
 #include "CbmStsHit.h"
 #include "CbmStsDigi.h"
 #include "CbmStsDigitize.h"
+#include "CbmStsRandom.h"
 #include "CbmStsSensorDssd.h"
 #include "CbmStsSetup.h"
 
@@ -30,8 +33,13 @@ CbmStsModule::CbmStsModule(UInt_t address, TGeoPhysicalNode* node,
         CbmStsElement(address, kStsModule, node, mother),
         fNofChannels(2048),
         fIsSet(kFALSE),
+        fParameterVersion(0),
+        fTableVersion(0),
+        fAsicTables(),
         // fDeadChannels(),
         fAnalogBuffer(),
+        fReadoutDigis(),
+        fReadoutMatches(),
         fClusters()
 {
 }
@@ -41,25 +49,6 @@ CbmStsModule::CbmStsModule(UInt_t address, TGeoPhysicalNode* node,
 
 // --- Destructor   --------------------------------------------------------
 CbmStsModule::~CbmStsModule() {
-
-  // --- Clean analog buffer
-  for (auto chanIt = fAnalogBuffer.begin(); chanIt != fAnalogBuffer.end();
-      chanIt++) {
-    for ( auto sigIt = (chanIt->second).begin(); sigIt != (chanIt->second).end();
-        sigIt++) {
-      delete (*sigIt);
-    }
-  }
-}
-// -------------------------------------------------------------------------
-
-
-
-// -----   Convert ADC channel to analogue charge (channel mean)   ---------
-Double_t CbmStsModule::AdcToCharge(UShort_t adc, UShort_t channel) {
-  auto& asic = GetAsicParameters(channel);
-  return asic.GetThreshold() + asic.GetDynRange() / Double_t(asic.GetNofAdc()) *
-      ( Double_t(adc) + 0.5 );
 }
 // -------------------------------------------------------------------------
 
@@ -83,57 +72,17 @@ void CbmStsModule::AddSignal(UShort_t channel, Double_t time,
     return;
   }
 
-  // --- If the channel is not yet active: create a new set and insert
-  // --- new signal into it.
-  if ( fAnalogBuffer.find(channel) == fAnalogBuffer.end() ) {
-    CbmStsSignal* signal = new CbmStsSignal(time, charge,
-                                            index, entry, file);
-    fAnalogBuffer[channel].insert(signal);
-    LOG(debug4) << GetName() << ": Activating channel " << channel;
-    return;
-  }  //? Channel not yet active
-
-  // --- The channel is active: there are already signals in.
-  // --- Loop over all signals in the channels and compare their time.
-  //TODO: Loop over all signals is not needed, since they are time-ordered.
-  Bool_t isMerged = kFALSE;
-  sigset::iterator it;
+  // --- Add the signal to the buffer. If it is within the dead time of
+  // --- a buffered signal, it is merged with that one.
+  // --- Current implementation of merging signals:
+  // --- Add charges, keep first signal time
+  // TODO: Check with STS electronics people on more realistic behaviour.
   auto& asic = GetAsicParameters(channel);
-  for (it = fAnalogBuffer[channel].begin();
-      it != fAnalogBuffer[channel].end(); it++) {
-
-    // Time between new and old signal smaller than dead time: merge signals
-    if ( TMath::Abs( (*it)->GetTime() - time ) < asic.GetDeadTime() ) {
-
-      // Current implementation of merging signals:
-      // Add charges, keep first signal time
-      // TODO: Check with STS electronics people on more realistic behaviour.
-      LOG(debug4) << GetName() << ": channel " << channel
-          << ", new signal at t = " << time
-          << " ns is merged with present signal at t = "
-          << (*it)->GetTime() << " ns";
-      (*it)->SetTime( TMath::Min( (*it)->GetTime(), time) );
-      (*it)->AddLink(charge, index, entry, file);
-      isMerged = kTRUE;  // mark new signal as merged
-      LOG(debug4) << "    New signal: time " << (*it)->GetTime()
-                      << ", charge " << (*it)->GetCharge()
-                      << ", number of links " << (*it)->GetMatch().GetNofLinks();
-      break;  // Merging should be necessary only for one buffer signal
-
-    } //? Time difference smaller than dead time
-
-  } // Loop over signals in buffer for this channel
-
-  // --- If signal was merged: no further action
-  if ( isMerged ) return;
-
-  // --- Arriving here, the signal did not interfere with existing ones.
-  // --- So, it is added to the analog buffer.
-  CbmStsSignal* signal = new CbmStsSignal(time, charge,
-                                          index, entry, file);
-  fAnalogBuffer[channel].insert(signal);
-  LOG(debug4) << GetName() << ": Adding signal at t = " << time
-      << " ns, charge " << charge << " in channel " << channel;
+  Bool_t isMerged = fAnalogBuffer.AddSignal(channel, time, charge, index,
+                                            entry, file, asic.GetDeadTime());
+  LOG(debug4) << GetName() << ": " << ( isMerged ? "Merging" : "Adding" )
+      << " signal at t = " << time << " ns, charge " << charge
+      << " in channel " << channel;
 
 }
 // -------------------------------------------------------------------------
@@ -146,31 +95,7 @@ void CbmStsModule::BufferStatus(Int_t& nofSignals,
                                 Double_t& timeLast) {
 
 
-  Int_t nSignals   = 0;
-  Double_t tFirst  = -1.;
-  Double_t tLast   = -1.;
-  Double_t tSignal = -1.;
-
-  // --- Loop over active channels
-  for ( auto chanIt  = fAnalogBuffer.begin();
-        chanIt != fAnalogBuffer.end(); chanIt++) {
-
-    // --- Loop over signals in channel
-    for ( auto sigIt  = (chanIt->second).begin();
-        sigIt != (chanIt->second).end(); sigIt++) {
-
-      tSignal = (*sigIt)->GetTime();
-      nSignals++;
-      tFirst = tFirst < 0. ? tSignal : TMath::Min(tFirst, tSignal);
-      tLast  = TMath::Max(tLast, tSignal);
-
-    } // signals in channel
-
-  } // channels in module
-
-  nofSignals = nSignals;
-  timeFirst  = tFirst;
-  timeLast   = tLast;
+  fAnalogBuffer.GetStatus(nofSignals, timeFirst, timeLast);
 
 }
 // -------------------------------------------------------------------------
@@ -179,19 +104,36 @@ void CbmStsModule::BufferStatus(Int_t& nofSignals,
 
 // -----   Convert analog charge to ADC channel number   -------------------
 Int_t CbmStsModule::ChargeToAdc(Double_t charge, UShort_t channel) {
-  auto& asic = GetAsicParameters(channel);
+  // --- Parameters from the asic table if up to date
+  Double_t threshold = 0.;
+  Double_t dynRange = 0.;
+  Int_t nAdc = 0;
+  if ( HasValidAsicTables() ) {
+    const AsicTable& table = fAsicTables[GetAsicIndex(channel)];
+    threshold = table.fThreshold;
+    dynRange = table.fDynRange;
+    nAdc = table.fNofAdc;
+  }
+  else {
+    auto& asic = GetAsicParameters(channel);
+    threshold = asic.GetThreshold();
+    dynRange = asic.GetDynRange();
+    nAdc = asic.GetNofAdc();
+  }
 
-  if ( charge < asic.GetThreshold() ) return -1;
-  Int_t adc = Int_t ( (charge - asic.GetThreshold()) * Double_t(asic.GetNofAdc())
-                      / asic.GetDynRange() );
-  return ( adc < asic.GetNofAdc() ? adc : asic.GetNofAdc() - 1 );
+  // The division is kept, such that the ADC values are unchanged
+  if ( charge < threshold ) return -1;
+  Int_t adc = Int_t ( (charge - threshold) * Double_t(nAdc) / dynRange );
+  return ( adc < nAdc ? adc : nAdc - 1 );
 }
 // -------------------------------------------------------------------------
 
 
 
 // -----   Digitise an analogue charge signal   ----------------------------
-void CbmStsModule::Digitize(UShort_t channel, CbmStsSignal* signal) {
+void CbmStsModule::Digitize(UShort_t channel,
+                            const CbmStsAnalogBuffer::Signal& signal,
+                            ULong64_t seed) {
 
   // --- Check channel number
   assert ( channel < fNofChannels );
@@ -199,7 +141,7 @@ void CbmStsModule::Digitize(UShort_t channel, CbmStsSignal* signal) {
   auto& asic = GetAsicParameters(channel);
 
   // --- No action if charge is below threshold
-  Double_t charge = signal->GetCharge();
+  Double_t charge = signal.fCharge;
   if ( charge < asic.GetThreshold() ) return;
 
   // --- Digitise charge
@@ -207,26 +149,24 @@ void CbmStsModule::Digitize(UShort_t channel, CbmStsSignal* signal) {
   // --- by C. Schmidt.
   UShort_t adc = (UShort_t)ChargeToAdc(charge, channel);
 
-  // --- Digitise time
-  Double_t  deltaT = gRandom->Gaus(0., asic.GetTimeResolution());
-  Long64_t dTime = Long64_t(round(signal->GetTime() + deltaT));
-
-  // --- Send the message to the digitiser task
-  LOG(debug4) << GetName() << ": charge " << signal->GetCharge()
+  // --- Digitise time. The random stream is identified by module, channel
+  // --- and signal time, such that it does not depend on the read-out order.
+  CbmStsRandom random(seed,
+                      CbmStsRandom::Stream(CbmStsRandom::kTimeStream,
+                                           fAddress, channel,
+                                           CbmStsRandom::Bits(signal.fTime)));
+  Double_t deltaT = random.Gaus(0., asic.GetTimeResolution());
+  Long64_t dTime = Long64_t(round(signal.fTime + deltaT));
+
+  // --- Store the digital signal for sending
+  LOG(debug4) << GetName() << ": charge " << signal.fCharge
                   << ", dyn. range " << asic.GetDynRange() << ", threshold "
                   << asic.GetThreshold() << ", # ADC channels "
                   << asic.GetNofAdc();
-  LOG(debug3) << GetName() << ": Sending message. Channel " << channel
-      << ", time " << dTime << ", adc " << adc;
-  CbmStsDigitize* digitiser = CbmStsSetup::Instance()->GetDigitizer();
-  if ( digitiser ) digitiser->CreateDigi(fAddress, channel, dTime, adc,
-                                         signal->GetMatch());
-
-  // --- If no digitiser task is present (debug mode): create a digi and
-  // --- add it to the digi buffer.
-  else {
-    LOG(fatal) << GetName() << ": no digitiser task present!";
-  }
+  UInt_t index = fReadoutDigis.size();
+  fReadoutDigis.push_back({channel, adc, dTime});
+  if ( fReadoutMatches.size() <= index ) fReadoutMatches.resize(index + 1);
+  fAnalogBuffer.GetMatch(signal, fReadoutMatches[index]);
   return;
 }
 // -------------------------------------------------------------------------
@@ -236,16 +176,47 @@ void CbmStsModule::Digitize(UShort_t channel, CbmStsSignal* signal) {
 // -----   Find hits   -----------------------------------------------------
 Int_t CbmStsModule::FindHits(TClonesArray* hitArray, CbmEvent* event,
                              Double_t tCutInNs, Double_t tCutInSigma) {
+  return FindHits(fClusters, hitArray, event, tCutInNs, tCutInSigma);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Find hits from external clusters   ------------------------------
+Int_t CbmStsModule::FindHits(std::vector<CbmStsCluster*>& clusters,
+                             TClonesArray* hitArray, CbmEvent* event,
+                             Double_t tCutInNs, Double_t tCutInSigma) {
 
   // --- Call FindHits method in each daughter sensor
   Int_t nHits = 0;
   for (Int_t iSensor = 0; iSensor < GetNofDaughters(); iSensor++) {
     CbmStsSensor* sensor = dynamic_cast<CbmStsSensor*>(GetDaughter(iSensor));
-    nHits += sensor->FindHits(fClusters, hitArray, event,
+    nHits += sensor->FindHits(clusters, hitArray, event,
                               tCutInNs, tCutInSigma);
   }
 
-  LOG(debug2) << GetName() << ": Clusters " << fClusters.size()
+  LOG(debug2) << GetName() << ": Clusters " << clusters.size()
+                  << ", sensors " << GetNofDaughters() << ", hits "
+                  << nHits;
+  return nHits;
+}
+// -------------------------------------------------------------------------
+
+
+// -----   Find hits from external clusters with context   -----------------
+Int_t CbmStsModule::FindHits(const std::vector<CbmStsCluster*>& clusters,
+                             CbmStsHitContext& context, Double_t tCutInNs,
+                             Double_t tCutInSigma) const {
+
+  // --- Call FindHits method in each daughter sensor
+  Int_t nHits = 0;
+  for (Int_t iSensor = 0; iSensor < GetNofDaughters(); iSensor++) {
+    const CbmStsSensor* sensor =
+        dynamic_cast<const CbmStsSensor*>(GetDaughter(iSensor));
+    nHits += sensor->FindHits(clusters, context, tCutInNs, tCutInSigma);
+  }
+
+  LOG(debug2) << GetName() << ": Clusters " << clusters.size()
                   << ", sensors " << GetNofDaughters() << ", hits "
                   << nHits;
   return nHits;
@@ -256,16 +227,27 @@ Int_t CbmStsModule::FindHits(TClonesArray* hitArray, CbmEvent* event,
 // -----   Find hits   -----------------------------------------------------
 Int_t CbmStsModule::FindHitsVector(std::vector<CbmStsHit>* hitArray, CbmEvent* event,
                              Double_t tCutInNs, Double_t tCutInSigma) {
+  return FindHitsVector(fClusters, hitArray, event, tCutInNs, tCutInSigma);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Find hits from external clusters   ------------------------------
+Int_t CbmStsModule::FindHitsVector(std::vector<CbmStsCluster*>& clusters,
+                                   std::vector<CbmStsHit>* hitArray,
+                                   CbmEvent* event,
+                                   Double_t tCutInNs, Double_t tCutInSigma) {
 
   // --- Call FindHits method in each daughter sensor
   Int_t nHits = 0;
   for (Int_t iSensor = 0; iSensor < GetNofDaughters(); iSensor++) {
     CbmStsSensor* sensor = dynamic_cast<CbmStsSensor*>(GetDaughter(iSensor));
-    nHits += sensor->FindHitsVector(fClusters, hitArray, event,
+    nHits += sensor->FindHitsVector(clusters, hitArray, event,
                               tCutInNs, tCutInSigma);
   }
 
-  LOG(debug2) << GetName() << ": Clusters " << fClusters.size()
+  LOG(debug2) << GetName() << ": Clusters " << clusters.size()
                   << ", sensors " << GetNofDaughters() << ", hits "
                   << nHits;
   return nHits;
@@ -300,22 +282,40 @@ Int_t CbmStsModule::GenerateNoise(Double_t t1, Double_t t2) {
 
   Int_t fnNoise = 0;
 
+  // --- Random stream of the module for this time interval
+  CbmStsDigitize* digitiser = CbmStsSetup::Instance()->GetDigitizer();
+  ULong64_t seed = ( digitiser ? digitiser->GetRandomSeed() : 0 );
+  CbmStsRandom random(seed,
+                      CbmStsRandom::Stream(CbmStsRandom::kNoiseStream,
+                                           fAddress, CbmStsRandom::Bits(t1)));
+
   Int_t iAsic = 0;
   for (auto& asic : fAsicParameterVector) {
-    Int_t channel = Int_t(gRandom->Uniform(Double_t(kiNbAsicChannels)));
+    Int_t channel = Int_t(random.Uniform(0., Double_t(kiNbAsicChannels)));
 
     // --- Mean number of digis in [t1, t2]
     Double_t nNoiseMean = asic.GetNoiseRate() * kiNbAsicChannels * ( t2 - t1 );
 
     // --- Sample number of noise digis
-    Int_t nNoise = gRandom->Poisson(nNoiseMean);
+    Int_t nNoise = random.Poisson(nNoiseMean);
+
+    // --- Noise charge distribution: Gaussian truncated to the range of
+    // --- the noise function, sampled by inversion of the tail integral
+    TF1* noiseCharge = asic.GetNoiseCharge();
+    Double_t qMean = noiseCharge->GetParameter(0);
+    Double_t qSigma = noiseCharge->GetParameter(1);
+    Double_t tailMin = 0.5 * TMath::Erfc( ( noiseCharge->GetXmin() - qMean )
+                                          / ( qSigma * TMath::Sqrt2() ) );
+    Double_t tailMax = 0.5 * TMath::Erfc( ( noiseCharge->GetXmax() - qMean )
+                                          / ( qSigma * TMath::Sqrt2() ) );
 
     // --- Create noise digis
     for (Int_t iNoise = 0; iNoise < nNoise; iNoise++) {
 
       // --- Random channel number, time and charge
-      Double_t time = gRandom->Uniform(t1, t2);
-      Double_t charge = asic.GetNoiseCharge()->GetRandom();
+      Double_t time = random.Uniform(t1, t2);
+      Double_t tail = tailMax + ( tailMin - tailMax ) * random.Rndm();
+      Double_t charge = qMean - qSigma * TMath::NormQuantile(tail);
 
       // --- Insert a signal object (without link index, entry and file)
       // --- into the analogue buffer.
@@ -374,10 +374,7 @@ std::set<UShort_t> CbmStsModule::GetSetOfDeadChannels() const {
 // -----  Initialise the analogue buffer   ---------------------------------
 void CbmStsModule::InitAnalogBuffer() {
 
-  for (UShort_t channel = 0; channel < fNofChannels; channel++) {
-    multiset<CbmStsSignal*, CbmStsSignal::Before> mset;
-    fAnalogBuffer[channel] = mset;
-  } // channel loop
+  fAnalogBuffer.Init(fNofChannels);
 
 }
 // -------------------------------------------------------------------------
@@ -437,6 +434,36 @@ void CbmStsModule::InitDaughters() {
 
   Int_t nAsics = fNofChannels/kiNbAsicChannels;
   fAsicParameterVector.resize(nAsics);
+  fParameterVersion++;
+  UpdateAsicTables();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Rebuild the asic tables   ---------------------------------------
+void CbmStsModule::UpdateAsicTables() {
+
+  if ( HasValidAsicTables() ) return;
+
+  fAsicTables.resize(fAsicParameterVector.size());
+  for (UInt_t iAsic = 0; iAsic < fAsicParameterVector.size(); iAsic++) {
+    const CbmStsDigitizeParameters& asic = fAsicParameterVector[iAsic];
+    AsicTable& table = fAsicTables[iAsic];
+    table.fThreshold = asic.GetThreshold();
+    table.fDynRange = asic.GetDynRange();
+    table.fNofAdc = asic.GetNofAdc();
+    table.fChargePerAdc = asic.GetDynRange() / Double_t(asic.GetNofAdc());
+    table.fNoiseSq = asic.GetNoise() * asic.GetNoise();
+    table.fDigitErrorSq = table.fChargePerAdc * table.fChargePerAdc / 12.;
+    table.fTimeResolution = asic.GetTimeResolution();
+    table.fCharge.resize(std::max(table.fNofAdc, 0));
+    for (Int_t adc = 0; adc < table.fNofAdc; adc++)
+      table.fCharge[adc] = asic.GetThreshold()
+        + asic.GetDynRange() / Double_t(asic.GetNofAdc()) * ( Double_t(adc) + 0.5 );
+  }
+  fTableVersion = fParameterVersion;
+
 }
 // -------------------------------------------------------------------------
 
@@ -444,57 +471,76 @@ void CbmStsModule::InitDaughters() {
 
 // -----   Process the analogue buffer   -----------------------------------
 Int_t CbmStsModule::ProcessAnalogBuffer(Double_t readoutTime) {
+  ReadOutAnalogBuffer(readoutTime);
+  return SendDigis();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Read out the analogue buffer   ----------------------------------
+Int_t CbmStsModule::ReadOutAnalogBuffer(Double_t readoutTime) {
 
   // --- Counter
-  Int_t nDigis = 0;
+  Int_t nSignals = 0;
 
-  // Create iterators needed for inner loop
-  sigset::iterator sigIt;;
-  sigset::iterator oldIt;
-  sigset::iterator endIt;
+  // --- Random seed for the time smearing
+  CbmStsDigitize* digitiser = CbmStsSetup::Instance()->GetDigitizer();
+  ULong64_t seed = ( digitiser ? digitiser->GetRandomSeed() : 0 );
 
-  // --- Iterate over active channels
-  for(auto& chanIt: fAnalogBuffer) {
+  // --- Iterate over channels
+  for (UShort_t channel = 0; channel < fAnalogBuffer.GetNofChannels();
+       channel++) {
 
     // Only do something if there are signals for the channel
-    if ( ! (chanIt.second).empty() ) {
-      auto& asic = GetAsicParameters(chanIt.first);
-
-      // --- Time limit up to which signals are digitised and sent to DAQ.
-      // --- Up to that limit, it is guaranteed that future signals do not
-      // --- interfere with the buffered ones. The readoutTime is the time
-      // --- of the last processed StsPoint. All coming points will be later
-      // --- in time. So, the time limit is defined by this time minus
-      // --- 5 times the time resolution (maximal deviation of signal time
-      // --- from StsPoint time) minus the dead time, within which
-      // --- interference of signals can happen.
-      Double_t timeLimit = readoutTime - 5. * asic.GetTimeResolution() - asic.GetDeadTime();
-
-      // --- Digitise all signals up to the specified time limit
-      sigIt = (chanIt.second).begin();
-      oldIt = sigIt;
-      endIt = (chanIt.second).end();
-      while ( sigIt != endIt ) {
-
-        // --- Exit loop if signal time is larger than time limit
-        // --- N.b.: Readout time < 0 means digitise everything
-        if ( readoutTime >= 0. && (*sigIt)->GetTime() > timeLimit ) break;
-
-        // --- Digitise signal
-        Digitize( chanIt.first, (*sigIt) );
-        nDigis++;
-
-        // --- Increment iterator before it becomes invalid
-        oldIt = sigIt;
-        sigIt++;
-
-        // --- Delete digitised signal
-        delete (*oldIt);
-        (chanIt.second).erase(oldIt);
-      } // Iterate over signals in channel
-    } // if there are signals
+    if ( fAnalogBuffer.GetNofSignals(channel) == 0 ) continue;
+    auto& asic = GetAsicParameters(channel);
+
+    // --- Time limit up to which signals are digitised and sent to DAQ.
+    // --- Up to that limit, it is guaranteed that future signals do not
+    // --- interfere with the buffered ones. The readoutTime is the time
+    // --- of the last processed StsPoint. All coming points will be later
+    // --- in time. So, the time limit is defined by this time minus
+    // --- 5 times the time resolution (maximal deviation of signal time
+    // --- from StsPoint time) minus the dead time, within which
+    // --- interference of signals can happen.
+    Double_t timeLimit = readoutTime - 5. * asic.GetTimeResolution() - asic.GetDeadTime();
+
+    // --- Digitise all signals up to the specified time limit and remove
+    // --- them from the buffer.
+    // --- N.b.: Readout time < 0 means digitise everything
+    nSignals += fAnalogBuffer.ReadOut(channel, readoutTime < 0., timeLimit,
+        [this, channel, seed] (const CbmStsAnalogBuffer::Signal& signal) {
+          Digitize(channel, signal, seed);
+        });
+
   } // Iterate over channels
 
+  LOG(debug3) << GetName() << ": " << nSignals << " signals read out, "
+      << fReadoutDigis.size() << " above threshold";
+  return fReadoutDigis.size();
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Send the read-out digis to the digitiser   ----------------------
+Int_t CbmStsModule::SendDigis() {
+
+  CbmStsDigitize* digitiser = CbmStsSetup::Instance()->GetDigitizer();
+  if ( ! digitiser && ! fReadoutDigis.empty() )
+    LOG(fatal) << GetName() << ": no digitiser task present!";
+
+  Int_t nDigis = fReadoutDigis.size();
+  for (Int_t iDigi = 0; iDigi < nDigis; iDigi++) {
+    const ReadoutDigi& digi = fReadoutDigis[iDigi];
+    LOG(debug3) << GetName() << ": Sending message. Channel "
+        << digi.fChannel << ", time " << digi.fTime << ", adc " << digi.fAdc;
+    digitiser->CreateDigi(fAddress, digi.fChannel, digi.fTime, digi.fAdc,
+                          fReadoutMatches[iDigi]);
+  } //# read-out digis
+  fReadoutDigis.clear();
+
   return nDigis;
 }
 // -------------------------------------------------------------------------
@@ -513,6 +559,8 @@ void CbmStsModule::SetParameters(Double_t dynRange, Double_t threshold,
     asic.SetModuleParameters(dynRange, threshold, nAdc, timeResolution, deadTime,
                              noise, zeroNoiseRate, fracDeadChannels, deadChannelMap);
   }
+  fParameterVersion++;
+  UpdateAsicTables();
 
   // Initialise the analogue buffer
   InitAnalogBuffer();
@@ -582,8 +630,7 @@ void CbmStsModule::SetParameters(Double_t dynRange, Double_t threshold,
 // -----   String output   -------------------------------------------------
 string CbmStsModule::ToString() const {
     stringstream ss;
-    // sloppy cast, needs better way for output
-    auto& asic = const_cast<CbmStsModule*>(this)->GetAsicParameters(0);
+    auto& asic = GetAsicParameters(0);
     ss << "Module  " << GetName() << ": dynRange " << asic.GetDynRange()
        << "e, thresh. " << asic.GetThreshold() << "e, nAdc " << asic.GetNofAdc()
        << ", time res. " << asic.GetTimeResolution() << "ns, dead time "
@@ -7,6 +7,7 @@
 #define CBMSTSMODULE_H 1
 
 
+#include <cassert>
 #include <map>
 #include <set>
 #include <vector>
@@ -15,7 +16,8 @@
 #include "CbmStsCluster.h"
 #include "CbmStsDigi.h"
 #include "CbmStsHit.h"
-#include "digitize/CbmStsSignal.h"
+#include "CbmMatch.h"
+#include "digitize/CbmStsAnalogBuffer.h"
 #include "digitize/CbmStsDigitizeParameters.h"
 #include "setup/CbmStsElement.h"
 #include "setup/CbmStsSensor.h"
@@ -61,12 +63,48 @@ class CbmStsModule : public CbmStsElement
     virtual ~CbmStsModule();
 
 
+    /** @brief Quantities derived from the parameters of one asic
+     **
+     ** Precomputed when the parameters are set, such that the conversions
+     ** need neither divisions nor access to the parameter objects.
+     **/
+    struct AsicTable {
+      Double_t fThreshold = 0.;       ///< Threshold [e]
+      Double_t fDynRange = 0.;        ///< Dynamic range [e]
+      Int_t fNofAdc = 0;              ///< Number of ADC channels
+      Double_t fChargePerAdc = 0.;    ///< Width of an ADC channel [e]
+      Double_t fNoiseSq = 0.;         ///< Squared noise [e^2]
+      Double_t fDigitErrorSq = 0.;    ///< Squared digitisation error [e^2]
+      Double_t fTimeResolution = 0.;  ///< Time resolution [ns]
+      std::vector<Double_t> fCharge;  ///< ADC value -> charge [e]
+    };
+
+
+    /** @brief Digi read out from the analogue buffer, pending for sending **/
+    struct ReadoutDigi {
+      UShort_t fChannel;   ///< Channel number
+      UShort_t fAdc;       ///< Digitised charge
+      Long64_t fTime;      ///< Digitised time [ns]
+    };
+
+
     /** Convert ADC value to charge
      ** @param adc  ADC value
      ** @param channel Module channel
      ** @return analogue charge [e]
+     **
+     ** The charge is the centre of the ADC channel. It is taken from the
+     ** asic table if this is up to date.
      **/
-    Double_t AdcToCharge(UShort_t adc, UShort_t channel);
+    Double_t AdcToCharge(UShort_t adc, UShort_t channel) {
+      if ( HasValidAsicTables() ) {
+        const AsicTable& table = fAsicTables[GetAsicIndex(channel)];
+        if ( adc < table.fCharge.size() ) return table.fCharge[adc];
+      }
+      auto& asic = GetAsicParameters(channel);
+      return asic.GetThreshold() + asic.GetDynRange() / Double_t(asic.GetNofAdc()) *
+          ( Double_t(adc) + 0.5 );
+    }
 
 
     /** @brief Add a cluster to its array
@@ -129,6 +167,9 @@ class CbmStsModule : public CbmStsElement
      ** cut is tCutInSigma (default: 4) times the error of the time
      ** difference, which is calculated from the cluster time errors.
      ** If both tCutInNs and tCutInSigma are negative, no time cut is applied.
+     **
+     ** The cluster pairing uses a work space per thread, the counters of
+     ** which are not reported. Use the version with context to obtain them.
      **/
     Int_t FindHits(TClonesArray* hitArray, CbmEvent* event = NULL,
 									 Double_t tCutInNs = -1., Double_t tCutInSigma = 4.);
@@ -137,6 +178,53 @@ class CbmStsModule : public CbmStsElement
 									 Double_t tCutInNs = -1., Double_t tCutInSigma = 4.);
 
 
+    /** Find hits from an external set of clusters
+     ** @param clusters     Clusters of this module (sorted w.r.t. time)
+     ** @param hitArray     Array where hits shall be registered
+     ** @param event        Pointer to current event for registering of hits
+     ** @param tCutInNs     Max. cluster time difference in ns
+     ** @param tCutInSigma  Max. cluster time difference in terms of errors
+     ** @return Number of created hits
+     **
+     ** Same as FindHits, but using the given clusters instead of those
+     ** registered to the module.
+     **/
+    Int_t FindHits(std::vector<CbmStsCluster*>& clusters,
+                   TClonesArray* hitArray, CbmEvent* event,
+                   Double_t tCutInNs, Double_t tCutInSigma);
+
+    Int_t FindHitsVector(std::vector<CbmStsCluster*>& clusters,
+                         std::vector<CbmStsHit>* hitArray, CbmEvent* event,
+                         Double_t tCutInNs, Double_t tCutInSigma);
+
+
+    /** @brief Find hits from an external set of clusters, with explicit context
+     ** @param clusters     Clusters of this module (sorted w.r.t. time)
+     ** @param context      Output and work space of the hit finding
+     ** @param tCutInNs     Max. cluster time difference in ns
+     ** @param tCutInSigma  Max. cluster time difference in terms of errors
+     ** @return Number of created hits
+     **
+     ** The module and its sensors are not modified; several threads may
+     ** call this concurrently, each with its own context.
+     **/
+    Int_t FindHits(const std::vector<CbmStsCluster*>& clusters,
+                   CbmStsHitContext& context, Double_t tCutInNs,
+                   Double_t tCutInSigma) const;
+
+
+    /** @brief Find hits from the clusters of the module, with explicit context
+     ** @param context      Output and work space of the hit finding
+     ** @param tCutInNs     Max. cluster time difference in ns
+     ** @param tCutInSigma  Max. cluster time difference in terms of errors
+     ** @return Number of created hits
+     **/
+    Int_t FindHits(CbmStsHitContext& context, Double_t tCutInNs = -1.,
+                   Double_t tCutInSigma = 4.) const {
+      return FindHits(fClusters, context, tCutInNs, tCutInSigma);
+    }
+
+
     /** @brief Get the address from the module name (static)
      ** @param name Name of module
      ** @value Unique element address
@@ -144,6 +232,12 @@ class CbmStsModule : public CbmStsElement
     static Int_t GetAddressFromName(TString name);
 
 
+    /** @brief Analogue buffer (read access) **/
+    const CbmStsAnalogBuffer& GetAnalogBuffer() const {
+      return fAnalogBuffer;
+    }
+
+
     /** @brief Number of electronic channels
      ** @value Number of ADC channels
      **/
@@ -163,16 +257,16 @@ class CbmStsModule : public CbmStsElement
 
 
     /** Initialise the analogue buffer
-     ** The analogue buffer contains a std::multiset for each channel, to be
-     ** filled with CbmStsSignal objects. Without this method, a channel
-     ** multiset would be instantiated at run time when the first signal
+     ** The analogue buffer holds a time-ordered array of signals for each
+     ** channel (see CbmStsAnalogBuffer). Without this method, the array
+     ** of a channel would be instantiated at run time when the first signal
      ** for this channel arrives. Depending on the occupancy of this channel,
      ** this may happen only after several hundreds of events. Consequently,
      ** the memory consumption will increase for the first events until
      ** each channel was activated at least once. This behaviour mimics a
      ** memory leak and makes it harder to detect a real one in other parts
-     ** of the code. This is avoided by instantiating each channel multiset
-     ** at initialisation time.
+     ** of the code. This is avoided by instantiating the arrays of all
+     ** channels at initialisation time.
      **/
     void InitAnalogBuffer();
 
@@ -217,6 +311,50 @@ class CbmStsModule : public CbmStsElement
     Int_t ProcessAnalogBuffer(Double_t readoutTime);
 
 
+    /** @brief Read out the analogue buffer without sending the digis
+     ** @param readoutTime  Readout time [ns]; negative for all signals
+     ** @return Number of digis pending for sending
+     **
+     ** First step of ProcessAnalogBuffer: the signals up to the time limit
+     ** are removed from the buffer, and those above threshold are
+     ** digitised (charge and time) and stored with their MC match in the
+     ** readout buffer of the module. Only module data are accessed, and
+     ** the random numbers are taken from streams of the signals, such that
+     ** different modules can be read out concurrently.
+     **/
+    Int_t ReadOutAnalogBuffer(Double_t readoutTime);
+
+
+    /** @brief Number of digis pending for sending **/
+    Int_t GetNofReadoutDigis() const { return fReadoutDigis.size(); }
+
+
+    /** @brief Digi pending for sending
+     ** @param index  Index of the digi in the order of the read-out
+     **/
+    const ReadoutDigi& GetReadoutDigi(Int_t index) const {
+      return fReadoutDigis[index];
+    }
+
+
+    /** @brief Monte-Carlo match of a digi pending for sending
+     ** @param index  Index of the digi in the order of the read-out
+     **/
+    const CbmMatch& GetReadoutMatch(Int_t index) const {
+      return fReadoutMatches[index];
+    }
+
+
+    /** @brief Send the pending digis to the digitiser task
+     ** @return Number of sent digis
+     **
+     ** Second step of ProcessAnalogBuffer: the digis are sent in the order
+     ** of the read-out. Must be called serially, in the module order, for
+     ** a reproducible output order.
+     **/
+    Int_t SendDigis();
+
+
     /** Set the smae digitisation parameters for all asics in this module
      ** @param dynRagne          Dynamic range [e]
      ** @param threshold         Threshold [e]
@@ -240,24 +378,86 @@ class CbmStsModule : public CbmStsElement
      **/
     void SetParameters(std::vector<CbmStsDigitizeParameters> asicParameterVector) {
       fAsicParameterVector = asicParameterVector;
+      fParameterVersion++;
+      UpdateAsicTables();
     }
 
 
-    /** Get vector of individual asic parameters of this module
+    /** @brief Set the parameters of one asic of this module
+     ** @param iAsic  Index of the asic in the module
+     ** For the other parameters, see SetParameters.
+     **
+     ** The parameters are marked as modified, but the asic tables are not
+     ** rebuilt, such that several asics can be set in a row.
+     ** UpdateAsicTables() must be called after the last change.
      **/
-    std::vector<CbmStsDigitizeParameters>& GetParameters() {
+    void SetAsicParameters(UInt_t iAsic, Double_t dynRange,
+                           Double_t threshold, Int_t nAdc,
+                           Double_t timeResolution, Double_t deadTime,
+                           Double_t noise, Double_t zeroNoiseRate,
+                           Double_t fracDeadChannels = 0.,
+                           std::set<UChar_t> deadChannelMap = {}) {
+      assert( iAsic < fAsicParameterVector.size() );
+      fAsicParameterVector[iAsic].SetModuleParameters(dynRange, threshold,
+          nAdc, timeResolution, deadTime, noise, zeroNoiseRate,
+          fracDeadChannels, deadChannelMap);
+      MarkParametersModified();
+    }
+
+
+    /** Get vector of individual asic parameters of this module **/
+    const std::vector<CbmStsDigitizeParameters>& GetParameters() const {
       return fAsicParameterVector;
     }
 
 
+    /** @brief Version of the asic parameters
+     ** @value Counter incremented on each change of the parameters
+     **
+     ** Allows users to cache quantities derived from the parameters and
+     ** to refresh them when the parameters change. The parameters can be
+     ** changed only through SetParameters and SetAsicParameters, which
+     ** increment the version.
+     **/
+    UInt_t GetParameterVersion() const { return fParameterVersion; }
+
+
     /** Get parameters of the asic corresponding to the module channel number
      ** @param moduleChannel  module channel number
      **/
-    CbmStsDigitizeParameters& GetAsicParameters(UShort_t moduleChannel) {
-      return fAsicParameterVector[moduleChannel/fNofChannels];
+    const CbmStsDigitizeParameters&
+    GetAsicParameters(UShort_t moduleChannel) const {
+      return fAsicParameterVector[GetAsicIndex(moduleChannel)];
     }
 
 
+    /** @brief Derived quantities of the asic of a module channel
+     ** @param moduleChannel  module channel number
+     ** @return Table of the asic
+     **
+     ** The tables are built when the parameters are set through
+     ** SetParameters or Init. After SetAsicParameters, UpdateAsicTables()
+     ** must be called.
+     **/
+    const AsicTable& GetAsicTable(UShort_t moduleChannel) const {
+      assert( fTableVersion == fParameterVersion );
+      return fAsicTables[GetAsicIndex(moduleChannel)];
+    }
+
+
+    /** @brief Check whether the asic tables match the current parameters
+     ** @value kTRUE if the tables need not be rebuilt
+     **/
+    Bool_t HasValidAsicTables() const {
+      return fTableVersion == fParameterVersion
+          && fAsicTables.size() == fAsicParameterVector.size();
+    }
+
+
+    /** @brief Rebuild the asic tables if the parameters changed **/
+    void UpdateAsicTables();
+
+
     /** @brief Generate noise
      ** @param t1  Start time [ns]
      ** @param t2  Stop time [n2]
@@ -269,7 +469,8 @@ class CbmStsModule : public CbmStsElement
      ** length of the time interval. The noise hits are randomly distributed
      ** to the channels. The time of each noise digi is sampled from a flat
      ** distribution, its charge from a Gaussian with sigma = noise,
-     ** truncated at threshold.
+     ** truncated at threshold. The random numbers are taken from a stream
+     ** identified by the module address and t1.
      **/
     Int_t GenerateNoise(Double_t t1, Double_t t2);
 
@@ -280,8 +481,10 @@ class CbmStsModule : public CbmStsElement
     //DigisToHits
     std::vector<CbmStsCluster*> GetClusters() { return fClusters;}
 
-    void SortClustersByTime() {
-      std::sort(fClusters.begin(), fClusters.end(), [](CbmStsCluster* cluster1, CbmStsCluster* cluster2) {return (cluster1->GetTime() < cluster2->GetTime());});
+    void SortClustersByTime() { SortClustersByTime(fClusters); }
+
+    static void SortClustersByTime(std::vector<CbmStsCluster*>& clusters) {
+      std::sort(clusters.begin(), clusters.end(), [](CbmStsCluster* cluster1, CbmStsCluster* cluster2) {return (cluster1->GetTime() < cluster2->GetTime());});
     }
 
     void SortClustersByTimeError() {
@@ -293,33 +496,52 @@ class CbmStsModule : public CbmStsElement
     }
 
   private:
+
+    /** Increment the parameter version after a change of the parameters **/
+    void MarkParametersModified() { fParameterVersion++; }
+
+    /** Asic index for a module channel **/
+    UInt_t GetAsicIndex(UShort_t moduleChannel) const {
+      UInt_t iAsic = moduleChannel / kiNbAsicChannels;
+      assert( iAsic < fAsicParameterVector.size() );
+      return iAsic;
+    }
+
     UShort_t fNofChannels;       ///< Number of electronic channels
     Bool_t   fIsSet;             ///< Flag whether parameters are set
+    UInt_t   fParameterVersion;  //! Incremented on parameter changes
+    UInt_t   fTableVersion;      //! Parameter version of the asic tables
+    std::vector<AsicTable> fAsicTables; //! Derived quantities per asic
     // std::set <UShort_t> fDeadChannels;    ///< List of inactive channels
 
     static const Int_t kiNbAsicChannels = 128;
     std::vector<CbmStsDigitizeParameters> fAsicParameterVector{}; ///< Per Asic configuration
 
-    /** Buffer for analog signals, key is channel number.
+    /** Buffer for analog signals, per channel.
      ** Because signals do not, in general, arrive time-sorted,
-     ** the buffer must hold a (multi)set of signals for each channel
-     ** (multiset allowing for different signals at the same time).
-     ** Sorting in the multiset is with the less operator of CbmStsSignal,
-     ** which compares the time of the signals.
+     ** the signals of each channel are kept sorted w.r.t. time,
+     ** allowing for different signals at the same time.
      **/
-    typedef std::multiset<CbmStsSignal*, CbmStsSignal::Before> sigset;
-    std::map<UShort_t, sigset> fAnalogBuffer;
+    CbmStsAnalogBuffer fAnalogBuffer;  //!
+
+    /** Digis read out from the analogue buffer, pending for sending **/
+    std::vector<ReadoutDigi> fReadoutDigis;   //!
+    std::vector<CbmMatch> fReadoutMatches;    //! Match per pending digi (reused)
 
 
     /** Vector of clusters. Used for hit finding. **/
     std::vector<CbmStsCluster*> fClusters;
 
 
-    /** Digitise an analogue charge signal
+    /** Digitise an analogue signal
      ** @param channel Channel number
-     ** @param signal  Pointer to signal object
+     ** @param signal  Signal in the analogue buffer
+     ** @param seed    Random seed for the time smearing
+     **
+     ** Signals above threshold are appended to the readout buffer.
      **/
-    void Digitize(UShort_t channel, CbmStsSignal* signal);
+    void Digitize(UShort_t channel, const CbmStsAnalogBuffer::Signal& signal,
+                  ULong64_t seed);
 
 
     /** Initialise daughters from geometry **/
@@ -43,8 +43,10 @@ CbmStsSensor::CbmStsSensor(UInt_t address, TGeoPhysicalNode* node,
     fConditions(nullptr),
     fCurrentLink(nullptr),
     fHits(nullptr),
-    fEvent(nullptr)
+    fEvent(nullptr),
+    fTransform()
 {
+  UpdateTransform();
 }
 // -------------------------------------------------------------------------
 
@@ -59,15 +61,27 @@ void CbmStsSensor::CreateHit(Double_t xLocal, Double_t yLocal, Double_t varX,
   // ---  Check output array
   assert(fHits);
 
-	// --- If a TGeoNode is attached, transform into global coordinate system
+  thread_local CbmStsHitContext context;
+  context.SetOutput(fHits, fEvent);
+  CreateHit(xLocal, yLocal, varX, varY, varXY, clusterF, clusterB, du, dv,
+            context);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Create a new hit in the output of a context   -------------------
+void CbmStsSensor::CreateHit(Double_t xLocal, Double_t yLocal, Double_t varX,
+                             Double_t varY, Double_t varXY,
+                             CbmStsCluster* clusterF, CbmStsCluster* clusterB,
+                             Double_t du, Double_t dv,
+                             CbmStsHitContext& context) const {
+
+	// --- Transform into global coordinate system (identity if there is
+	// --- no TGeoNode)
 	Double_t local[3] = { xLocal, yLocal, 0.};
 	Double_t global[3];
-	if ( fNode ) fNode->GetMatrix()->LocalToMaster(local, global);
-	else {
-		global[0] = local[0];
-		global[1] = local[1];
-		global[2] = local[2];
-	} //? no TGeoNode available
+	fTransform.LocalToMaster(local, global);
 
 	// We assume here that the local-to-global transformations is only translation
 	// plus maybe rotation upside down or front-side back. In that case, the
@@ -84,20 +98,17 @@ void CbmStsSensor::CreateHit(Double_t xLocal, Double_t yLocal, Double_t varX,
 	Double_t hitTimeError = 0.5 * TMath::Sqrt( etF*etF + etB*etB );
 
 	// --- Create hit
-	Int_t index = fHits->GetEntriesFast();
 	Int_t indexF = ( clusterF ? clusterF->GetIndex() : -1 );
     Int_t indexB = ( clusterB ? clusterB->GetIndex() : -1 );
-	new ( (*fHits)[index] )
-			CbmStsHit(GetAddress(),              // address
-					      global,                // coordinates
-					      error,                 // coordinate error
-					      varXY,                 // covariance xy
-					      indexF,                // front cluster index
-					      indexB,                // back cluster index
-					      hitTime,               // hit time
-					      hitTimeError,          // hit time error
-					      du, dv);               // errors in u and v
-	if ( fEvent) fEvent->AddData(kStsHit, index);
+	context.AddHit(GetAddress(),              // address
+	               global,                    // coordinates
+	               error,                     // coordinate error
+	               varXY,                     // covariance xy
+	               indexF,                    // front cluster index
+	               indexB,                    // back cluster index
+	               hitTime,                   // hit time
+	               hitTimeError,              // hit time error
+	               du, dv);                   // errors in u and v
 
 	LOG(debug2) << GetName() << ": Creating hit at (" << global[0] << ", "
 			        << global[1] << ", " << global[2] << ")";
@@ -106,58 +117,27 @@ void CbmStsSensor::CreateHit(Double_t xLocal, Double_t yLocal, Double_t varX,
 // -------------------------------------------------------------------------
 
 
-// -----   Create a new hit   ----------------------------------------------
-void CbmStsSensor::CreateHitVector(Double_t xLocal, Double_t yLocal, Double_t varX,
-		                     Double_t varY, Double_t varXY,
-		                     CbmStsCluster* clusterF, CbmStsCluster* clusterB,
-		                     Double_t du, Double_t dv) {
-
-  // ---  Check output array
-  assert(fHitsVector);
-
-	// --- If a TGeoNode is attached, transform into global coordinate system
-	Double_t local[3] = { xLocal, yLocal, 0.};
-	Double_t global[3];
-	if ( fNode ) fNode->GetMatrix()->LocalToMaster(local, global);
-	else {
-		global[0] = local[0];
-		global[1] = local[1];
-		global[2] = local[2];
-	} //? no TGeoNode available
 
-	// We assume here that the local-to-global transformations is only translation
-	// plus maybe rotation upside down or front-side back. In that case, the
-	// global covariance matrix is the same as the local one.
-	Double_t error[3] = { TMath::Sqrt(varX), TMath::Sqrt(varY), 0.};
+// -----   Find hits (TClonesArray output)   -------------------------------
+Int_t CbmStsSensor::FindHits(std::vector<CbmStsCluster*>& clusters,
+                             TClonesArray* hitArray, CbmEvent* event,
+                             Double_t tCutInNs, Double_t tCutInSigma) {
+  thread_local CbmStsHitContext context;
+  context.SetOutput(hitArray, event);
+  return FindHits(clusters, context, tCutInNs, tCutInSigma);
+}
+// -------------------------------------------------------------------------
 
 
-	// --- Calculate hit time (average of cluster times)
-	Double_t fTime = ( clusterF ? clusterF->GetTime() : 0. );
-    Double_t bTime = ( clusterB ? clusterB->GetTime() : 0. );
-    Double_t hitTime = 0.5 * ( fTime + bTime);
-	Double_t etF = ( clusterF ? clusterF->GetTimeError() : 0. );
-	Double_t etB = ( clusterB ? clusterB->GetTimeError() : 0. );
-	Double_t hitTimeError = 0.5 * TMath::Sqrt( etF*etF + etB*etB );
 
-	// --- Create hit
-	Int_t index = fHitsVector->size();
-	Int_t indexF = ( clusterF ? clusterF->GetIndex() : -1 );
-    Int_t indexB = ( clusterB ? clusterB->GetIndex() : -1 );
-	fHitsVector->emplace_back(
-						  GetAddress(),              // address
-					      global,                // coordinates
-					      error,                 // coordinate error
-					      varXY,                 // covariance xy
-					      indexF,                // front cluster index
-					      indexB,                // back cluster index
-					      hitTime,               // hit time
-					      hitTimeError,          // hit time error
-					      du, dv);
-	if ( fEvent) fEvent->AddData(kStsHit, index);
-
-	LOG(debug2) << GetName() << ": Creating hit at (" << global[0] << ", "
-			        << global[1] << ", " << global[2] << ")";
-	return;
+// -----   Find hits (vector output)   -------------------------------------
+Int_t CbmStsSensor::FindHitsVector(std::vector<CbmStsCluster*>& clusters,
+                                   std::vector<CbmStsHit>* hitArray,
+                                   CbmEvent* event, Double_t tCutInNs,
+                                   Double_t tCutInSigma) {
+  thread_local CbmStsHitContext context;
+  context.SetOutput(hitArray, event);
+  return FindHits(clusters, context, tCutInNs, tCutInSigma);
 }
 // -------------------------------------------------------------------------
 
@@ -186,9 +166,34 @@ CbmStsModule* CbmStsSensor::GetModule() const {
 
 
 
+// -----   Magnetic field at a CbmStsPoint   -------------------------------
+void CbmStsSensor::PointField(const CbmStsPoint* point, Double_t* bField) {
+  Double_t global[3];
+  global[0] = 0.5 * ( point->GetXIn() + point->GetXOut() );
+  global[1] = 0.5 * ( point->GetYIn() + point->GetYOut() );
+  global[2] = 0.5 * ( point->GetZIn() + point->GetZOut() );
+  bField[0] = bField[1] = bField[2] = 0.;
+  if ( FairRun::Instance() -> GetField())
+  	FairRun::Instance()->GetField()->Field(global, bField);
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Process a CbmStsPoint  ------------------------------------------
 Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
 		                             Double_t eventTime, CbmLink* link) {
+  Double_t bField[3];
+  PointField(point, bField);
+  return ProcessPoint(point, eventTime, link, bField);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Process a CbmStsPoint with given field   ------------------------
+Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point, Double_t eventTime,
+                                 CbmLink* link, const Double_t* bField) {
 
   // --- Set current link
 	fCurrentLink = link;
@@ -199,7 +204,7 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
   global[0] = point->GetXIn();
   global[1] = point->GetYIn();
   global[2] = point->GetZIn();
-  fNode->GetMatrix()->MasterToLocal(global, local);
+  fTransform.MasterToLocal(global, local);
   Double_t x1 = local[0];
   Double_t y1 = local[1];
   Double_t z1 = local[2];
@@ -208,7 +213,7 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
   global[0] = point->GetXOut();
   global[1] = point->GetYOut();
   global[2] = point->GetZOut();
-  fNode->GetMatrix()->MasterToLocal(global, local);
+  fTransform.MasterToLocal(global, local);
   Double_t x2 = local[0];
   Double_t y2 = local[1];
   Double_t z2 = local[2];
@@ -240,11 +245,7 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
  		global[0] = point->GetPx();
  		global[1] = point->GetPy();
  		global[2] = point->GetPz();
- 		Double_t* rot;
- 		rot = fNode->GetMatrix()->GetRotationMatrix();
- 		TGeoHMatrix rotMat;
- 		rotMat.SetRotation(rot);
- 		rotMat.MasterToLocal(global,local);
+ 		fTransform.MasterToLocalVect(global, local);
  		if ( local[2] != 0.) {;  // should always be; else no correction
  			Double_t	tX = local[0] / local[2]; // px/pz
  			Double_t	tY = local[1] / local[2]; // py/pz
@@ -272,11 +273,7 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
   	global[0] = point->GetPxOut();
  		global[1] = point->GetPyOut();
  		global[2] = point->GetPzOut();
- 		Double_t* rot;
-  	rot = fNode->GetMatrix()->GetRotationMatrix();
- 		TGeoHMatrix rotMat;
- 		rotMat.SetRotation(rot);
- 		rotMat.MasterToLocal(global,local);
+ 		fTransform.MasterToLocalVect(global, local);
  		Double_t tX = 0.;
  		Double_t tY = 0.;
  		// Use momentum components for track direction, if available
@@ -316,33 +313,24 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
   Double_t pz = 0.5 * ( point->GetPz() + point->GetPzOut() );
   Double_t p = TMath::Sqrt( px*px + py*py + pz*pz );
 
-  // --- Get magnetic field
-  global[0] = 0.5 * ( point->GetXIn() + point->GetXOut() );
-  global[1] = 0.5 * ( point->GetYIn() + point->GetYOut() );
-  global[2] = 0.5 * ( point->GetZIn() + point->GetZOut() );
-  Double_t bField[3] = { 0., 0., 0.};
-  if ( FairRun::Instance() -> GetField())
-  	FairRun::Instance()->GetField()->Field(global, bField);
-
   // --- Absolute time of StsPoint
   Double_t pTime = eventTime + point->GetTime();
 
   // --- Create SensorPoint
   // Note: there is a conversion from kG to T in the field values.
-  CbmStsSensorPoint* sPoint = new CbmStsSensorPoint(x1, y1, z1, x2, y2, z2, p,
-                                                    point->GetEnergyLoss(),
-                                                    pTime,
-                                                    bField[0] / 10.,
-                                                    bField[1] / 10.,
-                                                    bField[2] / 10.,
-                                                    point->GetPid());
+  CbmStsSensorPoint sPoint(x1, y1, z1, x2, y2, z2, p,
+                           point->GetEnergyLoss(),
+                           pTime,
+                           bField[0] / 10.,
+                           bField[1] / 10.,
+                           bField[2] / 10.,
+                           point->GetPid());
   LOG(debug2) << GetName() << ": Local point coordinates are (" << x1
   		        << ", " << y1 << "), (" << x2 << ", " << y2 << ")";
   LOG(debug2) << point->IsEntry() << " " << point->IsExit();
 
   // --- Call ProcessPoint method from sensor type
-  Int_t result = CalculateResponse(sPoint);
-  delete sPoint;
+  Int_t result = CalculateResponse(&sPoint);
 
   return result;
 }
@@ -350,4 +338,13 @@ Int_t CbmStsSensor::ProcessPoint(const CbmStsPoint* point,
 
 
 
+// -----   Copy the node transformation   ----------------------------------
+void CbmStsSensor::UpdateTransform() {
+  if ( fNode ) fTransform.Set(*fNode->GetMatrix());
+  else fTransform.SetIdentity();
+}
+// -------------------------------------------------------------------------
+
+
+
 ClassImp(CbmStsSensor)
@@ -16,7 +16,9 @@
 #include "CbmStsCluster.h"
 #include "CbmStsElement.h"
 #include "CbmStsHit.h"
+#include "CbmStsHitContext.h"
 #include "CbmStsSensorConditions.h"
+#include "CbmStsTransform.h"
 
 class TClonesArray;
 class TGeoPhysicalNode;
@@ -73,16 +75,31 @@ class CbmStsSensor : public CbmStsElement
      ** @param clusterB pointer to back side cluster
      ** @param du       Error in u coordinate (across strips front side) [cm]
      ** @param dv       Error in v coordinate (across strips back side) [cm]
+     **
+     ** The hit is stored in fHits and registered to fEvent.
      **/
     void CreateHit(Double_t xLocal, Double_t yLocal,
     		       Double_t varX, Double_t varY, Double_t varXY,
     		       CbmStsCluster* clusterF, CbmStsCluster* clusterB,
     		       Double_t du = 0., Double_t dv = 0.);
 
-    void CreateHitVector(Double_t xLocal, Double_t yLocal,
-    		       Double_t varX, Double_t varY, Double_t varXY,
-    		       CbmStsCluster* clusterF, CbmStsCluster* clusterB,
-    		       Double_t du = 0., Double_t dv = 0.);
+
+    /** Create a new hit in the output of a hit-finding context
+     ** @param xLocal   hit x coordinate in sensor system [cm]
+     ** @param yLocal   hit y coordinate in sensor system [cm]
+     ** @param varX     Variance in x [cm^2]
+     ** @param varY     Variance in y [cm^2]
+     ** @param varXY    Covariance of x and y [cm^2]
+     ** @param clusterF pointer to front side cluster
+     ** @param clusterB pointer to back side cluster
+     ** @param du       Error in u coordinate (across strips front side) [cm]
+     ** @param dv       Error in v coordinate (across strips back side) [cm]
+     ** @param context  Output sink
+     **/
+    void CreateHit(Double_t xLocal, Double_t yLocal,
+                   Double_t varX, Double_t varY, Double_t varXY,
+                   CbmStsCluster* clusterF, CbmStsCluster* clusterB,
+                   Double_t du, Double_t dv, CbmStsHitContext& context) const;
 
 
     /** Find hits in sensor
@@ -98,15 +115,35 @@ class CbmStsSensor : public CbmStsElement
      ** to deltaTinSigma times the error of the time difference,
      ** which is calculated from the cluster time errors.
      ** If both tCutInNs and tCutInSigma are negative, no time cut is applied.
+     **
+     ** Wrapper to the version with context, using a work space per thread.
+     ** The pairing counters of this work space are not reported; callers
+     ** needing them must use the version with context.
      **/
-    virtual Int_t FindHits(std::vector<CbmStsCluster*>& clusters,
-                           TClonesArray* hitArray, CbmEvent* event,
-                           Double_t tCutInNs, Double_t tCutInSigma) = 0;
+    Int_t FindHits(std::vector<CbmStsCluster*>& clusters,
+                   TClonesArray* hitArray, CbmEvent* event,
+                   Double_t tCutInNs, Double_t tCutInSigma);
 
-    virtual Int_t FindHitsVector(std::vector<CbmStsCluster*>& clusters,
-                                 std::vector<CbmStsHit>* hitArray, CbmEvent* event,
-                                 Double_t tCutInNs,
-																 Double_t tCutInSigma) = 0;
+    /** As FindHits, but the hits are stored in a vector **/
+    Int_t FindHitsVector(std::vector<CbmStsCluster*>& clusters,
+                         std::vector<CbmStsHit>* hitArray, CbmEvent* event,
+                         Double_t tCutInNs, Double_t tCutInSigma);
+
+
+    /** @brief Find hits in sensor, without modifying the sensor
+     ** @param clusters     Vector of clusters
+     ** @param context      Output sink and work space
+     ** @param tCutInNs     Max. time difference of clusters in a hit in ns
+     ** @param tCutInSigma  Max. time difference of clusters in multiples of error
+     ** @return Number of created hits
+     **
+     ** Time cuts as for the other FindHits. All state of the call is kept
+     ** in the context, such that the same sensor can be processed
+     ** concurrently by several threads with different contexts.
+     **/
+    virtual Int_t FindHits(const std::vector<CbmStsCluster*>& clusters,
+                           CbmStsHitContext& context, Double_t tCutInNs,
+                           Double_t tCutInSigma) const = 0;
 
 
     /** @brief Get the address from the sensor name (static)
@@ -146,6 +183,13 @@ class CbmStsSensor : public CbmStsElement
   	virtual Bool_t Init() { return kTRUE; }
 
 
+    /** @brief Cached transformation from the local to the global system
+     **
+     ** Copy of the node matrix, updated with UpdateTransform.
+     **/
+    const CbmStsTransform& GetTransform() const { return fTransform; }
+
+
     /** Get the sensor Id within the module  **/
     Int_t GetSensorId() const {
       return CbmStsAddress::GetElementId(fAddress, kStsSensor); }
@@ -174,6 +218,29 @@ class CbmStsSensor : public CbmStsElement
     		               Double_t eventTime = 0., CbmLink* link = NULL);
 
 
+    /** @brief Process one MC Point with given magnetic field
+     ** @param point      Pointer to CbmStsPoint object
+     ** @param eventTime  Start time of the MC event [ns]
+     ** @param link       Link to the MC point
+     ** @param bField     Magnetic field at the point [kG] (size 3)
+     ** @return  Status variable, depends on sensor type
+     **
+     ** As ProcessPoint without field, but the field is not taken from the
+     ** field map, which is not thread-safe. Only data of the sensor and
+     ** its module are modified, such that points in different modules can
+     ** be processed concurrently.
+     **/
+    Int_t ProcessPoint(const CbmStsPoint* point, Double_t eventTime,
+                       CbmLink* link, const Double_t* bField);
+
+
+    /** @brief Magnetic field at the mid-point of a MC point
+     ** @param[in]  point   Pointer to CbmStsPoint object
+     ** @param[out] bField  Magnetic field [kG] (size 3); zero without field
+     **/
+    static void PointField(const CbmStsPoint* point, Double_t* bField);
+
+
     /** @brief Set sensor address
      ** @param address STS element address
      **/
@@ -205,20 +272,31 @@ class CbmStsSensor : public CbmStsElement
     /** @brief Set the physical node
      ** @param node  Pointer to associated TGeoPhysicalNode object
      **/
-    void SetNode(TGeoPhysicalNode* node) { fNode = node; }
+    void SetNode(TGeoPhysicalNode* node) {
+      fNode = node;
+      UpdateTransform();
+    }
 
 
     /** String output **/
     virtual std::string ToString() const = 0;
 
 
+    /** @brief Copy the transformation matrix of the node
+     **
+     ** To be called if the node matrix has changed. Without node,
+     ** the transformation is the identity.
+     **/
+    void UpdateTransform();
+
+
   protected:
 
     CbmStsSensorConditions*  fConditions;  ///< Operating conditions
     CbmLink* fCurrentLink;  ///< Link to currently processed MCPoint
     TClonesArray* fHits;    ///< Output array for hits. Used in hit finding.
-    std::vector<CbmStsHit>* fHitsVector; //!
     CbmEvent* fEvent;       //! ///< Pointer to current event
+    CbmStsTransform fTransform;  //! Local-to-global transformation
 
 
     /** Perform response simulation for one MC Point
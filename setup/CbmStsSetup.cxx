@@ -59,6 +59,8 @@ CbmStsSetup::CbmStsSetup() : CbmStsElement(kSts, kStsSystem),
 			     fSensors(),
 			     fModules(),
 			     fModuleVector(),
+			     fModuleTable(),
+			     fModuleTableDim(),
 			     fStations() 
 {
 }
@@ -179,6 +181,42 @@ Int_t CbmStsSetup::CreateStations() {
 
 
 
+// -----   Build the address-to-module lookup table   ---------------------
+void CbmStsSetup::CreateModuleTable() {
+
+  // --- Table extension: maximal element id per level
+  for (Int_t iDim = 0; iDim < 4; iDim++) fModuleTableDim[iDim] = 0;
+  for (auto module : fModuleVector) {
+    for (Int_t iDim = 0; iDim < 4; iDim++) {
+      UInt_t id = CbmStsAddress::GetElementId(module->GetAddress(),
+                                              kStsUnit + iDim);
+      if ( id >= fModuleTableDim[iDim] ) fModuleTableDim[iDim] = id + 1;
+    }
+  }
+
+  // --- Fill the table; empty slots point to no module
+  fModuleTable.assign(fModuleTableDim[0] * fModuleTableDim[1]
+                      * fModuleTableDim[2] * fModuleTableDim[3], -1);
+  for (UInt_t index = 0; index < fModuleVector.size(); index++) {
+    Int_t address = fModuleVector[index]->GetAddress();
+    assert( GetModuleIndex(address) == -1 );
+    UInt_t unit   = CbmStsAddress::GetElementId(address, kStsUnit);
+    UInt_t ladder = CbmStsAddress::GetElementId(address, kStsLadder);
+    UInt_t hLad   = CbmStsAddress::GetElementId(address, kStsHalfLadder);
+    UInt_t module = CbmStsAddress::GetElementId(address, kStsModule);
+    fModuleTable[ ( ( unit * fModuleTableDim[1] + ladder )
+                    * fModuleTableDim[2] + hLad )
+                  * fModuleTableDim[3] + module ] = index;
+  }
+
+  LOG(debug) << GetName() << ": Module lookup table with "
+      << fModuleTable.size() << " entries for " << fModuleVector.size()
+      << " modules";
+}
+// -------------------------------------------------------------------------
+
+
+
 // -----   Instantiate default sensor   ------------------------------------
 CbmStsSensor* CbmStsSetup::DefaultSensor(Int_t address,
                                          TGeoPhysicalNode* node) {
@@ -354,6 +392,9 @@ Bool_t CbmStsSetup::Init(const char* geoFile, const char* parFile) {
     } //# ladders in unit
   } //# units in system
 
+  // --- Build the address-to-module lookup table
+  CreateModuleTable();
+
   // --- Create station objects
   Int_t nStations = CreateStations();
   LOG(info) << GetName() << ": Setup contains " << nStations
@@ -366,6 +407,10 @@ Bool_t CbmStsSetup::Init(const char* geoFile, const char* parFile) {
     } //# stations
   } //? Debug
 
+  // --- Cache the transformation matrices of the sensors
+  for (auto it = fSensors.begin(); it != fSensors.end(); it++)
+    it->second->UpdateTransform();
+
   // --- Consistency check
   if ( GetNofSensors() != GetNofElements(kStsSensor) )
     LOG(fatal) << GetName() << ": inconsistent number of sensors! "
@@ -828,10 +873,9 @@ Int_t CbmStsSetup::SetModuleParameters(const char* fileName) {
     std::istringstream iDeadChannelMap(sDeadChannelMap);
     std::set<UChar_t> deadChannelMap = std::set<UChar_t>(std::istream_iterator<int>(iDeadChannelMap), std::istream_iterator<int>());
 
-    std::vector<CbmStsDigitizeParameters>& asics = module->GetParameters();
     // --- Set parameters of module
-    asics[iAsic].SetModuleParameters(dynRange, threshold, nAdc, tResol, tDead, noise,
-                                     zeroNoise, fracDead, deadChannelMap);
+    module->SetAsicParameters(iAsic, dynRange, threshold, nAdc, tResol, tDead,
+                              noise, zeroNoise, fracDead, deadChannelMap);
     LOG(debug1) << GetName() << ": Set " << module->ToString() << " Asic: " << iAsic;
     moduleSet.insert(address);
 
@@ -843,6 +887,10 @@ Int_t CbmStsSetup::SetModuleParameters(const char* fileName) {
             << (nModules == 1 ? " module" : " modules") << " from "
             << inputFile;
 
+  // Rebuild the asic tables after the changes of the parameters
+  for (auto it = fModules.begin(); it != fModules.end(); it++)
+    it->second->UpdateAsicTables();
+
   // Check that all sensors have their conditions set
   if ( nModules!= fModules.size() ) {
     LOG(fatal) << GetName() << ": " << fModules.size()
@@ -918,7 +966,7 @@ Int_t CbmStsSetup::StoreModuleParameters(const char* fileName) {
   UInt_t nModules = 0;
 
   for (auto it = fModules.begin(); it != fModules.end(); it++) {
-    CbmStsModule* module = (*it).second;
+    const CbmStsModule* module = (*it).second;
     assert(module);
 
     // Check for double occurrences of sensors
@@ -931,7 +979,7 @@ Int_t CbmStsSetup::StoreModuleParameters(const char* fileName) {
 
     mName = module->GetName();
 
-    std::vector<CbmStsDigitizeParameters>& asics = module->GetParameters();
+    const std::vector<CbmStsDigitizeParameters>& asics = module->GetParameters();
 
     for (UInt_t iAsic = 0; iAsic < asics.size(); iAsic++) {
       auto& asic = asics[iAsic];
@@ -953,6 +1001,7 @@ Int_t CbmStsSetup::StoreModuleParameters(const char* fileName) {
             << nAdc << "\t" << tResol << "\t" << tDead << "\t" << noise
             << "\t" << zeroNoise << "\t" << fracDead << "\t" << deadChannelMapStream.str() << std::endl;
     }
+
     // --- Store parameters of module
     LOG(debug1) << GetName() << ": Store module parameters " << module->ToString();
     nModules++;
@@ -103,6 +103,28 @@ class CbmStsSetup : public CbmStsElement
     CbmStsModule* GetModule(Int_t index) const { return fModuleVector.at(index); }
 
 
+    /** @brief Get the index of a module from an address
+     ** @param address  Unique address of the module or of any of its daughters
+     ** @return Index of module in the module vector; -1 if not in setup
+     **
+     ** Constant-time lookup through a dense table over the unit, ladder,
+     ** half-ladder and module ids of the address, built at initialisation.
+     ** The index is the one used by GetModule(Int_t).
+     **/
+    Int_t GetModuleIndex(Int_t address) const {
+      UInt_t unit   = CbmStsAddress::GetElementId(address, kStsUnit);
+      UInt_t ladder = CbmStsAddress::GetElementId(address, kStsLadder);
+      UInt_t hLad   = CbmStsAddress::GetElementId(address, kStsHalfLadder);
+      UInt_t module = CbmStsAddress::GetElementId(address, kStsModule);
+      if ( unit >= fModuleTableDim[0] || ladder >= fModuleTableDim[1]
+           || hLad >= fModuleTableDim[2] || module >= fModuleTableDim[3] )
+        return -1;
+      return fModuleTable[ ( ( unit * fModuleTableDim[1] + ladder )
+                             * fModuleTableDim[2] + hLad )
+                           * fModuleTableDim[3] + module ];
+    }
+
+
     /** Get number of modules in setup **/
     Int_t GetNofModules() const { return fModules.size(); }
 
@@ -356,6 +378,10 @@ class CbmStsSetup : public CbmStsElement
     // --- Vector of modules. For convenient loops.
     std::vector<CbmStsModule*> fModuleVector;
 
+    // --- Dense lookup table (unit, ladder, half-ladder, module) -> module index
+    std::vector<Int_t> fModuleTable;  //!
+    UInt_t fModuleTableDim[4];        //! Table extension per level
+
     // --- Map of stations. Key is station number.
     // --- Stations are a special case needed for reconstruction;
     // --- they are not elements in the setup.
@@ -369,6 +395,13 @@ class CbmStsSetup : public CbmStsElement
     Int_t CreateStations();
 
 
+    /** @brief Build the address-to-module lookup table
+     **
+     ** Called at initialisation, after the module vector is filled.
+     **/
+    void CreateModuleTable();
+
+
     /** @brief Read the geometry from TGeoManager
      ** @param geoManager  Instance of TGeoManager
      ** @return kTRUE if successfully read; kFALSE else
@@ -0,0 +1,99 @@
+/** @file CbmStsTransform.cxx
+ **/
+
+#include "CbmStsTransform.h"
+
+#include "TGeoMatrix.h"
+
+
+// -----   Batch transformation local to global   --------------------------
+void CbmStsTransform::LocalToMaster(Int_t n, const Double_t* x,
+                                    const Double_t* y, const Double_t* z,
+                                    Double_t* gx, Double_t* gy,
+                                    Double_t* gz) const {
+  const Double_t* m = fMatrix;
+  for (Int_t index = 0; index < n; index++) {
+    gx[index] = m[3]  + x[index] * m[0] + y[index] * m[1] + z[index] * m[2];
+    gy[index] = m[7]  + x[index] * m[4] + y[index] * m[5] + z[index] * m[6];
+    gz[index] = m[11] + x[index] * m[8] + y[index] * m[9] + z[index] * m[10];
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Batch transformation local to global (single precision)   -------
+void CbmStsTransform::LocalToMaster(Int_t n, const Float_t* x,
+                                    const Float_t* y, const Float_t* z,
+                                    Float_t* gx, Float_t* gy,
+                                    Float_t* gz) const {
+  const Float_t* m = fMatrixF;
+  for (Int_t index = 0; index < n; index++) {
+    gx[index] = m[3]  + x[index] * m[0] + y[index] * m[1] + z[index] * m[2];
+    gy[index] = m[7]  + x[index] * m[4] + y[index] * m[5] + z[index] * m[6];
+    gz[index] = m[11] + x[index] * m[8] + y[index] * m[9] + z[index] * m[10];
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Batch transformation global to local   --------------------------
+void CbmStsTransform::MasterToLocal(Int_t n, const Double_t* gx,
+                                    const Double_t* gy, const Double_t* gz,
+                                    Double_t* x, Double_t* y,
+                                    Double_t* z) const {
+  const Double_t* m = fMatrix;
+  for (Int_t index = 0; index < n; index++) {
+    Double_t mt0 = gx[index] - m[3];
+    Double_t mt1 = gy[index] - m[7];
+    Double_t mt2 = gz[index] - m[11];
+    x[index] = mt0 * m[0] + mt1 * m[4] + mt2 * m[8];
+    y[index] = mt0 * m[1] + mt1 * m[5] + mt2 * m[9];
+    z[index] = mt0 * m[2] + mt1 * m[6] + mt2 * m[10];
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Batch transformation global to local (single precision)   -------
+void CbmStsTransform::MasterToLocal(Int_t n, const Float_t* gx,
+                                    const Float_t* gy, const Float_t* gz,
+                                    Float_t* x, Float_t* y,
+                                    Float_t* z) const {
+  const Float_t* m = fMatrixF;
+  for (Int_t index = 0; index < n; index++) {
+    Float_t mt0 = gx[index] - m[3];
+    Float_t mt1 = gy[index] - m[7];
+    Float_t mt2 = gz[index] - m[11];
+    x[index] = mt0 * m[0] + mt1 * m[4] + mt2 * m[8];
+    y[index] = mt0 * m[1] + mt1 * m[5] + mt2 * m[9];
+    z[index] = mt0 * m[2] + mt1 * m[6] + mt2 * m[10];
+  }
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Copy from a geometry matrix   -----------------------------------
+void CbmStsTransform::Set(const TGeoMatrix& matrix) {
+  const Double_t* rot = matrix.GetRotationMatrix();
+  const Double_t* tr = matrix.GetTranslation();
+  for (Int_t i = 0; i < 3; i++) {
+    for (Int_t j = 0; j < 3; j++) fMatrix[4*i+j] = rot[3*i+j];
+    fMatrix[4*i+3] = tr[i];
+  }
+  for (Int_t k = 0; k < 12; k++) fMatrixF[k] = Float_t(fMatrix[k]);
+}
+// -------------------------------------------------------------------------
+
+
+
+// -----   Identity   ------------------------------------------------------
+void CbmStsTransform::SetIdentity() {
+  for (Int_t k = 0; k < 12; k++) fMatrix[k] = 0.;
+  fMatrix[0] = fMatrix[5] = fMatrix[10] = 1.;
+  for (Int_t k = 0; k < 12; k++) fMatrixF[k] = Float_t(fMatrix[k]);
+}
+// -------------------------------------------------------------------------
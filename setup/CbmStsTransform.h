@@ -0,0 +1,125 @@
+/** @file CbmStsTransform.h
+ **/
+
+#ifndef CBMSTSTRANSFORM_H
+#define CBMSTSTRANSFORM_H 1
+
+#include "Rtypes.h"
+
+class TGeoMatrix;
+
+
+/** @class CbmStsTransform
+ ** @brief Flat copy of the local-to-global transformation of a sensor
+ **
+ ** Holds rotation and translation of a geometry matrix as a 3x4 array,
+ ** row by row (r00 r01 r02 t0, r10 r11 r12 t1, r20 r21 r22 t2), in double
+ ** and in single precision. A transformation is then a few multiplications
+ ** and additions on member data, without the overhead of the TGeo matrix
+ ** access.
+ **
+ ** The double-precision transformations are evaluated in the same order
+ ** as in TGeoMatrix, such that the results are the same.
+ **/
+class CbmStsTransform
+{
+
+  public:
+
+    /** @brief Constructor: identity transformation **/
+    CbmStsTransform() { SetIdentity(); }
+
+
+    /** @brief Transformation of a point from the local to the global system
+     ** @param[in]  local   Local coordinates (array of size 3)
+     ** @param[out] master  Global coordinates (array of size 3)
+     **/
+    void LocalToMaster(const Double_t* local, Double_t* master) const {
+      const Double_t* m = fMatrix;
+      for (Int_t i = 0; i < 3; i++)
+        master[i] = m[4*i+3] + local[0] * m[4*i] + local[1] * m[4*i+1]
+                    + local[2] * m[4*i+2];
+    }
+
+
+    /** @brief Transformation of points from the local to the global system
+     ** @param[in]  n  Number of points
+     ** @param[in]  x,y,z     Local coordinates (arrays of size n)
+     ** @param[out] gx,gy,gz  Global coordinates (arrays of size n)
+     **
+     ** The loop can be vectorised by the compiler.
+     **/
+    void LocalToMaster(Int_t n, const Double_t* x, const Double_t* y,
+                       const Double_t* z, Double_t* gx, Double_t* gy,
+                       Double_t* gz) const;
+
+
+    /** @brief Single-precision version of the batch LocalToMaster **/
+    void LocalToMaster(Int_t n, const Float_t* x, const Float_t* y,
+                       const Float_t* z, Float_t* gx, Float_t* gy,
+                       Float_t* gz) const;
+
+
+    /** @brief Transformation of a point from the global to the local system
+     ** @param[in]  master  Global coordinates (array of size 3)
+     ** @param[out] local   Local coordinates (array of size 3)
+     **/
+    void MasterToLocal(const Double_t* master, Double_t* local) const {
+      const Double_t* m = fMatrix;
+      Double_t mt0 = master[0] - m[3];
+      Double_t mt1 = master[1] - m[7];
+      Double_t mt2 = master[2] - m[11];
+      for (Int_t i = 0; i < 3; i++)
+        local[i] = mt0 * m[i] + mt1 * m[4+i] + mt2 * m[8+i];
+    }
+
+
+    /** @brief Transformation of points from the global to the local system
+     ** @param[in]  n  Number of points
+     ** @param[in]  gx,gy,gz  Global coordinates (arrays of size n)
+     ** @param[out] x,y,z     Local coordinates (arrays of size n)
+     **
+     ** The loop can be vectorised by the compiler.
+     **/
+    void MasterToLocal(Int_t n, const Double_t* gx, const Double_t* gy,
+                       const Double_t* gz, Double_t* x, Double_t* y,
+                       Double_t* z) const;
+
+
+    /** @brief Single-precision version of the batch MasterToLocal **/
+    void MasterToLocal(Int_t n, const Float_t* gx, const Float_t* gy,
+                       const Float_t* gz, Float_t* x, Float_t* y,
+                       Float_t* z) const;
+
+
+    /** @brief Transformation of a direction from the global to the local
+     ** system (rotation only)
+     ** @param[in]  master  Global vector (array of size 3)
+     ** @param[out] local   Local vector (array of size 3)
+     **/
+    void MasterToLocalVect(const Double_t* master, Double_t* local) const {
+      const Double_t* m = fMatrix;
+      for (Int_t i = 0; i < 3; i++)
+        local[i] = master[0] * m[i] + master[1] * m[4+i]
+                   + master[2] * m[8+i];
+    }
+
+
+    /** @brief Copy rotation and translation from a geometry matrix
+     ** @param matrix  Geometry matrix (local to global)
+     **/
+    void Set(const TGeoMatrix& matrix);
+
+
+    /** @brief Set to the identity transformation **/
+    void SetIdentity();
+
+
+  private:
+
+    Double_t fMatrix[12];   ///< Rotation and translation, 3 x 4, row by row
+    Float_t fMatrixF[12];   ///< Same in single precision
+
+};
+
+#endif